@@ -163,6 +163,16 @@ struct CAMERA_PROPERTIES_T
     }
 };
 
+// statistics of a capture, in the replies of capture and stopCapture
+typedef struct
+{
+    unsigned int frames;        // frames written to files
+    unsigned long long dropped; // frames overwritten in the ring before capture read them
+    unsigned long long bytes;
+    unsigned int maxQueueDepth;
+    unsigned int throughputKBps; // bytes written per second of capture, in KiB
+} CAPTURE_STATS_T;
+
 typedef struct
 {
     std::string str_memorytype;
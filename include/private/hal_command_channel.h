@@ -0,0 +1,124 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+/*-----------------------------------------------------------------------------
+ (File Inclusions)
+ ----------------------------------------------------------------------------*/
+#include "camera_types.h"
+#include <climits>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+
+// Commands of the binary channel between the camera service and a HAL process.
+// The channel is a SOCK_SEQPACKET socket pair, the HAL hands one end out with openChannel.
+// Luna stays for the other commands and when the channel is not available.
+enum class HalCommand : int32_t
+{
+    GET_DEVICE_PROPERTY,
+    SET_DEVICE_PROPERTY,
+    SET_FORMAT,
+    GET_FORMAT,
+    START_PREVIEW,
+    STOP_PREVIEW,
+    START_CAPTURE,
+    STOP_CAPTURE,
+    ADD_CLIENT,
+    REMOVE_CLIENT,
+    GET_FD,
+    OPEN,
+    // OPEN, SET_FORMAT, START_PREVIEW, ADD_CLIENT and GET_FD of the buffer and the signal in one
+    OPEN_STREAM
+};
+
+// fds a reply carries at most, the buffer and the signal of OPEN_STREAM
+#define HAL_REPLY_MAX_FDS 2
+
+// Fields not used by a command are left zero. The strings of a command follow the header on the
+// channel, the name and then the path, without terminators and as long as the sizes here.
+struct HAL_COMMAND_T
+{
+    uint32_t seq;
+    HalCommand command;
+    int32_t id;                    // client id of addClient, removeClient, getFd and openStream
+    int32_t value;                 // forceComplete, ncount, index of getFd, camera id of open
+    CAMERA_FORMAT format;          // setFormat, startCapture, openStream if nWidth is set
+    camera_queryctrl_t properties; // setDeviceProperty
+    uint32_t nameSize;
+    uint32_t pathSize;
+};
+
+// longest strings a command carries
+#define HAL_COMMAND_NAME_MAX 32
+#define HAL_COMMAND_PATH_MAX PATH_MAX
+
+// A command with its strings, the sizes of the header are set when it is sent.
+struct HalCommandMessage : HAL_COMMAND_T
+{
+    std::string name; // memtype of startPreview and openStream, mode, type of getFd
+    std::string path; // image path of startCapture, device node of open
+};
+
+// The fds of getFd and openStream go along with the reply as SCM_RIGHTS.
+struct HAL_REPLY_T
+{
+    uint32_t seq;
+    DEVICE_RETURN_CODE_T ret;
+    HalCommand step;               // the step of openStream that failed
+    CAMERA_FORMAT format;          // getFormat
+    camera_queryctrl_t properties; // getDeviceProperty, values rejected by setDeviceProperty
+    CAPTURE_STATS_T captureStats;  // stopCapture
+};
+
+class HalCommandChannel
+{
+public:
+    // Sends one message with the nfds fds attached.
+    static bool send(int sock, const void *msg, size_t size, const int *fds = nullptr,
+                     size_t nfds = 0);
+    // Receives one message. Up to nfds attached fds are stored to fds, the rest are -1.
+    // The fds beyond nfds are closed.
+    static ssize_t receive(int sock, void *msg, size_t size, int *fds = nullptr, size_t nfds = 0);
+
+    // Sends the header of cmd and the bytes of its strings. The strings must fit the maxima.
+    static bool sendCommand(int sock, HalCommandMessage &cmd);
+    // Receives one command. Returns false if the channel is closed or the message is malformed.
+    static bool receiveCommand(int sock, HalCommandMessage *cmd);
+};
+
+// Camera service end of the channel to one HAL process.
+class HalCommandClient
+{
+    int sock_;
+    uint32_t seq_{0};
+    std::mutex mutex_;
+
+public:
+    explicit HalCommandClient(int sock);
+    ~HalCommandClient();
+
+    HalCommandClient(const HalCommandClient &)            = delete;
+    HalCommandClient &operator=(const HalCommandClient &) = delete;
+
+    // Returns false if the command could not be sent, the caller may fall back to luna then.
+    // A command sent but not answered in time gets DEVICE_ERROR_TIMEOUT, it is not sent again.
+    // The fds of the reply are stored to fds as receive() does. A command with a string longer
+    // than the maxima is not sent.
+    bool call(HalCommandMessage &cmd, HAL_REPLY_T *reply, int timeout, int *fds = nullptr,
+              size_t nfds = 0);
+};
@@ -0,0 +1,42 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+#pragma once
+
+/*-----------------------------------------------------------------------------
+ (File Inclusions)
+ ----------------------------------------------------------------------------*/
+#include "camera_log.h"
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+
+// libjpeg exits the process on an error unless the error handler jumps out of the decoder.
+// A frame decoded straight from the shared memory and overwritten meanwhile ends up here.
+// The decoder sets jump with setjmp() and error_exit of pub to onDecodeError.
+struct DecodeError
+{
+    struct jpeg_error_mgr pub;
+    jmp_buf jump;
+};
+
+static inline void onDecodeError(j_common_ptr cinfo)
+{
+    char message[JMSG_LENGTH_MAX];
+    (*cinfo->err->format_message)(cinfo, message);
+    PLOGE("jpeg decode error : %s", message);
+
+    longjmp(reinterpret_cast<DecodeError *>(cinfo->err)->jump, 1);
+}
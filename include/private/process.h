@@ -22,6 +22,7 @@
 class Process
 {
     pid_t _pid;
+    bool _exited{false};
 
     void start(const std::string &cmd);
     void stop();
@@ -29,4 +30,9 @@ class Process
 public:
     Process(const std::string &cmd);
     ~Process();
+
+    // Asks the process to exit (SIGTERM), for a process that does not end by itself.
+    void terminate();
+    // Returns false if the process has exited, it is reaped then.
+    bool isRunning();
 };
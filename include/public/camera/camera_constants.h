@@ -127,11 +127,27 @@
 #define CONST_PARAM_NAME_DEVHANDLE "devHandle"
 #define CONST_PARAM_NAME_OUTMSG "outMsg"
 #define CONST_PARAM_NAME_SHMNAME "shmName"
+#define CONST_PARAM_NAME_DECODED_SHMNAME "decodedShmName"
 #define CONST_PARAM_NAME_BUFFERSIZE "bufferSize"
 #define CONST_PARAM_NAME_ENABLE "enable"
 #define CONST_PARAM_NAME_METASIZE_HINT "metaSizeHint"
 #define CONST_PARAM_NAME_WINDOW_ID "windowId"
 #define CONST_PARAM_NAME_FORCE_COMPLETE "forceComplete"
+#define CONST_PARAM_NAME_INDEX "index"
+#define CONST_PARAM_NAME_CAPTURE_STATS "captureStats"
+#define CONST_PARAM_NAME_FRAMES "frames"
+#define CONST_PARAM_NAME_DROPPED "dropped"
+#define CONST_PARAM_NAME_BYTES "bytes"
+#define CONST_PARAM_NAME_MAX_QUEUE_DEPTH "maxQueueDepth"
+#define CONST_PARAM_NAME_MAX_LATENCY "maxLatency"
+#define CONST_PARAM_NAME_PRIORITY "priority"
+#define CONST_PARAM_NAME_SCHEDULES "schedules"
+#define CONST_PARAM_NAME_STATUS "status"
+#define CONST_PARAM_NAME_LATENCY "latency"
+#define CONST_PARAM_NAME_SKIPPED "skipped"
+#define CONST_PARAM_NAME_THROUGHPUT "throughputKBps"
+#define CONST_PARAM_NAME_FAILED_STEP "failedStep"
+#define CONST_PARAM_NAME_FAILED_PARAMS "failedParams"
 
 const int n_invalid_id = -1;
 const int extra_buffer = 1024;
@@ -152,6 +168,8 @@ const std::string cstr_connect         = "device_connect";
 const std::string cstr_disconnect      = "device_disconnect";
 const std::string cstr_previewfault    = "preview_fault";
 const std::string cstr_capturefault    = "capture_fault";
+const std::string cstr_shmem           = "shmem";
+const std::string cstr_dmabuf          = "dmabuf";
 const std::string cstr_uricameramain   = "com.webos.service.camera2";
 const std::string cstr_uricamearhal    = "com.webos.camerahal.";
 #ifdef DAC_ENABLED
@@ -12,6 +12,7 @@ struct DEVICE_LIST_T
     std::string strProductName;
     std::string strVendorID;
     std::string strProductID;
+    std::string strVersion; // firmware version of the device
     std::string strDeviceType;
     std::string strDeviceSubtype;
     std::string strDeviceNode;
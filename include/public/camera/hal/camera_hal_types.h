@@ -18,6 +18,7 @@
 #define CAMERA_HAL_TYPES
 
 #include "camera_hal_types_common.h"
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -137,4 +138,22 @@ struct camera_device_info_t
     std::vector<camera_resolution_t> stResolution;
 };
 
+// Frame scheduling of a camera solution. Frames that do not fit are skipped at read.
+// In a request, zero fields keep the current value.
+struct solution_schedule_t
+{
+    double fps{0.0};       // frames processed per second, 0 for every frame
+    int max_latency_ms{0}; // frames captured longer ago are skipped, 0 for no limit
+    int priority{0};       // nice value of the processing thread
+};
+
+struct solution_status_t
+{
+    std::string name;
+    solution_schedule_t schedule;
+    double fps{0.0};     // achieved processing rate
+    int latency_ms{0};   // average time from capture to the end of processing
+    uint64_t skipped{0}; // frames skipped by the schedule
+};
+
 #endif
@@ -41,6 +41,9 @@ typedef enum
     CAMERA_PIXEL_FORMAT_JPEG,
     CAMERA_PIXEL_FORMAT_H264,
 
+    /* RGB, decoded by the camera hal for the solutions */
+    CAMERA_PIXEL_FORMAT_BGR888,
+
     /* MAX */
     CAMERA_PIXEL_FORMAT_MAX
 } camera_pixel_format_t;
@@ -71,6 +74,8 @@ typedef struct
     unsigned long length;
     size_t index;
     int fd;
+    unsigned long long timestamp; // capture time in microseconds (driver clock)
+    unsigned int sequence;        // frame sequence number from the driver
 } buffer_t;
 #define BUFFER_T_DEFINED
 #endif // BUFFER_T_DEFINED
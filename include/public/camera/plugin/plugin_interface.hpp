@@ -60,6 +60,12 @@ struct IHal : public IFeature
     virtual int getProperties(void *cam_out_param)                     = 0;
     virtual int getInfo(void *cam_info, std::string devicenode)        = 0;
     virtual int getBufferFd(int *bufFd, int *count)                    = 0;
+    // Properties changed by the device since the previous call. Returns 0 if there are any,
+    // -1 otherwise and for plugins without control events.
+    virtual int getPropertyEvents(void *cam_out_param) { return -1; }
+    // Properties the device rejected in the previous setProperties, with the values requested.
+    // Returns 0 if there are any, -1 otherwise and for plugins which do not report them.
+    virtual int getPropertyErrors(void *cam_out_param) { return -1; }
 };
 
 /**
@@ -120,6 +126,16 @@ struct ISolution : public IFeature
     virtual void processForSnapshot(const void *inBuf)         = 0;
     virtual void processForPreview(const void *inBuf)          = 0;
     virtual void release(void)                                 = 0;
+    // Shared memory reader client registered by the camera hal for this solution.
+    // Called before initialize(). -1 if none : the solution reads the latest frame.
+    virtual void setClientId(int clientId) {}
+    // Shared memory of the preview frames decoded once by the camera hal, for all solutions.
+    // Called before initialize(). Empty if none : the solution reads the frames of shmName.
+    virtual void setDecodedShmName(const std::string &shmName) {}
+    // solution_schedule_t requested for the solution, and solution_status_t of the frames it
+    // processed. Solutions without frame scheduling ignore them.
+    virtual void setSchedule(const void *schedule) {}
+    virtual bool getStatus(void *status) { return false; }
 };
 
 /**
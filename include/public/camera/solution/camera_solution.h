@@ -50,6 +50,8 @@ public:
     virtual void setEnableValue(bool enableValue) { enableStatus_ = enableValue; };
     virtual int getProperty() { return solutionProperty_; };
     virtual bool isEnabled(void) { return enableStatus_; };
+    virtual void setClientId(int clientId) { clientId_ = clientId; }
+    virtual void setDecodedShmName(const std::string &shmName) { decodedShmName_ = shmName; }
     // interface - need to override
     virtual std::string getSolutionStr(void)           = 0;
     virtual void processForSnapshot(const void *inBuf) = 0;
@@ -65,5 +67,7 @@ protected:
 
     std::string name_;
     std::string shmName_;
+    std::string decodedShmName_;
     LSHandle *sh_{nullptr};
+    int clientId_{-1};
 };
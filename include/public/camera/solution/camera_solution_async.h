@@ -20,6 +20,7 @@
 #include <atomic>
 #include <cstring>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <thread>
 
@@ -29,12 +30,22 @@ class CameraSharedMemoryEx;
 class CameraSolutionAsync : public CameraSolution
 {
 public:
+    // Read-only lease on the frame in a slot of the shared memory, data_ points into the slot.
+    // The writer does not reuse a leased slot until it runs short of buffers, isValid() tells
+    // whether it has taken the slot back since. makePrivate() copies the frame out for a
+    // solution that keeps it or works on it in place.
     struct Buffer
     {
         uint8_t *data_{nullptr};
         uint32_t size_{0};
-        Buffer(uint8_t *data, uint32_t size);
+        Buffer(uint8_t *data, uint32_t size, CameraSharedMemoryEx *shmem = nullptr);
         ~Buffer(void);
+        bool isValid(void) const;
+        bool makePrivate(void);
+
+    private:
+        CameraSharedMemoryEx *shmem_{nullptr};
+        std::unique_ptr<uint8_t[]> copy_;
     };
     using Queue  = std::queue<std::unique_ptr<Buffer>>;
     using Thread = std::unique_ptr<std::thread>;
@@ -49,6 +60,8 @@ public:
     virtual void processForSnapshot(const void *inBuf) override;
     virtual void processForPreview(const void *inBuf) override;
     virtual void release(void) override;
+    virtual void setSchedule(const void *schedule) override;
+    virtual bool getStatus(void *status) override;
 
 protected:
     virtual void run(void);
@@ -64,11 +77,36 @@ protected:
 protected:
     void pushJob(buffer_t inBuf);
     void popJob(void);
+    // Process one of every factor frames published, the others are released unread.
+    void setDecimation(uint32_t factor) { decimation_ = (factor > 0) ? factor : 1; }
+    // Smallest frame the solution works on, set in the constructor. Jpeg frames are decoded
+    // scaled down by 1/2, 1/4 or 1/8 as long as they stay this large. 0 : the full size.
+    void setInputSize(uint32_t width, uint32_t height)
+    {
+        inputWidth_  = width;
+        inputHeight_ = height;
+    }
+    // scale_denom for libjpeg to decode a width x height frame at the input size
+    uint32_t getScaleDenom(uint32_t width, uint32_t height) const;
 
 protected:
     Queue queueJob_;
     Thread threadJob_;
     std::atomic<bool> bAlive_{false};
+    std::atomic<uint32_t> decimation_{1};
+
+    // the schedule set in the constructor is the default of the solution
+    solution_schedule_t schedule_;
+    solution_status_t status_;
+    std::mutex mtxSchedule_;
+
+    // Set in the constructor by a solution that works on BGR pixels : it reads the frames the
+    // hal decoded once for all the solutions, when there are any. frameFormat_ is the format
+    // of the frame being processed, the stream format or the decoded one.
+    bool decodedInput_{false};
+    stream_format_t frameFormat_{CAMERA_PIXEL_FORMAT_JPEG, 0, 0, 0, 0};
+    uint32_t inputWidth_{0};
+    uint32_t inputHeight_{0};
 
     std::unique_ptr<CameraSharedMemoryEx> camShmem_;
 };
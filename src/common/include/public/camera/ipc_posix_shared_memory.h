@@ -31,6 +31,8 @@ typedef struct
     unsigned long length;
     size_t index;
     int fd;
+    unsigned long long timestamp; // capture time in microseconds (driver clock)
+    unsigned int sequence;        // frame sequence number from the driver
 } buffer_t;
 #define BUFFER_T_DEFINED
 #endif // BUFFER_T_DEFINED
@@ -0,0 +1,55 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#define LOG_CONTEXT "libs"
+#define LOG_TAG "CameraFrameMeta"
+#include "camera_frame_meta.h"
+#include "camera_utils_log.h"
+#include <cinttypes>
+#include <cstdio>
+
+std::string cameraFrameMetaToJson(const unsigned char *pMeta, size_t metaSize)
+{
+    if (!pMeta || metaSize < sizeof(CameraFrameMeta))
+    {
+        PLOGE("invalid meta buffer (%p, %zu)", pMeta, metaSize);
+        return "";
+    }
+
+    const CameraFrameMeta *meta = reinterpret_cast<const CameraFrameMeta *>(pMeta);
+    if (meta->version != CAMERA_FRAME_META_VERSION)
+    {
+        PLOGE("unknown meta version %u", meta->version);
+        return "";
+    }
+
+    // same layout as the json meta written before the binary format
+    char json[512];
+    int len = snprintf(json, sizeof(json),
+                       "{\"video\":{\"timestamp\":%" PRIu64 ",\"sequence\":%u},"
+                       "\"extra\":{\"buffer\":{\"format\":%u,\"width\":%u,\"height\":%u,"
+                       "\"stride\":%u,\"size\":%" PRIu64 ",\"timestamp\":%" PRIu64
+                       ",\"flags\":%u}}}",
+                       meta->timestamp, meta->sequence, meta->format, meta->width, meta->height,
+                       meta->stride, meta->size, meta->timestamp, meta->flags);
+    if (len < 0 || (size_t)len >= sizeof(json))
+    {
+        PLOGE("meta json is truncated");
+        return "";
+    }
+
+    return std::string(json, len);
+}
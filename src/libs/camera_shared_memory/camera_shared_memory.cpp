@@ -56,6 +56,25 @@ bool CameraSharedMemory::read(unsigned char **ppData, size_t *pDataSize, unsigne
                         pSolutionSize, timeoutMs, false);
 }
 
+bool CameraSharedMemory::release(void)
+{
+    PLOGD("");
+    return pImpl_->release();
+}
+
+bool CameraSharedMemory::isValid(void) { return pImpl_->isValid(); }
+
+bool CameraSharedMemory::attachCursor(int handle, CameraShmReadPolicy policy)
+{
+    PLOGI("handle %d, policy %d", handle, policy);
+    return pImpl_->attachCursor(handle, policy);
+}
+
+bool CameraSharedMemory::getReadStats(uint64_t *pDropped, uint64_t *pDuplicated)
+{
+    return pImpl_->getReadStats(pDropped, pDuplicated);
+}
+
 void CameraSharedMemory::close(void)
 {
     PLOGI("");
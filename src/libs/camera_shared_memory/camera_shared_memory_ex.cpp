@@ -28,9 +28,11 @@ CameraSharedMemoryEx::CameraSharedMemoryEx() : pImpl_(std::make_unique<CameraSha
 CameraSharedMemoryEx::~CameraSharedMemoryEx() { PLOGI(""); }
 
 int CameraSharedMemoryEx::create(const std::string name, size_t dataSize, size_t metaSize,
-                                 size_t extraSize, size_t solutionSize, size_t bufferCount)
+                                 size_t extraSize, size_t solutionSize, size_t bufferCount,
+                                 unsigned int options)
 {
-    return pImpl_->create(name, dataSize, metaSize, extraSize, solutionSize, bufferCount);
+    return pImpl_->create(name, dataSize, metaSize, extraSize, solutionSize, bufferCount,
+                          options);
 }
 
 bool CameraSharedMemoryEx::open(int fd) { return pImpl_->open(fd); }
@@ -39,8 +41,6 @@ int CameraSharedMemoryEx::open(const std::string name) { return pImpl_->open(nam
 
 void CameraSharedMemoryEx::close(void) { return pImpl_->close(); }
 
-bool CameraSharedMemoryEx::incrementWriteIndex(void) { return pImpl_->incrementWriteIndex(); }
-
 bool CameraSharedMemoryEx::writeHeader(int index, size_t dataSize)
 {
     return pImpl_->writeHeader(index, dataSize);
@@ -103,3 +103,59 @@ bool CameraSharedMemoryEx::detachSignal(const std::string &name)
 void CameraSharedMemoryEx::releaseAllSignals(void) { pImpl_->releaseAllSignals(); }
 
 int CameraSharedMemoryEx::getWriteIndex(void) { return pImpl_->getWriteIndex(); }
+
+bool CameraSharedMemoryEx::acquireSlot(int index, uint32_t *pSequence, uint32_t *pGeneration)
+{
+    return pImpl_->acquireSlot(index, pSequence, pGeneration);
+}
+
+void CameraSharedMemoryEx::releaseSlot(int index, uint32_t generation)
+{
+    pImpl_->releaseSlot(index, generation);
+}
+
+bool CameraSharedMemoryEx::isSlotValid(int index, uint32_t sequence)
+{
+    return pImpl_->isSlotValid(index, sequence);
+}
+
+bool CameraSharedMemoryEx::release(void) { return pImpl_->release(); }
+
+bool CameraSharedMemoryEx::isValid(void) { return pImpl_->isValid(); }
+
+int CameraSharedMemoryEx::getReadIndex(void) { return pImpl_->getReadIndex(); }
+
+bool CameraSharedMemoryEx::lockSlotForWrite(int index, bool force)
+{
+    return pImpl_->lockSlotForWrite(index, force);
+}
+
+int CameraSharedMemoryEx::addCursor(int clientId) { return pImpl_->addCursor(clientId); }
+
+void CameraSharedMemoryEx::removeCursor(int clientId) { pImpl_->removeCursor(clientId); }
+
+void CameraSharedMemoryEx::printCursorStats(void) { pImpl_->printCursorStats(); }
+
+bool CameraSharedMemoryEx::attachCursor(int clientId, int policy)
+{
+    return pImpl_->attachCursor(clientId, policy);
+}
+
+bool CameraSharedMemoryEx::getReadStats(uint64_t *pDropped, uint64_t *pDuplicated)
+{
+    return pImpl_->getReadStats(pDropped, pDuplicated);
+}
+
+bool CameraSharedMemoryEx::setFrameDue(int64_t dueTime) { return pImpl_->setFrameDue(dueTime); }
+
+bool CameraSharedMemoryEx::isFrameDue(int64_t now) { return pImpl_->isFrameDue(now); }
+
+bool CameraSharedMemoryEx::setInputSize(uint32_t width, uint32_t height)
+{
+    return pImpl_->setInputSize(width, height);
+}
+
+bool CameraSharedMemoryEx::getInputSize(uint32_t *pWidth, uint32_t *pHeight)
+{
+    return pImpl_->getInputSize(pWidth, pHeight);
+}
@@ -17,18 +17,74 @@
 #define LOG_CONTEXT "libs"
 #define LOG_TAG "CameraSharedMemoryImpl"
 #include "camera_shared_memory_impl.h"
+#include "camera_shared_memory.h"
+#include "camera_shared_memory_ex.h"
 #include "camera_utils_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cstring>
 #include <fcntl.h>
 #include <iostream>
 #include <limits.h>
+#include <linux/futex.h>
+#include <linux/memfd.h>
+#include <new>
 #include <poll.h>
 #include <sys/eventfd.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+// Every section starts on a cache line : the size field takes one line, the payload follows.
+static const size_t kShmAlignment = 64;
+
+static size_t alignUp(size_t size) { return (size + kShmAlignment - 1) & ~(kShmAlignment - 1); }
+
+static size_t sectionSize(size_t payloadSize) { return kShmAlignment + alignUp(payloadSize); }
+
+// header, slot states and cursors, followed by the slots
+static size_t headerSectionSize(size_t bufferCount)
+{
+    return alignUp(sizeof(ShmHeader) + sizeof(ShmSlotState) * bufferCount +
+                   sizeof(ShmCursor) * SHM_MAX_CURSORS);
+}
+
+// Hugetlb mappings must be a multiple of the huge page size. The memfd asks for this size with
+// MFD_HUGE_2MB instead of the default huge page size of the system, which may differ.
+static const size_t kHugePageSize = 2 * 1024 * 1024;
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+              "frameSequence must be usable as a futex word");
+
+// The futex words live in a MAP_SHARED mapping, so the process-shared operations are used.
+static int futexWait(std::atomic<uint32_t> *pWord, uint32_t expected,
+                     const struct timespec *pTimeout)
+{
+    return syscall(SYS_futex, reinterpret_cast<uint32_t *>(pWord), FUTEX_WAIT, expected, pTimeout,
+                   nullptr, 0);
+}
+
+static int futexWakeAll(std::atomic<uint32_t> *pWord)
+{
+    return syscall(SYS_futex, reinterpret_cast<uint32_t *>(pWord), FUTEX_WAKE, INT_MAX, nullptr,
+                   nullptr, 0);
+}
+
+// Milliseconds left until deadline, -1 (infinite) if timeoutMs is negative.
+static int remainingMs(int timeoutMs, std::chrono::steady_clock::time_point deadline)
+{
+    if (timeoutMs < 0)
+        return -1;
+
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    return (left.count() > 0) ? (int)left.count() : 0;
+}
+
 CameraSharedMemoryImpl::CameraSharedMemoryImpl()
     : shmFd_(-1), shmAddr_(nullptr), shmSize_(0), shmHeader_(nullptr)
 {
@@ -43,43 +99,55 @@ CameraSharedMemoryImpl::~CameraSharedMemoryImpl()
 }
 
 int CameraSharedMemoryImpl::create(const std::string name, size_t dataSize, size_t metaSize,
-                                   size_t extraSize, size_t solutionSize, size_t bufferCount)
+                                   size_t extraSize, size_t solutionSize, size_t bufferCount,
+                                   unsigned int options)
 {
-    PLOGI("name(%s) data(%zu) meta(%zu) extra(%zu) solution(%zu) count(%zu)", name.c_str(),
-          dataSize, metaSize, extraSize, solutionSize, bufferCount);
+    PLOGI("name(%s) data(%zu) meta(%zu) extra(%zu) solution(%zu) count(%zu) options(0x%x)",
+          name.c_str(), dataSize, metaSize, extraSize, solutionSize, bufferCount, options);
 
     std::lock_guard<std::mutex> lock(m_);
 
-    shmFd_ =
-        shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
-    if (shmFd_ == -1)
+    if (bufferCount == 0 || bufferCount > SHM_MAX_BUFFER_COUNT)
     {
-        PLOGE("shm_open failed : %s", name.c_str());
+        PLOGE("bufferCount is out of range (%zu)", bufferCount);
         return -1;
     }
-    isCreated_ = true;
 
-    size_t headerSize      = sizeof(ShmHeader);
-    size_t dataSectionSize = dataSize + metaSize + extraSize + solutionSize + sizeof(size_t) * 4;
+    size_t headerSize      = headerSectionSize(bufferCount);
+    size_t dataSectionSize = sectionSize(dataSize) + sectionSize(metaSize) +
+                             sectionSize(extraSize) + sectionSize(solutionSize);
     shmSize_               = headerSize + bufferCount * dataSectionSize;
+    if (options & CAMERA_SHM_OPT_HUGEPAGE)
+        shmSize_ = (shmSize_ + kHugePageSize - 1) & ~(kHugePageSize - 1);
     PLOGI("headerSize(%zu) dataSectionSize(%zu) shmSize(%zu)", headerSize, dataSectionSize,
           shmSize_);
-    if (ftruncate(shmFd_, shmSize_) == -1)
+
+    bool hugetlb = (options & CAMERA_SHM_OPT_MEMFD) && (options & CAMERA_SHM_OPT_HUGEPAGE);
+    if (!mapMemory(name, options, hugetlb))
     {
-        PLOGE("ftruncate failed");
-        ::close(shmFd_);
-        shmFd_ = -1;
-        return -1;
+        if (!hugetlb)
+            return -1;
+
+        // MFD_HUGETLB succeeds without reserved huge pages, only the mapping fails. A kernel
+        // without huge pages of 2 MiB fails memfd_create already.
+        PLOGW("no huge pages available, fall back to transparent huge pages");
+        hugetlb = false;
+        if (!mapMemory(name, options, false))
+            return -1;
     }
 
-    shmAddr_ = mmap(NULL, shmSize_, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd_, 0);
-    if (shmAddr_ == MAP_FAILED)
+    // before the pages are touched, so that they are allocated as huge pages
+    if ((options & CAMERA_SHM_OPT_HUGEPAGE) && !hugetlb &&
+        madvise(shmAddr_, shmSize_, MADV_HUGEPAGE) == -1)
     {
-        PLOGE("mmap failed");
-        shmAddr_ = nullptr;
-        ::close(shmFd_);
-        shmFd_ = -1;
-        return -1;
+        PLOGW("madvise(MADV_HUGEPAGE) failed : %s", strerror(errno));
+    }
+
+    // mlock faults in every page, the first frames then take no page fault
+    if ((options & CAMERA_SHM_OPT_PREFAULT) && mlock(shmAddr_, shmSize_) == -1)
+    {
+        PLOGW("mlock failed : %s, prefault only", strerror(errno));
+        memset(shmAddr_, 0, shmSize_);
     }
 
     struct stat sb;
@@ -93,14 +161,14 @@ int CameraSharedMemoryImpl::create(const std::string name, size_t dataSize, size
     size_t stSize_ = sb.st_size;
     PLOGI("st_size(%zu)", stSize_);
 
-    shmName_                 = name;
-    shmHeader_               = static_cast<ShmHeader *>(shmAddr_);
-    shmHeader_->writeIndex   = -1;
+    shmHeader_               = new (shmAddr_) ShmHeader;
     shmHeader_->bufferCount  = bufferCount;
     shmHeader_->dataSize     = dataSize;
     shmHeader_->metaSize     = metaSize;
     shmHeader_->extraSize    = extraSize;
     shmHeader_->solutionSize = solutionSize;
+    shmHeader_->frameSequence.store(0);
+    shmHeader_->writeSequence.store(0, std::memory_order_release);
 
     initBuffers();
     for (auto &buffer : shmBuffers_)
@@ -109,12 +177,82 @@ int CameraSharedMemoryImpl::create(const std::string name, size_t dataSize, size
         *buffer.pMetaSize     = 0;
         *buffer.pExtraSize    = 0;
         *buffer.pSolutionSize = 0;
+
+        // every slot starts owned by the writer until its first frame is published
+        buffer.pState = new (buffer.pState) ShmSlotState;
+        buffer.pState->sequence.store(1);
+        buffer.pState->leases.store(0);
+        buffer.pState->frame.store(0);
+    }
+
+    for (int i = 0; i < SHM_MAX_CURSORS; ++i)
+    {
+        ShmCursor *cursor = new (&shmCursors_[i]) ShmCursor;
+        cursor->clientId.store(-1);
+        cursor->dueTime.store(INT64_MAX);
+        cursor->inputWidth.store(0);
+        cursor->inputHeight.store(0);
     }
 
     PLOGI("fd(%d)", shmFd_);
     return shmFd_;
 }
 
+bool CameraSharedMemoryImpl::mapMemory(const std::string &name, unsigned int options,
+                                       bool hugetlb)
+{
+    if (options & CAMERA_SHM_OPT_MEMFD)
+    {
+        unsigned int flags =
+            MFD_CLOEXEC | MFD_ALLOW_SEALING | (hugetlb ? MFD_HUGETLB | MFD_HUGE_2MB : 0);
+        shmFd_             = memfd_create(name.c_str(), flags);
+        if (shmFd_ == -1)
+        {
+            PLOGE("memfd_create failed : %s", strerror(errno));
+            return false;
+        }
+    }
+    else
+    {
+        shmFd_ = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR,
+                          S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+        if (shmFd_ == -1)
+        {
+            PLOGE("shm_open failed : %s", name.c_str());
+            return false;
+        }
+        isCreated_ = true;
+        shmName_   = name;
+    }
+
+    if (ftruncate(shmFd_, shmSize_) == -1)
+    {
+        PLOGE("ftruncate failed");
+        ::close(shmFd_);
+        shmFd_ = -1;
+        return false;
+    }
+
+    // the size is final : clients can rely on the mapping not being truncated under them
+    if ((options & CAMERA_SHM_OPT_MEMFD) &&
+        fcntl(shmFd_, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == -1)
+    {
+        PLOGW("Fail to seal memfd : %s", strerror(errno));
+    }
+
+    shmAddr_ = mmap(NULL, shmSize_, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd_, 0);
+    if (shmAddr_ == MAP_FAILED)
+    {
+        PLOGE("mmap failed");
+        shmAddr_ = nullptr;
+        ::close(shmFd_);
+        shmFd_ = -1;
+        return false;
+    }
+
+    return true;
+}
+
 int CameraSharedMemoryImpl::open(const std::string name)
 {
     PLOGI("name(%s)", name.c_str());
@@ -168,7 +306,7 @@ bool CameraSharedMemoryImpl::initShmem(int fd)
         PLOGE("Failed to get size of shared memory");
         return false;
     }
-    size_t shmSize_ = sb.st_size;
+    shmSize_ = sb.st_size;
     PLOGI("shm size %zu", shmSize_);
 
     shmAddr_ = (ShmHeader *)mmap(0, shmSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
@@ -179,6 +317,9 @@ bool CameraSharedMemoryImpl::initShmem(int fd)
         return false;
     }
 
+    // no effect on hugetlb or when transparent huge pages are disabled for shmem
+    madvise(shmAddr_, shmSize_, MADV_HUGEPAGE);
+
     shmHeader_ = static_cast<ShmHeader *>(shmAddr_);
     shmFd_     = fd;
 
@@ -188,38 +329,46 @@ bool CameraSharedMemoryImpl::initShmem(int fd)
 
 void CameraSharedMemoryImpl::initBuffers(void)
 {
-    size_t headerSize      = sizeof(ShmHeader);
-    size_t dataSectionSize = shmHeader_->dataSize + shmHeader_->metaSize + shmHeader_->extraSize +
-                             shmHeader_->solutionSize + sizeof(size_t) * 4;
-
-    shmBuffers_.resize(shmHeader_->bufferCount);
-    for (size_t i = 0; i < shmHeader_->bufferCount; ++i)
+    size_t bufferCount     = shmHeader_->bufferCount;
+    size_t headerSize      = headerSectionSize(bufferCount);
+    size_t dataSectionSize = sectionSize(shmHeader_->dataSize) + sectionSize(shmHeader_->metaSize) +
+                             sectionSize(shmHeader_->extraSize) +
+                             sectionSize(shmHeader_->solutionSize);
+
+    ShmSlotState *states = reinterpret_cast<ShmSlotState *>(static_cast<unsigned char *>(shmAddr_) +
+                                                            sizeof(ShmHeader));
+    shmCursors_ = reinterpret_cast<ShmCursor *>(states + bufferCount);
+
+    shmBuffers_.resize(bufferCount);
+    for (size_t i = 0; i < bufferCount; ++i)
     {
         unsigned char *base =
             static_cast<unsigned char *>(shmAddr_) + headerSize + i * dataSectionSize;
 
+        shmBuffers_[i].pState = &states[i];
+
         shmBuffers_[i].pDataSize = reinterpret_cast<size_t *>(base);
-        shmBuffers_[i].pData =
-            reinterpret_cast<unsigned char *>(shmBuffers_[i].pDataSize) + sizeof(size_t);
+        shmBuffers_[i].pData     = base + kShmAlignment;
         shmBuffers_[i].pMetaSize =
-            reinterpret_cast<size_t *>(shmBuffers_[i].pData + shmHeader_->dataSize);
+            reinterpret_cast<size_t *>(shmBuffers_[i].pData + alignUp(shmHeader_->dataSize));
         shmBuffers_[i].pMeta =
-            reinterpret_cast<unsigned char *>(shmBuffers_[i].pMetaSize) + sizeof(size_t);
+            reinterpret_cast<unsigned char *>(shmBuffers_[i].pMetaSize) + kShmAlignment;
         shmBuffers_[i].pExtraSize =
-            reinterpret_cast<size_t *>(shmBuffers_[i].pMeta + shmHeader_->metaSize);
+            reinterpret_cast<size_t *>(shmBuffers_[i].pMeta + alignUp(shmHeader_->metaSize));
         shmBuffers_[i].pExtra =
-            reinterpret_cast<unsigned char *>(shmBuffers_[i].pExtraSize) + sizeof(size_t);
+            reinterpret_cast<unsigned char *>(shmBuffers_[i].pExtraSize) + kShmAlignment;
         shmBuffers_[i].pSolutionSize =
-            reinterpret_cast<size_t *>(shmBuffers_[i].pExtra + shmHeader_->extraSize);
+            reinterpret_cast<size_t *>(shmBuffers_[i].pExtra + alignUp(shmHeader_->extraSize));
         shmBuffers_[i].pSolution =
-            reinterpret_cast<unsigned char *>(shmBuffers_[i].pSolutionSize) + sizeof(size_t);
+            reinterpret_cast<unsigned char *>(shmBuffers_[i].pSolutionSize) + kShmAlignment;
     }
 }
 
 void CameraSharedMemoryImpl::printShmHeader(void)
 {
     PLOGI("bufferCount  : %zu", shmHeader_->bufferCount);
-    PLOGI("writeIndex   : %d", shmHeader_->writeIndex);
+    PLOGI("writeSequence: %llu",
+          (unsigned long long)shmHeader_->writeSequence.load(std::memory_order_acquire));
     PLOGI("dataSize     : %zu", shmHeader_->dataSize);
     PLOGI("metaSize     : %zu", shmHeader_->metaSize);
     PLOGI("extraSize    : %zu", shmHeader_->extraSize);
@@ -232,6 +381,22 @@ void CameraSharedMemoryImpl::close(void)
 
     std::lock_guard<std::mutex> lock(m_);
 
+    if (leaseIndex_ >= 0)
+    {
+        dropLease(leaseIndex_, leaseGeneration_);
+        leaseIndex_ = -1;
+    }
+    // the cursor stays registered until the writer removes it, but no frame is due for it
+    if (shmCursors_ && cursorIndex_ >= 0)
+    {
+        shmCursors_[cursorIndex_].dueTime.store(INT64_MAX);
+        shmCursors_[cursorIndex_].inputWidth.store(0);
+        shmCursors_[cursorIndex_].inputHeight.store(0);
+    }
+    shmBuffers_.clear();
+    shmCursors_  = nullptr;
+    cursorIndex_ = -1;
+
     if (shmHeader_)
     {
         shmHeader_ = nullptr;
@@ -256,25 +421,6 @@ void CameraSharedMemoryImpl::close(void)
     PLOGI("end");
 }
 
-bool CameraSharedMemoryImpl::incrementWriteIndex(void)
-{
-    std::lock_guard<std::mutex> lock(m_);
-
-    if (!shmHeader_)
-    {
-        PLOGE("shmHeader_ is NULL");
-        return false;
-    }
-
-    if (shmHeader_->writeIndex < INT_MAX)
-        shmHeader_->writeIndex++;
-    if (shmHeader_->writeIndex >= (int)shmHeader_->bufferCount)
-        shmHeader_->writeIndex = 0;
-
-    PLOGD("writeIndex(%d)", shmHeader_->writeIndex);
-    return true;
-}
-
 bool CameraSharedMemoryImpl::writeHeader(int index, size_t dataSize)
 {
     PLOGD("index(%d) dataSize(%zu)", index, dataSize);
@@ -293,12 +439,32 @@ bool CameraSharedMemoryImpl::writeHeader(int index, size_t dataSize)
         return false;
     }
 
-    shmHeader_->writeIndex        = index;
     *shmBuffers_[index].pDataSize = dataSize;
+    publish(index);
 
     return true;
 }
 
+void CameraSharedMemoryImpl::publish(int index)
+{
+    uint64_t writeSequence = shmHeader_->writeSequence.load(std::memory_order_relaxed);
+    uint64_t count         = (writeSequence >> SHM_SLOT_INDEX_BITS) + 1;
+
+    // the slot sequence becomes even and differs from any lease taken before
+    ShmSlotState *state = shmBuffers_[index].pState;
+    uint32_t sequence   = state->sequence.load(std::memory_order_relaxed);
+    state->frame.store(count, std::memory_order_relaxed);
+    state->sequence.store((sequence & 1) ? sequence + 1 : sequence + 2, std::memory_order_release);
+
+    // then the slot becomes the latest frame
+    shmHeader_->writeSequence.store((count << SHM_SLOT_INDEX_BITS) | (uint64_t)index,
+                                    std::memory_order_release);
+
+    // readers in waitForFrame() wake up on the frame itself, notifySignal() is for the eventfds
+    shmHeader_->frameSequence.fetch_add(1);
+    futexWakeAll(&shmHeader_->frameSequence);
+}
+
 bool CameraSharedMemoryImpl::getBufferList(std::vector<void *> *pDataList,
                                            std::vector<void *> *pMetaList,
                                            std::vector<void *> *pExtraList,
@@ -364,30 +530,33 @@ bool CameraSharedMemoryImpl::read(unsigned char **ppData, size_t *pDataSize, uns
 {
     PLOGD("timeout %d ms", timeoutMs);
 
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
     if (!skipSignal)
     {
-        if (!waitForSignal(timeoutMs))
+        if (!waitForFrame(timeoutMs))
         {
-            PLOGE("waitForSignal() fail");
+            PLOGE("waitForFrame() fail");
             return false;
         }
+        // keep the eventfd of poll() users in step with the frames consumed here
+        drainSignal("default");
     }
 
-    const int maxRetries = 100;
-    for (int retry = 0; retry <= maxRetries; retry++)
-    {
-        if (readData(ppData, pDataSize, ppMeta, pMetaSize, ppExtra, pExtraSize, ppSolution,
+    while (!readData(ppData, pDataSize, ppMeta, pMetaSize, ppExtra, pExtraSize, ppSolution,
                      pSolutionSize))
+    {
+        // nothing published yet or the writer owns the slot : retry on the next frame
+        if (!waitForFrame(remainingMs(timeoutMs, deadline)))
         {
-            PLOGD("read done! data(%p) length(%zu)", *ppData, *pDataSize);
-            return true;
+            PLOGE("readData Fail!");
+            return false;
         }
-
-        usleep(10000);
-        PLOGI("readData Fail! retry(%d/%d)", retry, maxRetries);
     }
 
-    return false;
+    PLOGD("read done! data(%p) length(%zu)", ppData ? *ppData : nullptr,
+          pDataSize ? *pDataSize : 0);
+    return true;
 }
 
 bool CameraSharedMemoryImpl::readData(unsigned char **ppData, size_t *pDataSize,
@@ -395,27 +564,68 @@ bool CameraSharedMemoryImpl::readData(unsigned char **ppData, size_t *pDataSize,
                                       unsigned char **ppExtra, size_t *pExtraSize,
                                       unsigned char **ppSolution, size_t *pSolutionSize)
 {
-    std::lock_guard<std::mutex> lock(m_);
-
+    // the lease and cursor state belongs to the thread of the reader, no lock is taken here
     if (!shmHeader_)
     {
         PLOGE("shmHeader_ is NULL");
         return false;
     }
 
-    if (shmHeader_->writeIndex == -1)
+    uint64_t writeSequence = shmHeader_->writeSequence.load(std::memory_order_acquire);
+    if (writeSequence == 0)
     {
         PLOGE("No data has been written yet.");
         return false;
     }
 
-    int readIndex =
-        (shmHeader_->writeIndex + shmHeader_->bufferCount - 1) % shmHeader_->bufferCount;
-    PLOGD("writeIndex(%d) readIndex(%d)", shmHeader_->writeIndex, readIndex);
+    int readIndex  = (int)(writeSequence & SHM_SLOT_INDEX_MASK);
+    uint64_t count = writeSequence >> SHM_SLOT_INDEX_BITS;
+    PLOGD("count(%llu) readIndex(%d)", (unsigned long long)count, readIndex);
+
+    if (cursorIndex_ >= 0 &&
+        shmCursors_[cursorIndex_].policy.load(std::memory_order_relaxed) == CAMERA_SHM_READ_NEXT)
+    {
+        uint64_t next = shmCursors_[cursorIndex_].readSequence.load(std::memory_order_relaxed) + 1;
+        if (next > count)
+        {
+            PLOGD("frame %llu is not published yet", (unsigned long long)next);
+            return false;
+        }
+        // the oldest frame still in the ring when next has been overwritten
+        int index = findFrame(next);
+        if (index < 0)
+        {
+            PLOGD("frames from %llu are owned by the writer", (unsigned long long)next);
+            return false;
+        }
+        readIndex = index;
+    }
+
+    // the frame of the previous read() is not used anymore
+    if (leaseIndex_ >= 0)
+    {
+        dropLease(leaseIndex_, leaseGeneration_);
+        leaseIndex_ = -1;
+    }
+
+    uint32_t sequence   = 0;
+    uint32_t generation = 0;
+    if (!tryLease(readIndex, &sequence, &generation))
+    {
+        PLOGD("slot %d is owned by the writer", readIndex);
+        return false;
+    }
+    leaseIndex_      = readIndex;
+    leaseSequence_   = sequence;
+    leaseGeneration_ = generation;
+    if (cursorIndex_ >= 0)
+        updateCursor(shmBuffers_[readIndex].pState->frame.load(std::memory_order_relaxed));
+
     const ShmBuffer &buffer = shmBuffers_[readIndex];
 
+    // No data section (dmabuf mode) : the frame is in the exported buffer, the size is valid.
     if (ppData)
-        *ppData = buffer.pData;
+        *ppData = (shmHeader_->dataSize > 0) ? buffer.pData : nullptr;
     if (pDataSize)
         *pDataSize = *buffer.pDataSize;
     if (ppMeta)
@@ -450,9 +660,25 @@ bool CameraSharedMemoryImpl::write(const unsigned char *pData, size_t dataSize,
         return false;
     }
 
-    if (shmHeader_->writeIndex < 0) // first write
-        shmHeader_->writeIndex = 0;
-    ShmBuffer &buffer = shmBuffers_[shmHeader_->writeIndex];
+    // The first slot after the latest frame which no reader holds. When readers hold all of
+    // them but the latest, the one right after the latest frame is taken back.
+    uint64_t writeSequence = shmHeader_->writeSequence.load(std::memory_order_relaxed);
+    int count              = (int)shmHeader_->bufferCount;
+    int first              = 0;
+    int index              = -1;
+    if (writeSequence != 0)
+        first = (int)(((writeSequence & SHM_SLOT_INDEX_MASK) + 1) % count);
+    for (int i = 0; i < ((writeSequence != 0) ? count - 1 : count) && index < 0; i++)
+    {
+        if (lockSlot((first + i) % count, false))
+            index = (first + i) % count;
+    }
+    if (index < 0)
+    {
+        lockSlot(first, true);
+        index = first;
+    }
+    ShmBuffer &buffer = shmBuffers_[index];
 
     if (pData)
     {
@@ -478,7 +704,7 @@ bool CameraSharedMemoryImpl::write(const unsigned char *pData, size_t dataSize,
         memcpy(buffer.pSolution, pSolution, solutionSize);
     }
 
-    shmHeader_->writeIndex = (shmHeader_->writeIndex + 1) % shmHeader_->bufferCount;
+    publish(index);
 
     return true;
 }
@@ -570,69 +796,528 @@ void CameraSharedMemoryImpl::releaseAllSignals(void)
 
 bool CameraSharedMemoryImpl::waitForSignal(int timeoutMs, const std::string &name)
 {
-    std::unique_lock<std::mutex> lock(m_);
+    int efd = -1;
+    {
+        std::lock_guard<std::mutex> lock(m_);
 
-    PLOGD("name(%s) (timeout %d ms)", name.c_str(), timeoutMs);
+        PLOGD("name(%s) (timeout %d ms)", name.c_str(), timeoutMs);
 
-    if (signalFdMap_.find(name) == signalFdMap_.end())
+        auto it = signalFdMap_.find(name);
+        if (it == signalFdMap_.end())
+        {
+            PLOGE("unknown signal name(%s)", name.c_str());
+            return false;
+        }
+        efd = it->second;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    // The eventfd is shared with other readers : it may be drained between poll() and read(),
+    // in which case wait again for the time left.
+    while (true)
     {
-        PLOGE("unknown signal name(%s)", name.c_str());
-        return false;
+        struct pollfd fds = {efd, POLLIN, 0};
+
+        PLOGD("name(%s) start waiting for eventfd (%d)", name.c_str(), efd);
+        int ret = poll(&fds, 1, remainingMs(timeoutMs, deadline));
+        if (ret == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            PLOGE("Poll failure: %s", strerror(errno));
+            return false;
+        }
+        else if (ret == 0)
+        {
+            PLOGE("Timeout! No data available to read from eventfd");
+            return false;
+        }
+
+        if (!(fds.revents & POLLIN))
+        {
+            PLOGE("POLLIN event did not occur!");
+            return false;
+        }
+
+        uint64_t value;
+        if (::read(efd, &value, sizeof(value)) == sizeof(value))
+        {
+            PLOGD("Read %llu from eventfd (%d)", (unsigned long long)value, efd);
+            return true;
+        }
+        if (errno != EAGAIN && errno != EINTR)
+        {
+            PLOGE("Read failure: %s", strerror(errno));
+            return false;
+        }
+    }
+}
+
+bool CameraSharedMemoryImpl::waitForFrame(int timeoutMs)
+{
+    std::atomic<uint32_t> *pFrameSequence = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_);
+
+        if (!shmHeader_)
+        {
+            PLOGE("shmHeader_ is NULL");
+            return false;
+        }
+        pFrameSequence = &shmHeader_->frameSequence;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    while (true)
+    {
+        uint32_t sequence = pFrameSequence->load();
+        if (sequence != lastFrameSequence_)
+        {
+            lastFrameSequence_ = sequence;
+            return true;
+        }
+
+        int leftMs = remainingMs(timeoutMs, deadline);
+        if (leftMs == 0)
+        {
+            PLOGE("Timeout! No frame published for %d ms", timeoutMs);
+            return false;
+        }
+
+        struct timespec timeout = {leftMs / 1000, (leftMs % 1000) * 1000000L};
+        if (futexWait(pFrameSequence, sequence, (leftMs < 0) ? nullptr : &timeout) == -1 &&
+            errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT)
+        {
+            PLOGE("futex wait failure: %s", strerror(errno));
+            return false;
+        }
+    }
+}
+
+void CameraSharedMemoryImpl::drainSignal(const std::string &name)
+{
+    int efd = -1;
+    {
+        std::lock_guard<std::mutex> lock(m_);
+
+        auto it = signalFdMap_.find(name);
+        if (it == signalFdMap_.end())
+            return;
+        efd = it->second;
     }
-    int efd = signalFdMap_[name];
 
     struct pollfd fds = {efd, POLLIN, 0};
+    if (poll(&fds, 1, 0) == 1 && (fds.revents & POLLIN))
+    {
+        uint64_t value;
+        if (::read(efd, &value, sizeof(value)) != sizeof(value))
+            PLOGD("eventfd (%d) already drained", efd);
+    }
+}
+
+int CameraSharedMemoryImpl::getWriteIndex(void)
+{
+    std::lock_guard<std::mutex> lock(m_);
 
-    PLOGD("name(%s) start waiting for eventfd (%d) (timeout %d ms)", name.c_str(), efd, timeoutMs);
-    int ret = poll(&fds, 1, timeoutMs);
-    if (ret == -1)
+    if (!shmHeader_)
     {
-        PLOGE("Poll failure: %s", strerror(errno));
+        PLOGE("shmHeader_ is NULL");
         return false;
     }
-    else if (ret == 0)
+
+    // the slot following the latest frame, -1 before the first frame
+    uint64_t writeSequence = shmHeader_->writeSequence.load(std::memory_order_acquire);
+    if (writeSequence == 0)
+        return -1;
+
+    int writeIndex =
+        (int)(((writeSequence & SHM_SLOT_INDEX_MASK) + 1) % shmHeader_->bufferCount);
+    PLOGD("writeIndex(%d)", writeIndex);
+    return writeIndex;
+}
+
+bool CameraSharedMemoryImpl::tryLease(int index, uint32_t *pSequence, uint32_t *pGeneration)
+{
+    ShmSlotState *state = shmBuffers_[index].pState;
+
+    // Register as a reader first, then check the owner. The writer does the opposite in
+    // lockSlotForWrite(), so at least one side always sees the other.
+    uint32_t generation = SHM_LEASE_GENERATION(state->leases.fetch_add(1));
+    uint32_t sequence   = state->sequence.load();
+    if (sequence & 1)
     {
-        PLOGE("Timeout! No data available to read from eventfd");
+        dropLease(index, generation);
         return false;
     }
 
-    if (!(fds.revents & POLLIN))
+    *pSequence   = sequence;
+    *pGeneration = generation;
+    return true;
+}
+
+void CameraSharedMemoryImpl::dropLease(int index, uint32_t generation)
+{
+    ShmSlotState *state = shmBuffers_[index].pState;
+
+    // a lease taken back by a forced reclaim is not counted anymore
+    uint64_t leases = state->leases.load();
+    while (SHM_LEASE_GENERATION(leases) == generation && SHM_LEASE_READERS(leases) > 0 &&
+           !state->leases.compare_exchange_weak(leases, leases - 1))
     {
-        PLOGE("POLLIN event did not occur!");
+    }
+}
+
+bool CameraSharedMemoryImpl::acquireSlot(int index, uint32_t *pSequence, uint32_t *pGeneration)
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (!shmHeader_ || index < 0 || index >= (int)shmBuffers_.size())
+    {
+        PLOGE("invalid slot %d", index);
         return false;
     }
 
-    // lock.unlock(); static issue impact: Medium. desc: Double unlock(LOCK)
+    return tryLease(index, pSequence, pGeneration);
+}
+
+void CameraSharedMemoryImpl::releaseSlot(int index, uint32_t generation)
+{
+    std::lock_guard<std::mutex> lock(m_);
 
-    uint64_t value;
-    for (int retry = 0; retry < 100; ++retry)
+    if (!shmHeader_ || index < 0 || index >= (int)shmBuffers_.size())
     {
-        if (::read(efd, &value, sizeof(value)) == sizeof(value))
+        PLOGE("invalid slot %d", index);
+        return;
+    }
+
+    dropLease(index, generation);
+}
+
+bool CameraSharedMemoryImpl::isSlotValid(int index, uint32_t sequence)
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (!shmHeader_ || index < 0 || index >= (int)shmBuffers_.size())
+        return false;
+
+    return shmBuffers_[index].pState->sequence.load() == sequence;
+}
+
+bool CameraSharedMemoryImpl::release(void)
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (!shmHeader_ || leaseIndex_ < 0)
+        return false;
+
+    dropLease(leaseIndex_, leaseGeneration_);
+    leaseIndex_ = -1;
+    return true;
+}
+
+bool CameraSharedMemoryImpl::isValid(void)
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (!shmHeader_ || leaseIndex_ < 0)
+        return false;
+
+    return shmBuffers_[leaseIndex_].pState->sequence.load() == leaseSequence_;
+}
+
+int CameraSharedMemoryImpl::getReadIndex(void)
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    return (shmHeader_) ? leaseIndex_ : -1;
+}
+
+bool CameraSharedMemoryImpl::lockSlotForWrite(int index, bool force)
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (!shmHeader_ || index < 0 || index >= (int)shmBuffers_.size())
+    {
+        PLOGE("invalid slot %d", index);
+        return false;
+    }
+
+    return lockSlot(index, force);
+}
+
+bool CameraSharedMemoryImpl::lockSlot(int index, bool force)
+{
+    ShmSlotState *state = shmBuffers_[index].pState;
+    uint32_t sequence   = state->sequence.load();
+    if (!(sequence & 1))
+        state->sequence.store(sequence + 1);
+
+    uint64_t leases = state->leases.load();
+    if (SHM_LEASE_READERS(leases) > 0)
+    {
+        if (!force)
         {
-            PLOGD("Read %llu from eventfd (%d)", (unsigned long long)value, efd);
-            return true;
+            // still in use, give the frame back to the readers unchanged
+            state->sequence.store(sequence);
+            return false;
         }
-        PLOGE("Read failure, retrying...");
+        PLOGW("slot %d : reclaim the lease of %u reader(s)", index, SHM_LEASE_READERS(leases));
 
-        lock.unlock(); // Unlock the mutex before sleeping
-        usleep(1000);
-        lock.lock(); // Re-lock the mutex after sleeping
+        // The evicted readers find the slot sequence changed, and their leases of the old
+        // generation no longer count against the readers leasing the slot from now on.
+        uint64_t next = (uint64_t)(SHM_LEASE_GENERATION(leases) + 1) << 32;
+        while (!state->leases.compare_exchange_weak(leases, next))
+        {
+            next = (uint64_t)(SHM_LEASE_GENERATION(leases) + 1) << 32;
+        }
     }
 
-    PLOGE("Read retry failed!");
+    return true;
+}
+
+int CameraSharedMemoryImpl::findFrame(uint64_t frame)
+{
+    int index       = -1;
+    uint64_t oldest = UINT64_MAX;
+    for (size_t i = 0; i < shmBuffers_.size(); ++i)
+    {
+        ShmSlotState *state = shmBuffers_[i].pState;
+        if (state->sequence.load(std::memory_order_acquire) & 1)
+            continue;
+
+        uint64_t slotFrame = state->frame.load(std::memory_order_relaxed);
+        if (slotFrame >= frame && slotFrame < oldest)
+        {
+            oldest = slotFrame;
+            index  = (int)i;
+        }
+    }
+    return index;
+}
+
+void CameraSharedMemoryImpl::updateCursor(uint64_t frame)
+{
+    ShmCursor &cursor = shmCursors_[cursorIndex_];
+    uint64_t previous = cursor.readSequence.load(std::memory_order_relaxed);
+
+    if (frame == previous)
+    {
+        cursor.duplicated.fetch_add(1, std::memory_order_relaxed);
+    }
+    else if (frame > previous + 1)
+    {
+        // the frames the writer overwrote, or the reader skipped, are reported as dropped
+        if (frame - previous > shmHeader_->bufferCount)
+            PLOGW("lapped : %llu frames published since the previous read",
+                  (unsigned long long)(frame - previous));
+        cursor.dropped.fetch_add(frame - previous - 1, std::memory_order_relaxed);
+    }
+
+    if (frame > previous)
+        cursor.readSequence.store(frame, std::memory_order_relaxed);
+}
+
+int CameraSharedMemoryImpl::addCursor(int clientId)
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (!shmCursors_)
+    {
+        PLOGE("shmCursors_ is NULL");
+        return -1;
+    }
+
+    int freeIndex = -1;
+    for (int i = 0; i < SHM_MAX_CURSORS; ++i)
+    {
+        int32_t id = shmCursors_[i].clientId.load();
+        if (id == clientId)
+        {
+            PLOGI("client %d already has cursor %d", clientId, i);
+            return i;
+        }
+        if (id == -1 && freeIndex < 0)
+            freeIndex = i;
+    }
+    if (freeIndex < 0)
+    {
+        PLOGE("no free cursor for client %d", clientId);
+        return -1;
+    }
+
+    // frames published before the client joined are neither dropped nor due
+    ShmCursor &cursor = shmCursors_[freeIndex];
+    cursor.policy.store(CAMERA_SHM_READ_LATEST);
+    cursor.readSequence.store(shmHeader_->writeSequence.load(std::memory_order_acquire) >>
+                              SHM_SLOT_INDEX_BITS);
+    cursor.dropped.store(0);
+    cursor.duplicated.store(0);
+    cursor.dueTime.store(INT64_MAX);
+    cursor.inputWidth.store(0);
+    cursor.inputHeight.store(0);
+    cursor.clientId.store(clientId, std::memory_order_release);
+
+    PLOGI("client %d : cursor %d", clientId, freeIndex);
+    return freeIndex;
+}
+
+void CameraSharedMemoryImpl::removeCursor(int clientId)
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (!shmCursors_)
+        return;
+
+    for (int i = 0; i < SHM_MAX_CURSORS; ++i)
+    {
+        ShmCursor &cursor = shmCursors_[i];
+        if (cursor.clientId.load() != clientId)
+            continue;
+
+        PLOGI("client %d : read %llu dropped %llu duplicated %llu", clientId,
+              (unsigned long long)cursor.readSequence.load(),
+              (unsigned long long)cursor.dropped.load(),
+              (unsigned long long)cursor.duplicated.load());
+        cursor.clientId.store(-1, std::memory_order_release);
+    }
+}
+
+void CameraSharedMemoryImpl::printCursorStats(void)
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (!shmCursors_)
+        return;
+
+    for (int i = 0; i < SHM_MAX_CURSORS; ++i)
+    {
+        ShmCursor &cursor = shmCursors_[i];
+        int32_t clientId  = cursor.clientId.load(std::memory_order_acquire);
+        if (clientId == -1)
+            continue;
+
+        PLOGI("client %d : policy %u read %llu dropped %llu duplicated %llu", clientId,
+              cursor.policy.load(), (unsigned long long)cursor.readSequence.load(),
+              (unsigned long long)cursor.dropped.load(),
+              (unsigned long long)cursor.duplicated.load());
+    }
+}
+
+bool CameraSharedMemoryImpl::attachCursor(int clientId, int policy)
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (!shmCursors_)
+    {
+        PLOGE("shmCursors_ is NULL");
+        return false;
+    }
+
+    for (int i = 0; i < SHM_MAX_CURSORS; ++i)
+    {
+        if (shmCursors_[i].clientId.load(std::memory_order_acquire) == clientId)
+        {
+            shmCursors_[i].policy.store((uint32_t)policy);
+            shmCursors_[i].dueTime.store(0);
+            shmCursors_[i].inputWidth.store(UINT32_MAX);
+            shmCursors_[i].inputHeight.store(UINT32_MAX);
+            cursorIndex_ = i;
+            PLOGI("client %d : cursor %d policy %d", clientId, i, policy);
+            return true;
+        }
+    }
+
+    PLOGE("no cursor registered for client %d", clientId);
     return false;
 }
 
-int CameraSharedMemoryImpl::getWriteIndex(void)
+bool CameraSharedMemoryImpl::getReadStats(uint64_t *pDropped, uint64_t *pDuplicated)
 {
     std::lock_guard<std::mutex> lock(m_);
 
-    if (!shmHeader_)
+    if (!shmCursors_ || cursorIndex_ < 0)
+        return false;
+
+    if (pDropped)
+        *pDropped = shmCursors_[cursorIndex_].dropped.load(std::memory_order_relaxed);
+    if (pDuplicated)
+        *pDuplicated = shmCursors_[cursorIndex_].duplicated.load(std::memory_order_relaxed);
+    return true;
+}
+
+bool CameraSharedMemoryImpl::setFrameDue(int64_t dueTime)
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (!shmCursors_ || cursorIndex_ < 0)
+        return false;
+
+    shmCursors_[cursorIndex_].dueTime.store(dueTime, std::memory_order_relaxed);
+    return true;
+}
+
+bool CameraSharedMemoryImpl::isFrameDue(int64_t now)
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (!shmCursors_)
+        return false;
+
+    for (int i = 0; i < SHM_MAX_CURSORS; ++i)
     {
-        PLOGE("shmHeader_ is NULL");
+        ShmCursor &cursor = shmCursors_[i];
+        if (cursor.clientId.load(std::memory_order_acquire) == -1)
+            continue;
+        if (cursor.dueTime.load(std::memory_order_relaxed) <= now)
+            return true;
+    }
+    return false;
+}
+
+bool CameraSharedMemoryImpl::setInputSize(uint32_t width, uint32_t height)
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (!shmCursors_ || cursorIndex_ < 0)
         return false;
+
+    // 0 would read as a cursor without a reader
+    shmCursors_[cursorIndex_].inputWidth.store((width > 0) ? width : UINT32_MAX);
+    shmCursors_[cursorIndex_].inputHeight.store((height > 0) ? height : UINT32_MAX);
+    return true;
+}
+
+bool CameraSharedMemoryImpl::getInputSize(uint32_t *pWidth, uint32_t *pHeight)
+{
+    std::lock_guard<std::mutex> lock(m_);
+
+    if (!shmCursors_)
+        return false;
+
+    bool found      = false;
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    for (int i = 0; i < SHM_MAX_CURSORS; ++i)
+    {
+        ShmCursor &cursor = shmCursors_[i];
+        if (cursor.clientId.load(std::memory_order_acquire) == -1)
+            continue;
+
+        uint32_t inputWidth  = cursor.inputWidth.load(std::memory_order_relaxed);
+        uint32_t inputHeight = cursor.inputHeight.load(std::memory_order_relaxed);
+        if (inputWidth == 0 || inputHeight == 0)
+            continue;
+
+        width  = std::max(width, inputWidth);
+        height = std::max(height, inputHeight);
+        found  = true;
     }
 
-    PLOGD("writeIndex(%d)", shmHeader_->writeIndex);
-    return shmHeader_->writeIndex;
+    if (pWidth)
+        *pWidth = width;
+    if (pHeight)
+        *pHeight = height;
+    return found;
 }
@@ -16,17 +16,63 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <map>
 #include <mutex>
 #include <pthread.h>
 #include <string>
 #include <vector>
 
-#pragma pack(push, 4)
-struct ShmHeader
+// Lease state of a slot, shared by the writer and the readers.
+// sequence : even while the slot holds a published frame, odd while the writer owns it.
+// leases   : generation in the upper 32 bits, number of readers holding a lease on the slot
+//            in the lower ones. A forced reclaim starts a new generation with no reader, the
+//            leases of the previous one are then ignored when they are released.
+// frame    : count of the frame held by the slot, see ShmHeader::writeSequence.
+#define SHM_LEASE_GENERATION(leases) ((uint32_t)((leases) >> 32))
+#define SHM_LEASE_READERS(leases) ((uint32_t)((leases)&0xffffffffu))
+struct ShmSlotState
+{
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint64_t> leases;
+    std::atomic<uint64_t> frame;
+};
+
+// Read cursor of a client, reserved by the writer in addCursor() and used by the reader
+// attached to it. The reader updates the counters, the writer only reports them.
+// dueTime : monotonic time in microseconds from which the reader takes its next frame. 0 takes
+// every frame, INT64_MAX until a reader attaches. A writer may skip frames no reader is due for.
+// inputWidth, inputHeight : smallest frame the reader works on. 0 until a reader attaches,
+// UINT32_MAX for the full size. A writer that scales its frames may make them that small.
+#define SHM_MAX_CURSORS 16
+struct ShmCursor
+{
+    std::atomic<int32_t> clientId; // -1 : free
+    std::atomic<uint32_t> policy;  // CameraShmReadPolicy
+    std::atomic<uint64_t> readSequence;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> duplicated;
+    std::atomic<int64_t> dueTime;
+    std::atomic<uint32_t> inputWidth;
+    std::atomic<uint32_t> inputHeight;
+};
+
+// Latest published frame : count of published frames in the upper bits, slot index in the
+// lower SHM_SLOT_INDEX_BITS bits. 0 until the first frame is published.
+#define SHM_SLOT_INDEX_BITS 8
+#define SHM_SLOT_INDEX_MASK ((1u << SHM_SLOT_INDEX_BITS) - 1)
+#define SHM_MAX_BUFFER_COUNT (1u << SHM_SLOT_INDEX_BITS)
+
+// Shared by a single writer and any number of readers in other processes. writeSequence is
+// stored with release and loaded with acquire ordering, the other fields do not change after
+// create().
+struct alignas(64) ShmHeader
 {
-    int writeIndex;
+    std::atomic<uint64_t> writeSequence;
+    // futex word, incremented each time a frame is published
+    std::atomic<uint32_t> frameSequence;
     size_t bufferCount;
     size_t dataSize;
     size_t metaSize;
@@ -34,6 +80,7 @@ struct ShmHeader
     size_t solutionSize;
 };
 
+#pragma pack(push, 4)
 struct ShmBuffer
 {
     size_t *pDataSize;
@@ -44,6 +91,7 @@ struct ShmBuffer
     unsigned char *pExtra;
     size_t *pSolutionSize;
     unsigned char *pSolution;
+    ShmSlotState *pState;
 };
 #pragma pack(pop)
 
@@ -54,12 +102,11 @@ public:
     ~CameraSharedMemoryImpl();
 
     int create(const std::string name, size_t dataSize, size_t metaSize, size_t extraSize,
-               size_t solutionSize, size_t bufferCount);
+               size_t solutionSize, size_t bufferCount, unsigned int options = 0);
     bool open(int fd);
     int open(const std::string name);
     void close(void);
 
-    bool incrementWriteIndex(void);
     bool writeHeader(int index, size_t dataSize);
     bool getBufferList(std::vector<void *> *pDataList, std::vector<void *> *pMetaList,
                        std::vector<void *> *pExtraList, std::vector<void *> *pSolutionList);
@@ -75,21 +122,60 @@ public:
     int createSignal(const std::string &name = std::string("default"));
     bool notifySignal(void);
     bool waitForSignal(int timeoutMs = 10000, const std::string &name = std::string("default"));
+    // reader : sleeps until a frame newer than the last one seen is published
+    bool waitForFrame(int timeoutMs = 10000);
     bool attachSignal(int fd, const std::string &name = std::string("default"));
     bool detachSignal(const std::string &name = std::string("default"));
     void releaseAllSignals(void);
     int getWriteIndex(void);
 
+    // reader : lease on a slot, the writer does not reuse it until released
+    // pGeneration identifies the lease for releaseSlot()
+    bool acquireSlot(int index, uint32_t *pSequence, uint32_t *pGeneration);
+    void releaseSlot(int index, uint32_t generation);
+    bool isSlotValid(int index, uint32_t sequence);
+    // reader : lease taken by read(), held until the next read(), release() or close()
+    bool release(void);
+    bool isValid(void);
+    // reader : slot of the lease taken by read(), -1 without one
+    int getReadIndex(void);
+    // writer : take the slot back, fails while a reader holds it unless forced
+    bool lockSlotForWrite(int index, bool force = false);
+
+    // writer : per-client read cursors
+    int addCursor(int clientId);
+    void removeCursor(int clientId);
+    void printCursorStats(void);
+    // reader : read() follows the cursor of clientId with the given policy
+    bool attachCursor(int clientId, int policy);
+    bool getReadStats(uint64_t *pDropped, uint64_t *pDuplicated);
+    // reader : time from which the attached cursor takes its next frame, 0 for every frame
+    bool setFrameDue(int64_t dueTime);
+    // writer : whether a reader attached to a cursor takes a frame published at now
+    bool isFrameDue(int64_t now);
+    // reader : smallest frame the attached cursor works on, 0 for the full size
+    bool setInputSize(uint32_t width, uint32_t height);
+    // writer : largest of the sizes the attached readers work on, false without a reader
+    bool getInputSize(uint32_t *pWidth, uint32_t *pHeight);
+
 private:
+    bool mapMemory(const std::string &name, unsigned int options, bool hugetlb);
     bool initShmem(int fd);
     void initBuffers(void);
     void printShmHeader(void);
     bool readData(unsigned char **ppData, size_t *pDataSize, unsigned char **ppMeta,
                   size_t *pMetaSize, unsigned char **ppExtra, size_t *pExtraSize,
                   unsigned char **ppSolution, size_t *pSolutionSize);
+    void drainSignal(const std::string &name);
+    void publish(int index);
+    int findFrame(uint64_t frame);
+    void updateCursor(uint64_t frame);
+    bool tryLease(int index, uint32_t *pSequence, uint32_t *pGeneration);
+    void dropLease(int index, uint32_t generation);
+    bool lockSlot(int index, bool force);
 
 private:
-    std::mutex m_;
+    std::mutex m_; // process-local state, the shared memory is ordered by its atomics
     bool isCreated_{false};
     int shmFd_;
     std::string shmName_{""};
@@ -97,6 +183,15 @@ private:
     size_t shmSize_;
     ShmHeader *shmHeader_;
     std::vector<ShmBuffer> shmBuffers_;
+    ShmCursor *shmCursors_{nullptr};
+
+    // State of the reader. read(), attachCursor(), release() and close() are not called
+    // concurrently, so read() runs without m_.
+    int cursorIndex_{-1};
+    int leaseIndex_{-1};
+    uint32_t leaseSequence_{0};
+    uint32_t leaseGeneration_{0};
+    uint32_t lastFrameSequence_{0};
 
     uint64_t eventValue_{0};
     std::map<std::string, int> signalFdMap_;
@@ -16,10 +16,19 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
+// create() options
+// HUGEPAGE : back the memory with huge pages (hugetlb with MEMFD, transparent otherwise)
+// MEMFD    : anonymous sealed memfd instead of a /dev/shm name, reachable only through the fd
+// PREFAULT : fault in and lock the pages at creation
+#define CAMERA_SHM_OPT_HUGEPAGE (1u << 0)
+#define CAMERA_SHM_OPT_MEMFD (1u << 1)
+#define CAMERA_SHM_OPT_PREFAULT (1u << 2)
+
 class CameraSharedMemoryImpl;
 class CameraSharedMemoryEx
 {
@@ -28,11 +37,10 @@ public:
     ~CameraSharedMemoryEx();
 
     int create(const std::string name, size_t dataSize, size_t metaSize, size_t extraSize,
-               size_t solutionSize, size_t bufferCount);
+               size_t solutionSize, size_t bufferCount, unsigned int options = 0);
     bool open(int fd);
     int open(const std::string name);
     void close(void);
-    bool incrementWriteIndex(void);
     bool writeHeader(int index, size_t dataSize);
     bool getBufferList(std::vector<void *> *pDataList, std::vector<void *> *pMetaList,
                        std::vector<void *> *pExtraList, std::vector<void *> *pSolutionList);
@@ -54,6 +62,24 @@ public:
     void releaseAllSignals(void);
     int getWriteIndex(void);
 
+    bool acquireSlot(int index, uint32_t *pSequence, uint32_t *pGeneration);
+    void releaseSlot(int index, uint32_t generation);
+    bool isSlotValid(int index, uint32_t sequence);
+    bool release(void);
+    bool isValid(void);
+    int getReadIndex(void);
+    bool lockSlotForWrite(int index, bool force = false);
+
+    int addCursor(int clientId);
+    void removeCursor(int clientId);
+    void printCursorStats(void);
+    bool attachCursor(int clientId, int policy);
+    bool getReadStats(uint64_t *pDropped, uint64_t *pDuplicated);
+    bool setFrameDue(int64_t dueTime);
+    bool isFrameDue(int64_t now);
+    bool setInputSize(uint32_t width, uint32_t height);
+    bool getInputSize(uint32_t *pWidth, uint32_t *pHeight);
+
 private:
     std::unique_ptr<CameraSharedMemoryImpl> pImpl_;
 };
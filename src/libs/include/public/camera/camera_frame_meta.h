@@ -0,0 +1,49 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define CAMERA_FRAME_META_VERSION 1
+
+// the solution section was rewritten for this frame
+#define CAMERA_FRAME_META_FLAG_SOLUTION_UPDATED (1u << 0)
+// the frame is in the exported dmabuf, not in the shared memory
+#define CAMERA_FRAME_META_FLAG_DMABUF (1u << 1)
+
+// Per-frame metadata written in place into the meta section of each shared memory slot.
+// Fields are only appended, readers check version before using them.
+struct alignas(64) CameraFrameMeta
+{
+    uint32_t version;
+    uint32_t flags;
+    uint32_t format; // camera_pixel_format_t
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride; // bytes per line, 0 for encoded formats
+    uint64_t size;
+    uint64_t timestamp; // capture time from the driver in microseconds
+    uint32_t sequence;
+    uint32_t reserved[5];
+};
+
+static_assert(sizeof(CameraFrameMeta) == 64, "CameraFrameMeta must fit in one cache line");
+
+// Returns the metadata as JSON, or an empty string if pMeta does not hold a known version.
+std::string cameraFrameMetaToJson(const unsigned char *pMeta, size_t metaSize);
@@ -16,8 +16,19 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 
+// CAMERA_SHM_READ_LATEST : read() returns the newest frame, older ones are skipped.
+// CAMERA_SHM_READ_NEXT   : read() returns the frame following the previous one while it is
+//                          still in the ring. Else the oldest one left, the frames the writer
+//                          overwrote count as dropped in getReadStats().
+enum CameraShmReadPolicy
+{
+    CAMERA_SHM_READ_LATEST = 0,
+    CAMERA_SHM_READ_NEXT
+};
+
 class CameraSharedMemoryImpl;
 class CameraSharedMemory
 {
@@ -25,10 +36,19 @@ public:
     CameraSharedMemory();
     ~CameraSharedMemory();
 
+    // read(), release(), attachCursor() and close() of an object are not called concurrently.
     bool open(int bufferFd, int signalFd);
     bool read(unsigned char **ppData, size_t *pDataSize, unsigned char **ppMeta, size_t *pMetaSize,
               unsigned char **ppExtra, size_t *pExtraSize, unsigned char **ppSolution,
               size_t *pSolutionSize, int timeoutMs = 10000);
+    // The frame returned by read() stays leased until the next read(), release() or close().
+    // isValid() returns false once the frame has been overwritten.
+    bool release(void);
+    bool isValid(void);
+    // Follow the read cursor registered for handle, and count the frames skipped (dropped) or
+    // returned twice (duplicated) since then.
+    bool attachCursor(int handle, CameraShmReadPolicy policy = CAMERA_SHM_READ_LATEST);
+    bool getReadStats(uint64_t *pDropped, uint64_t *pDuplicated);
     void close(void);
 
 private:
@@ -13,9 +13,13 @@
 #define LOG_TAG "LunaClient"
 #include "luna_client.h"
 #include "camera_utils_log.h"
+#include <chrono>
+#include <condition_variable>
 #include <glib.h>
 #include <ios>
+#include <mutex>
 #include <system_error>
+#include <unistd.h>
 
 struct AutoLSError : LSError
 {
@@ -60,7 +64,8 @@ LunaClient::LunaClient(void)
         PLOGE("LunaClient ERROR: %s\n", error.message);
     }
 
-    if (!LSGmainContextAttach(pHandle_, g_main_context_default(), &error))
+    pContext_ = g_main_context_default();
+    if (!LSGmainContextAttach(pHandle_, pContext_, &error))
     {
         PLOGE("LunaClient ERROR: %s\n", error.message);
     }
@@ -116,75 +121,108 @@ bool LunaClient::callSync(const char *uri, const char *param, std::string *resul
     bool ret           = false;
     LSMessageToken tok = 0;
 
+    // Shared with the reply handler, which may run after a timed out caller has returned.
     struct Ctx
     {
-        Ctx(std::string *pstrResult, int *fd) : pstrResult_(pstrResult), pFd_(fd) {}
+        std::mutex mutex_;
+        std::condition_variable cv_;
         bool bRet_{false};
-        std::string *pstrResult_{nullptr};
         bool bDone_{false};
-        int *pFd_{nullptr};
-    } ctx(result, fd);
+        bool bAbandoned_{false};
+        bool bWantFd_{false};
+        std::string strResult_;
+        int fd_{-1};
+    };
+    auto ctx      = std::make_shared<Ctx>();
+    ctx->bWantFd_ = (fd != nullptr);
+    auto *holder  = new std::shared_ptr<Ctx>(ctx);
 
     PLOGD("[%p] uri=%s, param=%s, timeout=%d", g_thread_self(), uri, param, timeout);
     ret = LSCallOneReply(
         pHandle_, uri, param,
         +[](LSHandle *h, LSMessage *m, void *d)
         {
-            Ctx *pCtx = static_cast<Ctx *>(d);
+            std::unique_ptr<std::shared_ptr<Ctx>> holder(static_cast<std::shared_ptr<Ctx> *>(d));
+            Ctx *pCtx = holder->get();
+
+            std::lock_guard<std::mutex> lock(pCtx->mutex_);
             // 1. Check whether error with including time out.
-            if (!LSMessageIsHubErrorMessage(m))
-                pCtx->bRet_ = true;
+            pCtx->bRet_ = !LSMessageIsHubErrorMessage(m);
             // 2. Processing message
             const auto *payload = LSMessageGetPayload(m);
             if (payload)
-                pCtx->pstrResult_->assign(payload);
-            // 3. Notify
+                pCtx->strResult_.assign(payload);
+            // 3. getFd
+            if (pCtx->bWantFd_)
+            {
+                int fd    = LSPayloadGetFd(LSMessageAccessPayload(m));
+                pCtx->fd_  = (fd >= 0) ? dup(fd) : -1;
+                PLOGI("fd(%d) dup(%d)", fd, pCtx->fd_);
+            }
+            // 4. Notify, the caller may have given up already
             pCtx->bDone_ = true;
-            // 4. getFd
-            if (pCtx->pFd_)
+            if (pCtx->bAbandoned_ && pCtx->fd_ >= 0)
             {
-                int fd      = LSPayloadGetFd(LSMessageAccessPayload(m));
-                *pCtx->pFd_ = dup(fd);
-                PLOGI("fd(%d) dup(%d)", fd, *pCtx->pFd_);
+                close(pCtx->fd_);
+                pCtx->fd_ = -1;
             }
+            pCtx->cv_.notify_all();
             PLOGD("[%p] reply\n", g_thread_self());
             return pCtx->bRet_;
         },
-        &ctx, &tok, &error);
+        holder, &tok, &error);
 
     if (ret != true)
     {
         PLOGE("[%p] LunaClient ERROR: %s\n", g_thread_self(), error.message);
+        delete holder;
+        return false;
     }
 
-    if (ret == true)
-    {
-        ret = LSCallSetTimeout(pHandle_, tok, timeout, nullptr);
-    }
+    // The hub replies with an error when the call times out, the waits below are bounded as well.
+    LSCallSetTimeout(pHandle_, tok, timeout, nullptr);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
 
-    if (ret == true)
+    if (pContext_ != nullptr && g_main_context_acquire(pContext_))
     {
-        if (pContext_ == g_main_context_default())
-        {
-            while (!ctx.bDone_)
-            {
-                if (FALSE == g_main_context_iteration(pContext_, FALSE))
-                    continue;
-            }
-        }
-        else
+        // No other thread dispatches the context, the reply is dispatched here.
+        GSource *timer = g_timeout_source_new(timeout);
+        g_source_set_callback(
+            timer, +[](gpointer) -> gboolean { return G_SOURCE_REMOVE; }, nullptr, nullptr);
+        g_source_attach(timer, pContext_);
+
+        while (!g_source_is_destroyed(timer))
         {
-            int cnt = 0;
-            while (!ctx.bDone_ && cnt < timeout)
             {
-                g_usleep(1000);
-                cnt++;
+                std::lock_guard<std::mutex> lock(ctx->mutex_);
+                if (ctx->bDone_)
+                    break;
             }
+            g_main_context_iteration(pContext_, TRUE);
         }
+
+        g_source_destroy(timer);
+        g_source_unref(timer);
+        g_main_context_release(pContext_);
+    }
+
+    std::unique_lock<std::mutex> lock(ctx->mutex_);
+    // Otherwise the loop thread of the context wakes this one up.
+    ctx->cv_.wait_until(lock, deadline, [&ctx] { return ctx->bDone_; });
+
+    if (!ctx->bDone_)
+    {
+        PLOGE("[%p] %s timed out", g_thread_self(), uri);
+        ctx->bAbandoned_ = true;
+        return false;
     }
 
-    PLOGD("[%p] ret=%d, bRet_=%d", g_thread_self(), ret, ctx.bRet_);
-    return ret && ctx.bRet_;
+    result->assign(ctx->strResult_);
+    if (fd != nullptr)
+        *fd = ctx->fd_;
+
+    PLOGD("[%p] ret=%d, bRet_=%d", g_thread_self(), ret, ctx->bRet_);
+    return ctx->bRet_;
 }
 
 bool LunaClient::callAsync(const char *uri, const char *param, Handler handler, void *data)
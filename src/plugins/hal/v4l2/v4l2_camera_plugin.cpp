@@ -63,6 +63,8 @@ int V4l2CameraPlugin::openDevice(string devname, string payload)
     createFourCCPixelFormatMap();
     createCameraPixelFormatMap();
     createCameraParamMap();
+    createControlCache();
+    subscribeControlEvents();
 
     PLOGI("fd : %d", fd_);
     return fd_;
@@ -72,6 +74,13 @@ int V4l2CameraPlugin::closeDevice()
 {
     PLOGI("");
 
+    {
+        // the event subscriptions end with the file handle
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        control_cache_.clear();
+        changed_controls_.clear();
+    }
+
     if (-1 == close(fd_))
     {
         PLOGE("cannot close fd: %d , %d, %s", fd_, errno, strerror(errno));
@@ -214,19 +223,28 @@ int V4l2CameraPlugin::getBuffer(void *outbuf)
     int retVal        = -1;
     struct pollfd fds;
 
+    // POLLPRI : control events, serviced while waiting for the frame
     fds.fd     = fd_;
-    fds.events = POLLIN;
-    retVal     = poll(&fds, 1, 10000);
-    if (0 == retVal)
-    {
-        PLOGE("POLL timeout!");
-        return CAMERA_ERROR_UNKNOWN;
-    }
-    else if (-1 == retVal)
+    fds.events = POLLIN | POLLPRI;
+    do
     {
-        PLOGE("POLL failed %d, %s", errno, strerror(errno));
-        return CAMERA_ERROR_UNKNOWN;
-    }
+        retVal = poll(&fds, 1, 10000);
+        if (0 == retVal)
+        {
+            PLOGE("POLL timeout!");
+            return CAMERA_ERROR_UNKNOWN;
+        }
+        else if (-1 == retVal)
+        {
+            PLOGE("POLL failed %d, %s", errno, strerror(errno));
+            return CAMERA_ERROR_UNKNOWN;
+        }
+
+        if (fds.revents & POLLPRI)
+        {
+            dequeueControlEvents();
+        }
+    } while (fds.revents == POLLPRI);
 
     switch (io_mode_)
     {
@@ -247,8 +265,11 @@ int V4l2CameraPlugin::getBuffer(void *outbuf)
         {
             out_buf->start = buffers_[buf.index].start;
         }
-        out_buf->length = buf.bytesused;
-        out_buf->index  = buf.index;
+        out_buf->length    = buf.bytesused;
+        out_buf->index     = buf.index;
+        out_buf->timestamp = (unsigned long long)buf.timestamp.tv_sec * 1000000ULL +
+                             (unsigned long long)buf.timestamp.tv_usec;
+        out_buf->sequence  = buf.sequence;
         break;
     }
     case IOMODE_USERPTR:
@@ -267,24 +288,36 @@ int V4l2CameraPlugin::getBuffer(void *outbuf)
         {
             out_buf->start = buffers_[buf.index].start;
         }
-        out_buf->length = buf.bytesused;
-        out_buf->index  = buf.index;
+        out_buf->length    = buf.bytesused;
+        out_buf->index     = buf.index;
+        out_buf->timestamp = (unsigned long long)buf.timestamp.tv_sec * 1000000ULL +
+                             (unsigned long long)buf.timestamp.tv_usec;
+        out_buf->sequence  = buf.sequence;
         break;
     }
     case IOMODE_DMABUF:
     {
+        // driver owned MMAP buffers exported as dmabuf, see getBufferFd()
         struct v4l2_buffer buf;
         CLEAR(buf);
         buf.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_DMABUF;
+        buf.memory = V4L2_MEMORY_MMAP;
 
         retVal = xioctl(fd_, VIDIOC_DQBUF, &buf);
         if (-1 == retVal)
         {
             PLOGE("VIDIOC_DQBUF failed %d, %s", errno, strerror(errno));
         }
-        out_buf->length = buf.length;
-        out_buf->index  = buf.index;
+        if (buf.index < n_buffers_)
+        {
+            out_buf->start = buffers_[buf.index].start;
+            out_buf->fd    = (buf.index < dmafd_.size()) ? dmafd_[buf.index] : -1;
+        }
+        out_buf->length    = buf.bytesused;
+        out_buf->index     = buf.index;
+        out_buf->timestamp = (unsigned long long)buf.timestamp.tv_sec * 1000000ULL +
+                             (unsigned long long)buf.timestamp.tv_usec;
+        out_buf->sequence  = buf.sequence;
         break;
     }
     default:
@@ -468,14 +501,50 @@ int V4l2CameraPlugin::getProperties(void *cam_out_params)
 {
     PLOGI("");
     camera_properties_t *out_params = static_cast<camera_properties_t *>(cam_out_params);
-    struct v4l2_queryctrl queryctrl;
-    int ret = CAMERA_ERROR_UNKNOWN;
 
+    // ranges come from the cache, only the current values are read from the device
+    std::map<unsigned int, std::vector<struct v4l2_ext_control>> classControls;
+    std::map<unsigned int, int> properties;
+    std::lock_guard<std::mutex> lock(control_mutex_);
     for (int i = 0; i < PROPERTY_END; i++)
     {
-        queryctrl.id = camera_param_map_[i];
-        if (CAMERA_ERROR_NONE == getV4l2Property(queryctrl, out_params->stGetData.data[i]))
-            ret = CAMERA_ERROR_NONE;
+        const struct v4l2_queryctrl *queryctrl = findControl(camera_param_map_[i]);
+        if (queryctrl == nullptr)
+            continue;
+        if (queryctrl->flags & V4L2_CTRL_FLAG_DISABLED)
+        {
+            PLOGE("Requested VIDIOC_QUERYCTRL flags is not supported");
+            continue;
+        }
+
+        struct v4l2_ext_control control;
+        CLEAR(control);
+        control.id = queryctrl->id;
+        classControls[V4L2_CTRL_ID2CLASS(queryctrl->id)].push_back(control);
+        properties[queryctrl->id] = i;
+    }
+
+    int ret = CAMERA_ERROR_UNKNOWN;
+    for (auto &it : classControls)
+    {
+        getV4l2ExtControls(it.first, it.second);
+
+        for (const auto &control : it.second)
+        {
+            const struct v4l2_queryctrl &queryctrl = control_cache_[control.id];
+            int *getData = out_params->stGetData.data[properties[control.id]];
+
+            PLOGI("name=%s min=%d max=%d step=%d default=%d value=%d", queryctrl.name,
+                  queryctrl.minimum, queryctrl.maximum, queryctrl.step, queryctrl.default_value,
+                  control.value);
+
+            getData[QUERY_MIN]     = queryctrl.minimum;
+            getData[QUERY_MAX]     = queryctrl.maximum;
+            getData[QUERY_STEP]    = queryctrl.step;
+            getData[QUERY_DEFAULT] = queryctrl.default_value;
+            getData[QUERY_VALUE]   = control.value;
+            ret                    = CAMERA_ERROR_NONE;
+        }
     }
 
     return ret;
@@ -570,89 +639,305 @@ int V4l2CameraPlugin::getInfo(void *cam_info, std::string devicenode)
 
 int V4l2CameraPlugin::setV4l2Property(std::map<int, int> &gIdWithPropertyValue)
 {
-    struct v4l2_queryctrl queryctrl;
-    struct v4l2_control control;
-
+    // Validate the whole set first, then write it with one VIDIOC_S_EXT_CTRLS per control class
+    // (user, camera). The properties keep their order so that an auto control is set before
+    // the manual control it gates.
+    std::map<unsigned int, std::vector<struct v4l2_ext_control>> classControls;
+    std::map<unsigned int, std::string> names;
+    std::map<unsigned int, int> failed;
+
+    std::unique_lock<std::mutex> lock(control_mutex_);
+    failed_controls_.clear();
     for (const auto &it : gIdWithPropertyValue)
     {
-        if (CONST_PARAM_DEFAULT_VALUE != it.second)
+        if (CONST_PARAM_DEFAULT_VALUE == it.second)
+            continue;
+
+        const struct v4l2_queryctrl *pQueryctrl = findControl(camera_param_map_[it.first]);
+        if (pQueryctrl == nullptr)
         {
-            queryctrl.id = camera_param_map_[it.first];
-            if (xioctl(fd_, VIDIOC_QUERYCTRL, &queryctrl) == -1)
-            {
-                PLOGI("VIDIOC_QUERYCTRL[%u] failed %d, %s", queryctrl.id, errno, strerror(errno));
-                if (errno == ENODEV)
-                {
-                    return CAMERA_ERROR_UNKNOWN;
-                }
-                else
-                {
-                    continue;
-                }
-            }
-            else if (queryctrl.flags & V4L2_CTRL_FLAG_DISABLED)
-            {
-                PLOGE("Requested VIDIOC_QUERYCTRL flags is not supported");
-                return CAMERA_ERROR_UNKNOWN;
-            }
+            PLOGI("control[%u] is not supported", camera_param_map_[it.first]);
+            continue;
+        }
+        const struct v4l2_queryctrl &queryctrl = *pQueryctrl;
+        if (queryctrl.flags & V4L2_CTRL_FLAG_DISABLED)
+        {
+            PLOGE("Requested VIDIOC_QUERYCTRL flags is not supported");
+            return CAMERA_ERROR_UNKNOWN;
+        }
+        if (queryctrl.flags & V4L2_CTRL_FLAG_READ_ONLY)
+        {
+            PLOGW("[%s] is read only, value:%d not set", queryctrl.name, it.second);
+            failed_controls_[queryctrl.id] = it.second;
+            continue;
+        }
+        if (queryctrl.type != V4L2_CTRL_TYPE_BUTTON &&
+            (it.second < queryctrl.minimum || it.second > queryctrl.maximum))
+        {
+            PLOGW("[%s] value:%d out of range [%d, %d], not set", queryctrl.name, it.second,
+                  queryctrl.minimum, queryctrl.maximum);
+            failed_controls_[queryctrl.id] = it.second;
+            continue;
+        }
+
+        struct v4l2_ext_control control;
+        CLEAR(control);
+        control.id    = queryctrl.id;
+        control.value = it.second;
+        classControls[V4L2_CTRL_ID2CLASS(queryctrl.id)].push_back(control);
+        names[queryctrl.id] = reinterpret_cast<const char *>(queryctrl.name);
+    }
+    lock.unlock();
+
+    int ret = CAMERA_ERROR_NONE;
+    for (auto &it : classControls)
+    {
+        ret = setV4l2ExtControls(it.first, it.second, names, failed);
+        if (ret == CAMERA_ERROR_UNKNOWN)
+            break;
+    }
+
+    lock.lock();
+    failed_controls_.insert(failed.begin(), failed.end());
+    return ret;
+}
 
-            CLEAR(control);
-            control.id    = queryctrl.id;
-            control.value = it.second;
-            PLOGI("VIDIOC_S_CTRL[%s] set value:%d ", queryctrl.name, control.value);
+int V4l2CameraPlugin::setV4l2ExtControls(unsigned int ctrlClass,
+                                         std::vector<struct v4l2_ext_control> &controls,
+                                         std::map<unsigned int, std::string> &names,
+                                         std::map<unsigned int, int> &failed)
+{
+    while (!controls.empty())
+    {
+        struct v4l2_ext_controls ctrls;
+        CLEAR(ctrls);
+        ctrls.ctrl_class = ctrlClass;
+        ctrls.count      = controls.size();
+        ctrls.controls   = controls.data();
 
-            if (xioctl(fd_, VIDIOC_S_CTRL, &control) == -1)
+        if (xioctl(fd_, VIDIOC_S_EXT_CTRLS, &ctrls) == 0)
+        {
+            for (const auto &control : controls)
             {
-                PLOGW("VIDIOC_S_CTRL[%s] set value:%d, failed %d, %s", queryctrl.name,
-                      control.value, errno, strerror(errno));
-                if (errno == ENODEV)
-                {
-                    return CAMERA_ERROR_UNKNOWN;
-                }
-                else
-                {
-                    continue;
-                }
+                PLOGI("VIDIOC_S_EXT_CTRLS[%s] set value:%d ", names[control.id].c_str(),
+                      control.value);
             }
+            return CAMERA_ERROR_NONE;
+        }
+        if (errno == ENODEV)
+        {
+            PLOGE("VIDIOC_S_EXT_CTRLS failed %d, %s", errno, strerror(errno));
+            return CAMERA_ERROR_UNKNOWN;
+        }
+
+        // error_idx : the control that failed, count when the set was rejected as a whole and
+        // no control can be blamed.
+        if (errno == ENOTTY || ctrls.error_idx >= controls.size())
+            break;
+
+        // Drivers roll back or stop at the failed control : retry the set without it.
+        const auto &control = controls[ctrls.error_idx];
+        PLOGW("VIDIOC_S_EXT_CTRLS[%s] set value:%d, failed %d, %s", names[control.id].c_str(),
+              control.value, errno, strerror(errno));
+        failed[control.id] = control.value;
+        controls.erase(controls.begin() + ctrls.error_idx);
+    }
+
+    // one control at a time to report each error
+    for (const auto &it : controls)
+    {
+        struct v4l2_control control;
+        CLEAR(control);
+        control.id    = it.id;
+        control.value = it.value;
+        PLOGI("VIDIOC_S_CTRL[%s] set value:%d ", names[control.id].c_str(), control.value);
+
+        if (xioctl(fd_, VIDIOC_S_CTRL, &control) == -1)
+        {
+            PLOGW("VIDIOC_S_CTRL[%s] set value:%d, failed %d, %s", names[control.id].c_str(),
+                  control.value, errno, strerror(errno));
+            failed[control.id] = control.value;
+            if (errno == ENODEV)
+                return CAMERA_ERROR_UNKNOWN;
         }
     }
     return CAMERA_ERROR_NONE;
 }
 
-int V4l2CameraPlugin::getV4l2Property(struct v4l2_queryctrl queryctrl, int *getData)
+// Controls that cannot be read are removed from the list.
+void V4l2CameraPlugin::getV4l2ExtControls(unsigned int ctrlClass,
+                                          std::vector<struct v4l2_ext_control> &controls)
 {
-    if (-1 == xioctl(fd_, VIDIOC_QUERYCTRL, &queryctrl))
+    struct v4l2_ext_controls ctrls;
+    CLEAR(ctrls);
+    ctrls.ctrl_class = ctrlClass;
+    ctrls.count      = controls.size();
+    ctrls.controls   = controls.data();
+
+    if (xioctl(fd_, VIDIOC_G_EXT_CTRLS, &ctrls) == 0)
+        return;
+
+    PLOGW("VIDIOC_G_EXT_CTRLS failed %d, %s", errno, strerror(errno));
+
+    // one control at a time so that a single failure does not hide the other values
+    for (auto it = controls.begin(); it != controls.end();)
     {
-        PLOGW("VIDIOC_QUERYCTRL[%d] failed %d, %s", queryctrl.id, errno, strerror(errno));
-        return CAMERA_ERROR_UNKNOWN;
+        struct v4l2_control control;
+        CLEAR(control);
+        control.id = it->id;
+        if (-1 == xioctl(fd_, VIDIOC_G_CTRL, &control))
+        {
+            PLOGE("VIDIOC_G_CTRL[%u] failed %d, %s", it->id, errno, strerror(errno));
+            it = controls.erase(it);
+            continue;
+        }
+        it->value = control.value;
+        ++it;
+    }
+}
+
+void V4l2CameraPlugin::createControlCache()
+{
+    control_cache_.clear();
+
+    // Min, max, step and default do not change while the device is open.
+    struct v4l2_queryctrl queryctrl;
+    CLEAR(queryctrl);
+    queryctrl.id = V4L2_CTRL_FLAG_NEXT_CTRL;
+    while (xioctl(fd_, VIDIOC_QUERYCTRL, &queryctrl) == 0)
+    {
+        if (queryctrl.type != V4L2_CTRL_TYPE_CTRL_CLASS)
+            control_cache_[queryctrl.id] = queryctrl;
+        queryctrl.id |= V4L2_CTRL_FLAG_NEXT_CTRL;
     }
-    else if (queryctrl.flags & V4L2_CTRL_FLAG_DISABLED)
+
+    // drivers without control enumeration : query the controls of the properties
+    if (control_cache_.empty())
     {
-        PLOGE("Requested VIDIOC_QUERYCTRL flags is not supported");
-        return CAMERA_ERROR_UNKNOWN;
+        for (const auto &it : camera_param_map_)
+        {
+            CLEAR(queryctrl);
+            queryctrl.id = it.second;
+            if (xioctl(fd_, VIDIOC_QUERYCTRL, &queryctrl) == 0)
+                control_cache_[queryctrl.id] = queryctrl;
+        }
     }
 
-    struct v4l2_control control;
-    CLEAR(control);
-    control.id = queryctrl.id;
-    if (-1 == xioctl(fd_, VIDIOC_G_CTRL, &control))
+    PLOGI("%zu controls", control_cache_.size());
+}
+
+void V4l2CameraPlugin::subscribeControlEvents()
+{
+    // Changes made through this file handle are not sent back (no V4L2_EVENT_SUB_FL_ALLOW_FEEDBACK),
+    // the service notifies those itself.
+    int count = 0;
+    for (const auto &it : control_cache_)
+    {
+        if (it.second.flags & V4L2_CTRL_FLAG_DISABLED)
+            continue;
+
+        struct v4l2_event_subscription sub;
+        CLEAR(sub);
+        sub.type = V4L2_EVENT_CTRL;
+        sub.id   = it.first;
+        if (xioctl(fd_, VIDIOC_SUBSCRIBE_EVENT, &sub) == -1)
+        {
+            PLOGW("VIDIOC_SUBSCRIBE_EVENT[%s] failed %d, %s", it.second.name, errno,
+                  strerror(errno));
+            if (errno == ENOTTY)
+                return;
+            continue;
+        }
+        count++;
+    }
+    PLOGI("subscribed to %d control events", count);
+}
+
+void V4l2CameraPlugin::dequeueControlEvents()
+{
+    std::lock_guard<std::mutex> lock(control_mutex_);
+
+    struct v4l2_event event;
+    CLEAR(event);
+    while (xioctl(fd_, VIDIOC_DQEVENT, &event) == 0)
     {
-        PLOGE("VIDIOC_G_CTRL failed %d, %s", errno, strerror(errno));
+        if (event.type == V4L2_EVENT_CTRL)
+        {
+            const struct v4l2_event_ctrl &ctrl = event.u.ctrl;
+            auto it                            = control_cache_.find(event.id);
+            if (it != control_cache_.end())
+            {
+                if (ctrl.changes & V4L2_EVENT_CTRL_CH_FLAGS)
+                    it->second.flags = ctrl.flags;
+                if (ctrl.changes & V4L2_EVENT_CTRL_CH_RANGE)
+                {
+                    it->second.minimum       = ctrl.minimum;
+                    it->second.maximum       = ctrl.maximum;
+                    it->second.step          = ctrl.step;
+                    it->second.default_value = ctrl.default_value;
+                }
+            }
+            if (ctrl.changes & V4L2_EVENT_CTRL_CH_VALUE)
+            {
+                PLOGD("control[%u] changed to %d", event.id, ctrl.value);
+                changed_controls_[event.id] = ctrl.value;
+            }
+        }
+        if (event.pending == 0)
+            break;
+    }
+}
+
+int V4l2CameraPlugin::getPropertyEvents(void *cam_out_params)
+{
+    camera_properties_t *out_params = static_cast<camera_properties_t *>(cam_out_params);
+
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (changed_controls_.empty())
         return CAMERA_ERROR_UNKNOWN;
+
+    for (const auto &param : camera_param_map_)
+    {
+        auto changed = changed_controls_.find(param.second);
+        auto cached  = control_cache_.find(param.second);
+        if (changed == changed_controls_.end() || cached == control_cache_.end())
+            continue;
+
+        int *getData           = out_params->stGetData.data[param.first];
+        getData[QUERY_MIN]     = cached->second.minimum;
+        getData[QUERY_MAX]     = cached->second.maximum;
+        getData[QUERY_STEP]    = cached->second.step;
+        getData[QUERY_DEFAULT] = cached->second.default_value;
+        getData[QUERY_VALUE]   = changed->second;
     }
+    changed_controls_.clear();
 
-    PLOGI("name=%s min=%d max=%d step=%d default=%d value=%d", queryctrl.name, queryctrl.minimum,
-          queryctrl.maximum, queryctrl.step, queryctrl.default_value, control.value);
+    return CAMERA_ERROR_NONE;
+}
+
+int V4l2CameraPlugin::getPropertyErrors(void *cam_out_params)
+{
+    camera_properties_t *out_params = static_cast<camera_properties_t *>(cam_out_params);
 
-    getData[0] = queryctrl.minimum;
-    getData[1] = queryctrl.maximum;
-    getData[2] = queryctrl.step;
-    getData[3] = queryctrl.default_value;
-    getData[4] = control.value;
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (failed_controls_.empty())
+        return CAMERA_ERROR_UNKNOWN;
 
+    for (const auto &param : camera_param_map_)
+    {
+        auto failed = failed_controls_.find(param.second);
+        if (failed != failed_controls_.end())
+            out_params->stGetData.data[param.first][QUERY_VALUE] = failed->second;
+    }
     return CAMERA_ERROR_NONE;
 }
 
+const struct v4l2_queryctrl *V4l2CameraPlugin::findControl(unsigned int id) const
+{
+    auto it = control_cache_.find(id);
+    return (it != control_cache_.end()) ? &it->second : nullptr;
+}
+
 camera_format_t V4l2CameraPlugin::getCameraFormatProperty(struct v4l2_fmtdesc format)
 {
     camera_format_t format_ = CAMERA_FORMAT_UNDEFINED;
@@ -779,14 +1064,15 @@ int V4l2CameraPlugin::releaseUserptrBuffers()
 
 int V4l2CameraPlugin::releaseDmaBuffersFd()
 {
-    for (unsigned int i = 0; i < n_buffers_; ++i)
+    for (auto &fd : dmafd_)
     {
-        close(dmafd_[i]);
-        dmafd_[i] = -1;
+        if (fd >= 0)
+            close(fd);
     }
+    dmafd_.clear();
 
-    // request buffers to 0
-    return requestBuffersToV4l2(0, V4L2_BUF_TYPE_VIDEO_CAPTURE, V4L2_MEMORY_MMAP);
+    // unmap and request buffers to 0
+    return releaseMmapBuffers();
 }
 
 int V4l2CameraPlugin::captureDataMmapMode()
@@ -848,7 +1134,9 @@ int V4l2CameraPlugin::captureDataUserptrMode()
 
 int V4l2CameraPlugin::requestDmabuffers(unsigned int num_buffer)
 {
-    return requestBuffersToV4l2(num_buffer, V4L2_BUF_TYPE_VIDEO_CAPTURE, V4L2_MEMORY_MMAP);
+    // The buffers are allocated and mapped by the driver as in MMAP mode so that the HAL can
+    // still access the frame (capture, solutions). getBufferFd() exports them as dmabuf.
+    return requestMmapBuffers(num_buffer);
 }
 
 int V4l2CameraPlugin::captureDataDmaMode()
@@ -883,6 +1171,23 @@ int V4l2CameraPlugin::getBufferFd(int *bufFd, int *count)
     struct v4l2_exportbuffer expbuf;
     *count = 0;
 
+    if (io_mode_ != IOMODE_DMABUF)
+    {
+        PLOGE("buffers are not allocated in dmabuf mode : io_mode %d", io_mode_);
+        return CAMERA_ERROR_UNKNOWN;
+    }
+
+    // already exported, hand out the same fds
+    if (!dmafd_.empty())
+    {
+        for (auto fd : dmafd_)
+        {
+            *bufFd++ = fd;
+            *count   = *count + 1;
+        }
+        return CAMERA_ERROR_NONE;
+    }
+
     for (unsigned int i = 0; i < n_buffers_; ++i)
     {
         CLEAR(expbuf);
@@ -896,8 +1201,8 @@ int V4l2CameraPlugin::getBufferFd(int *bufFd, int *count)
             PLOGE("VIDIOC_EXPBUF failed %d, %s", errno, strerror(errno));
             return CAMERA_ERROR_UNKNOWN;
         }
-        dmafd_[i] = expbuf.fd;
-        *bufFd    = expbuf.fd;
+        dmafd_.push_back(expbuf.fd);
+        *bufFd = expbuf.fd;
         bufFd++;
         if (*count < INT_MAX)
         {
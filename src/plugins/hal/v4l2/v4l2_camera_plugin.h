@@ -23,7 +23,9 @@
 #include <iostream>
 #include <linux/videodev2.h>
 #include <map>
+#include <mutex>
 #include <string.h>
+#include <vector>
 
 #ifdef __cplusplus
 extern "C"
@@ -60,10 +62,19 @@ extern "C"
         virtual int getProperties(void *cam_out_param) override;
         virtual int getInfo(void *cam_info, std::string devicenode) override;
         virtual int getBufferFd(int *bufFd, int *count) override;
+        virtual int getPropertyEvents(void *cam_out_param) override;
+        virtual int getPropertyErrors(void *cam_out_param) override;
 
     private:
         int setV4l2Property(std::map<int, int> &);
-        int getV4l2Property(struct v4l2_queryctrl, int *);
+        int setV4l2ExtControls(unsigned int, std::vector<struct v4l2_ext_control> &,
+                               std::map<unsigned int, std::string> &,
+                               std::map<unsigned int, int> &);
+        void getV4l2ExtControls(unsigned int, std::vector<struct v4l2_ext_control> &);
+        void createControlCache();
+        const struct v4l2_queryctrl *findControl(unsigned int) const;
+        void subscribeControlEvents();
+        void dequeueControlEvents();
         camera_format_t getCameraFormatProperty(struct v4l2_fmtdesc);
 
         int requestMmapBuffers(unsigned int);
@@ -91,11 +102,19 @@ extern "C"
         buffer_t *buffers_;
         unsigned int n_buffers_;
         int fd_;
-        int dmafd_[CONST_MAX_BUFFER_NUM];
+        std::vector<int> dmafd_;
         int io_mode_;
         std::map<camera_pixel_format_t, unsigned int> fourcc_format_;
         std::map<unsigned int, camera_pixel_format_t> camera_format_;
         std::map<int, unsigned int> camera_param_map_;
+        // controls of the open device by id, enumerated once by openDevice and updated by the
+        // control events
+        std::map<unsigned int, struct v4l2_queryctrl> control_cache_;
+        // values changed by the device since the last getPropertyEvents
+        std::map<unsigned int, int> changed_controls_;
+        // values the device rejected in the last setProperties
+        std::map<unsigned int, int> failed_controls_;
+        std::mutex control_mutex_;
     };
 
 #ifdef __cplusplus
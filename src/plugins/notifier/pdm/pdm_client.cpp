@@ -204,6 +204,7 @@ bool PDMClient::getDeviceListCallback(const char *message)
             devInfo               = device.devInfo;
             devInfo.strDeviceNode = subdevice->devPath;
             devInfo.strDeviceType = "v4l2";
+            devInfo.strVersion    = subdevice->version;
             devInfo.strUserData   = "";
 
             devInfo.strDeviceKey += "/" + devInfo.strVendorID + "/" + devInfo.strProductID;
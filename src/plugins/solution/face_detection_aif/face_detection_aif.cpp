@@ -18,10 +18,9 @@
 #include "face_detection_aif.hpp"
 #include "camera_constants.h"
 #include "camera_log.h"
+#include "jpeg_decode_error.h"
 #include "plugin.hpp"
-#include <cstdio>
 #include <cstdlib>
-#include <jpeglib.h>
 #include <json_utils.h>
 #include <string>
 
@@ -29,7 +28,16 @@ using namespace cv;
 
 #define AIF_PARAM_FILE "/home/root/aif_param.json"
 
-FaceDetectionAIF::FaceDetectionAIF(void) { PLOGI(""); }
+FaceDetectionAIF::FaceDetectionAIF(void)
+{
+    PLOGI("");
+    // detection on one frame per second by default
+    schedule_.fps = 1.0;
+    // the detector takes BGR pixels, decoded by the hal when it can
+    decodedInput_ = true;
+    // the detector resizes its input to a few hundred pixels : larger frames only cost decoding
+    setInputSize(320, 240);
+}
 
 FaceDetectionAIF::~FaceDetectionAIF(void) { PLOGI(""); }
 
@@ -131,13 +139,23 @@ void FaceDetectionAIF::release(void)
 
 void FaceDetectionAIF::processing(void)
 {
-    if (streamFormat_.pixel_format != CAMERA_PIXEL_FORMAT_JPEG)
-        return;
+    uint8_t *image = nullptr;
+    if (frameFormat_.pixel_format == CAMERA_PIXEL_FORMAT_BGR888)
+        image = getDecodedImage();
+    else if (frameFormat_.pixel_format == CAMERA_PIXEL_FORMAT_JPEG && decodeJpeg())
+        image = oDecodedImage_.pImage_;
 
-    if (!decodeJpeg())
+    if (image == nullptr)
         return;
-    if (!detectFace())
+    if (!detectFace(image))
+        return;
+
+    // detected straight from the shared memory, the result is dropped if the frame changed
+    if (image != oDecodedImage_.pImage_ && !queueJob_.front()->isValid())
+    {
+        PLOGI("frame is overwritten while detecting");
         return;
+    }
 
     /*
     {
@@ -211,14 +229,14 @@ void FaceDetectionAIF::postProcessing(void)
     sendReply(std::move(strOutput));
 }
 
-bool FaceDetectionAIF::detectFace(void)
+bool FaceDetectionAIF::detectFace(uint8_t *image)
 {
     std::lock_guard<std::mutex> lock(mtxAi_);
     EdgeAIVision::getInstance().detect(
         type,
         Mat(Size((oDecodedImage_.outWidth_ <= INT_MAX) ? oDecodedImage_.outWidth_ : 0,
                  (oDecodedImage_.outHeight_ <= INT_MAX) ? oDecodedImage_.outHeight_ : 0),
-            CV_8UC3, oDecodedImage_.pImage_),
+            CV_8UC3, image),
         output);
     return true;
     // TODO : Do we need to decide success or failure from here?
@@ -227,20 +245,48 @@ bool FaceDetectionAIF::detectFace(void)
     // return pResults[0] > 0 ? true : false;
 }
 
-bool FaceDetectionAIF::decodeJpeg(void)
+uint8_t *FaceDetectionAIF::getDecodedImage(void)
 {
-    struct jpeg_decompress_struct cinfo;
-    struct jpeg_error_mgr jerr;
+    auto &buf = queueJob_.front();
 
-    cinfo.err = jpeg_std_error(&jerr);
-    jpeg_create_decompress(&cinfo);
+    // the hal may have scaled the frame down, the faces are reported in stream coordinates
+    oDecodedImage_.srcWidth_    = streamFormat_.stream_width;
+    oDecodedImage_.srcHeight_   = streamFormat_.stream_height;
+    oDecodedImage_.outWidth_    = frameFormat_.stream_width;
+    oDecodedImage_.outHeight_   = frameFormat_.stream_height;
+    oDecodedImage_.outChannels_ = 3;
+    oDecodedImage_.outStride_   = frameFormat_.stream_width * 3;
+
+    if (buf->data_ == nullptr ||
+        (uint64_t)oDecodedImage_.outStride_ * oDecodedImage_.outHeight_ > buf->size_)
+    {
+        PLOGE("decoded frame %ux%u does not fit in %u bytes", oDecodedImage_.outWidth_,
+              oDecodedImage_.outHeight_, buf->size_);
+        return nullptr;
+    }
+    return buf->data_;
+}
 
+bool FaceDetectionAIF::decodeJpeg(void)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct DecodeError jerr;
     auto &buf = queueJob_.front();
 
+    cinfo.err           = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = onDecodeError;
+    if (setjmp(jerr.jump))
+    {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
     jpeg_mem_src(&cinfo, buf->data_, buf->size_);
     if (jpeg_read_header(&cinfo, TRUE) != 1)
     {
         PLOGI("Image decoding is failed");
+        jpeg_destroy_decompress(&cinfo);
         return false;
     }
 
@@ -248,8 +294,10 @@ bool FaceDetectionAIF::decodeJpeg(void)
     oDecodedImage_.srcWidth_      = cinfo.image_width;
     oDecodedImage_.srcHeight_     = cinfo.image_height;
 
+    // decoded straight at the input size of the detector, with the fast integer idct
     cinfo.scale_num       = 1;
-    cinfo.scale_denom     = 1;
+    cinfo.scale_denom     = getScaleDenom(cinfo.image_width, cinfo.image_height);
+    cinfo.dct_method      = JDCT_IFAST;
     cinfo.out_color_space = JCS_EXT_BGR;
 
     jpeg_start_decompress(&cinfo);
@@ -273,6 +321,12 @@ bool FaceDetectionAIF::decodeJpeg(void)
     jpeg_finish_decompress(&cinfo);
     jpeg_destroy_decompress(&cinfo);
 
+    if (!buf->isValid())
+    {
+        PLOGI("frame is overwritten while decoding");
+        return false;
+    }
+
     return true;
 }
 
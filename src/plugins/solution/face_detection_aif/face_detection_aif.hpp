@@ -77,8 +77,9 @@ public:
     virtual void postProcessing(void) override;
 
 private:
-    bool detectFace(void);
+    bool detectFace(uint8_t *image);
     bool decodeJpeg(void);
+    uint8_t *getDecodedImage(void);
     void sendReply(std::string message);
 
 private:
@@ -18,13 +18,140 @@
 #include "camera_hal_proxy.h"
 #include "camera/luna_client.h"
 #include "command_manager.h"
-#include "generate_unique_id.h"
+#include "event_notification.h"
+#include "hal_command_channel.h"
+#include "hal_process_pool.h"
 #include "json_utils.h"
 #include "process.h"
+#include "request_dispatcher.h"
 #include <ios>
+#include <cstdio>
+#include <mutex>
 #include <system_error>
 
-const std::string CameraHalProcessName = "com.webos.service.camera2.hal";
+// One HAL process, started with -i on the first getDeviceInfo, answers the device info queries
+// of all cameras for as long as the camera service runs. It is started again if it went away.
+class DeviceInfoWorker
+{
+    std::mutex mutex_;
+    std::shared_ptr<HalConnection> hal_;
+    int calls_{0}; // calls in flight
+
+    DeviceInfoWorker() {}
+    ~DeviceInfoWorker()
+    {
+        // the worker does not exit by itself
+        if (hal_)
+            hal_->process->terminate();
+    }
+
+    // Counts a call in flight on the returned worker. failed is a worker whose call got no
+    // answer, it is replaced if it is gone or if it hangs with no other call.
+    std::shared_ptr<HalConnection> acquire(const std::shared_ptr<HalConnection> &failed);
+    void release();
+
+public:
+    static DeviceInfoWorker &getInstance()
+    {
+        static DeviceInfoWorker obj;
+        return obj;
+    }
+
+    bool call(const std::string &payload, std::string *resp);
+};
+
+std::shared_ptr<HalConnection>
+DeviceInfoWorker::acquire(const std::shared_ptr<HalConnection> &failed)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (failed)
+        calls_--;
+
+    // a call of another thread may have replaced the failed worker already
+    if (hal_ && failed && hal_ == failed && hal_->process->isRunning())
+    {
+        // the worker may only be slow with the queries of other cameras, they are not cut off
+        if (calls_ > 0)
+        {
+            PLOGW("device info worker is busy with %d calls", calls_);
+            return nullptr;
+        }
+        PLOGE("device info worker hangs");
+        hal_->process->terminate();
+        hal_.reset();
+    }
+    if (!hal_ || (failed && hal_ == failed))
+    {
+        PLOGI("start device info worker");
+        try
+        {
+            hal_ = std::make_shared<HalConnection>("-i");
+        }
+        catch (const std::system_error &e)
+        {
+            PLOGE("no device info worker : %s", e.what());
+            hal_.reset();
+        }
+    }
+    if (hal_)
+        calls_++;
+    return hal_;
+}
+
+void DeviceInfoWorker::release()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    calls_--;
+}
+
+bool DeviceInfoWorker::call(const std::string &payload, std::string *resp)
+{
+    std::shared_ptr<HalConnection> hal = acquire(nullptr);
+    if (!hal)
+        return false;
+
+    std::string uri = hal->serviceUri + "getDeviceInfo";
+    PLOGI("%s '%s'", uri.c_str(), payload.c_str());
+    bool ret = hal->client->callSync(uri.c_str(), payload.c_str(), resp, COMMAND_TIMEOUT);
+    if (ret)
+    {
+        release();
+        return true;
+    }
+
+    // the worker crashed or hangs, the query is worth one more try with a new one
+    PLOGE("device info worker failed : %s", resp->c_str());
+    hal = acquire(hal);
+    if (!hal)
+        return false;
+
+    uri = hal->serviceUri + "getDeviceInfo";
+    resp->clear();
+    ret = hal->client->callSync(uri.c_str(), payload.c_str(), resp, COMMAND_TIMEOUT);
+    release();
+    return ret;
+}
+
+static void parseProperties(const json &jobj_params, CAMERA_PROPERTIES_T *oparams)
+{
+    for (auto it = jobj_params.begin(); it != jobj_params.end(); ++it)
+    {
+        if (it.value().is_object() == false)
+            continue;
+
+        int i = getParamNumFromString(it.key());
+        if (i >= 0)
+        {
+            const json &queries = it.value();
+            for (auto q = queries.begin(); q != queries.end(); ++q)
+            {
+                int n = getQueryNumFromString(q.key());
+                if (n >= 0)
+                    oparams->stGetData.data[i][n] = q.value();
+            }
+        }
+    }
+}
 
 static bool cameraHalServiceCb(const char *msg, void *data)
 {
@@ -52,10 +179,30 @@ static bool cameraHalServiceCb(const char *msg, void *data)
     else if (event_type == getEventNotificationString(EventType::EVENT_TYPE_CAPTURE_FAULT))
     {
         event_key = CONST_EVENT_KEY_CAPTURE_FAULT;
+        // the capture state belongs to the worker of the camera
         for (const auto &handle : client->devHandles_)
-            CommandManager::getInstance().stopCapture(handle, false);
+        {
+            int deviceid = CommandManager::getInstance().getCameraId(handle);
+            RequestDispatcher::getInstance().dispatch(
+                deviceid, [handle]() { CommandManager::getInstance().stopCapture(handle, false); });
+        }
         client->devHandles_.clear();
     }
+    else if (event_type == getEventNotificationString(EventType::EVENT_TYPE_PROPERTIES))
+    {
+        // properties changed by the device, the subscribers of getProperties get the new values
+        CAMERA_PROPERTIES_T changed, old;
+        parseProperties(j[CONST_PARAM_NAME_PARAMS], &changed);
+        client->updateCachedDeviceProperty(changed);
+
+        std::string id = get_optional<std::string>(j, CONST_PARAM_NAME_ID).value_or("");
+        event_key      = std::string(CONST_EVENT_KEY_PROPERTIES) + "_" + id;
+        // the reply holds the properties of changed with a value, old is not compared
+        EventNotification().eventReply(client->sh_, event_key, EventType::EVENT_TYPE_PROPERTIES,
+                                       &changed, &old);
+        LSErrorFree(&lserror);
+        return true;
+    }
     else
     {
         PLOGE("Invalid event %s", event_type.c_str());
@@ -88,35 +235,7 @@ CameraHalProxy::CameraHalProxy() : state_(State::INIT)
 {
     PLOGI("");
 
-    GMainContext *c = g_main_context_new();
-    loop_           = g_main_loop_new(c, false);
-
-    try
-    {
-        loopThread_ = std::make_unique<std::thread>(g_main_loop_run, loop_);
-    }
-    catch (const std::system_error &e)
-    {
-        PLOGE("Caught a system_error with code %d meaning %s", e.code().value(), e.what());
-    }
-
-    while (!g_main_loop_is_running(loop_))
-    {
-    }
-
-    pthread_setname_np(loopThread_->native_handle(), "halproxy_luna");
-
-    std::string guid         = GenerateUniqueID()();
-    std::string service_name = cstr_uricameramain + "." + guid;
-    luna_client              = std::make_unique<LunaClient>(service_name.c_str(), c);
-    g_main_context_unref(c);
-
-    // start process
-    uid_         = cstr_uricamearhal + guid;
-    service_uri_ = "luna://" + uid_ + "/";
-
-    std::string cmd = "/usr/sbin/" + CameraHalProcessName + " -s" + uid_;
-    process_        = std::make_unique<Process>(cmd);
+    hal_ = HalProcessPool::getInstance().acquire();
 }
 
 CameraHalProxy::~CameraHalProxy()
@@ -135,26 +254,25 @@ CameraHalProxy::~CameraHalProxy()
     {
         PLOGE("Caught a std::logic_error meaning %s", e.what());
     }
-
-    g_main_loop_quit(loop_);
-    if (loopThread_->joinable())
-    {
-        try
-        {
-            loopThread_->join();
-        }
-        catch (const std::system_error &e)
-        {
-            PLOGE("Caught a system_error with code %d meaning %s", e.code().value(), e.what());
-        }
-    }
-    g_main_loop_unref(loop_);
 }
 
 DEVICE_RETURN_CODE_T CameraHalProxy::open(std::string devicenode, int ndev_id, std::string payload)
 {
     PLOGI("devicenode : %s, ndev_id : %d, payload [%s]", devicenode.c_str(), ndev_id,
           payload.c_str());
+    clearCache();
+
+    // the user data of the device goes on luna, it has no size limit there
+    if (payload.empty())
+    {
+        HalCommandMessage cmd{};
+        HAL_REPLY_T reply{};
+        cmd.command = HalCommand::OPEN;
+        cmd.value   = ndev_id;
+        cmd.path    = devicenode;
+        if (channel_call(cmd, &reply))
+            return reply.ret;
+    }
 
     json jin;
     jin[CONST_PARAM_NAME_DEVICE_PATH] = devicenode;
@@ -164,23 +282,82 @@ DEVICE_RETURN_CODE_T CameraHalProxy::open(std::string devicenode, int ndev_id, s
     return luna_call_sync(__func__, to_string(jin));
 }
 
+bool CameraHalProxy::openStream(const std::string &devicenode, int ndev_id, CAMERA_FORMAT sformat,
+                                LSHandle *sh, const std::string &memtype, int id,
+                                DEVICE_RETURN_CODE_T *ret, HalCommand *step, int *bufferfd,
+                                int *signalfd)
+{
+    PLOGI("devicenode : %s, ndev_id : %d, memtype %s, id %d", devicenode.c_str(), ndev_id,
+          memtype.c_str(), id);
+
+    HalCommandMessage cmd{};
+    HAL_REPLY_T reply{};
+    cmd.command = HalCommand::OPEN_STREAM;
+    cmd.id      = id;
+    cmd.value   = ndev_id;
+    cmd.format  = sformat;
+    cmd.name    = memtype;
+    cmd.path    = devicenode;
+
+    // the HAL sends the events of the preview to sh
+    sh_ = sh;
+    clearCache();
+
+    int fds[HAL_REPLY_MAX_FDS] = {-1, -1};
+    if (!channel_call(cmd, &reply, COMMAND_TIMEOUT_LONG, fds, HAL_REPLY_MAX_FDS))
+        return false;
+
+    if (reply.ret == DEVICE_ERROR_TIMEOUT)
+    {
+        // the HAL may still complete the steps, they are undone after it
+        PLOGE("openStream timed out, stop and close the device");
+        stopPreview(true);
+        close();
+    }
+
+    *ret      = reply.ret;
+    *step     = reply.step;
+    *bufferfd = fds[0];
+    *signalfd = fds[1];
+    return true;
+}
+
 DEVICE_RETURN_CODE_T CameraHalProxy::close()
 {
     PLOGI("");
+    clearCache();
     return luna_call_sync(__func__, "{}");
 }
 
-DEVICE_RETURN_CODE_T CameraHalProxy::startPreview(LSHandle *sh)
+DEVICE_RETURN_CODE_T CameraHalProxy::startPreview(LSHandle *sh, const std::string &memtype)
 {
-    PLOGI("");
+    PLOGI("memtype %s", memtype.c_str());
     sh_ = sh;
-    return luna_call_sync(__func__, "{}", COMMAND_TIMEOUT_LONG);
+
+    HalCommandMessage cmd{};
+    HAL_REPLY_T reply{};
+    cmd.command = HalCommand::START_PREVIEW;
+    cmd.name    = memtype;
+    if (channel_call(cmd, &reply, COMMAND_TIMEOUT_LONG))
+        return reply.ret;
+
+    json jin;
+    jin[CONST_PARAM_NAME_MEMTYPE] = memtype;
+
+    return luna_call_sync(__func__, to_string(jin), COMMAND_TIMEOUT_LONG);
 }
 
 DEVICE_RETURN_CODE_T CameraHalProxy::stopPreview(bool forceComplete)
 {
     PLOGI("");
 
+    HalCommandMessage cmd{};
+    HAL_REPLY_T reply{};
+    cmd.command = HalCommand::STOP_PREVIEW;
+    cmd.value   = forceComplete;
+    if (channel_call(cmd, &reply, COMMAND_TIMEOUT_LONG))
+        return reply.ret;
+
     json jin;
     jin[CONST_PARAM_NAME_FORCE_COMPLETE] = forceComplete;
 
@@ -209,20 +386,64 @@ DEVICE_RETURN_CODE_T CameraHalProxy::startCapture(CAMERA_FORMAT sformat,
             devHandles_.push_back(devHandle);
     }
 
+    // a path longer than the command holds goes by luna
+    if (imagepath.size() <= HAL_COMMAND_PATH_MAX)
+    {
+        HalCommandMessage cmd{};
+        HAL_REPLY_T reply{};
+        cmd.command        = HalCommand::START_CAPTURE;
+        cmd.value          = ncount;
+        cmd.format.nWidth  = sformat.nWidth;
+        cmd.format.nHeight = sformat.nHeight;
+        cmd.format.eFormat = sformat.eFormat;
+        cmd.name           = mode;
+        cmd.path           = imagepath;
+        if (channel_call(cmd, &reply, COMMAND_TIMEOUT_LONG))
+            return reply.ret;
+    }
+
     return luna_call_sync(__func__, to_string(jin), COMMAND_TIMEOUT_LONG);
 }
 
-DEVICE_RETURN_CODE_T CameraHalProxy::stopCapture(const int devHandle)
+static void getCaptureStats(const nlohmann::json &jstats, CAPTURE_STATS_T *pStats)
+{
+    if (pStats == nullptr || !jstats.is_object())
+        return;
+
+    pStats->frames         = jstats.value(CONST_PARAM_NAME_FRAMES, 0u);
+    pStats->dropped        = jstats.value(CONST_PARAM_NAME_DROPPED, 0ull);
+    pStats->bytes          = jstats.value(CONST_PARAM_NAME_BYTES, 0ull);
+    pStats->maxQueueDepth  = jstats.value(CONST_PARAM_NAME_MAX_QUEUE_DEPTH, 0u);
+    pStats->throughputKBps = jstats.value(CONST_PARAM_NAME_THROUGHPUT, 0u);
+}
+
+DEVICE_RETURN_CODE_T CameraHalProxy::stopCapture(const int devHandle, CAPTURE_STATS_T *pStats)
 {
     PLOGI("");
     auto itr = std::find(devHandles_.begin(), devHandles_.end(), devHandle);
     if (itr != devHandles_.end())
         devHandles_.erase(itr);
-    return luna_call_sync(__func__, "{}");
+
+    HalCommandMessage cmd{};
+    HAL_REPLY_T reply{};
+    cmd.command = HalCommand::STOP_CAPTURE;
+    if (channel_call(cmd, &reply))
+    {
+        if (reply.ret == DEVICE_OK && pStats)
+            *pStats = reply.captureStats;
+        return reply.ret;
+    }
+
+    DEVICE_RETURN_CODE_T ret = luna_call_sync(__func__, "{}");
+    if (ret == DEVICE_OK && jOut.contains(CONST_PARAM_NAME_CAPTURE_STATS))
+        getCaptureStats(jOut[CONST_PARAM_NAME_CAPTURE_STATS], pStats);
+
+    return ret;
 }
 
 DEVICE_RETURN_CODE_T CameraHalProxy::capture(int ncount, const std::string &imagepath,
-                                             std::vector<std::string> &capturedFiles)
+                                             std::vector<std::string> &capturedFiles,
+                                             CAPTURE_STATS_T *pStats)
 {
     PLOGI("");
 
@@ -240,6 +461,8 @@ DEVICE_RETURN_CODE_T CameraHalProxy::capture(int ncount, const std::string &imag
                 continue;
             capturedFiles.push_back(s);
         }
+        if (jOut.contains(CONST_PARAM_NAME_CAPTURE_STATS))
+            getCaptureStats(jOut[CONST_PARAM_NAME_CAPTURE_STATS], pStats);
     }
 
     return ret;
@@ -248,17 +471,39 @@ DEVICE_RETURN_CODE_T CameraHalProxy::capture(int ncount, const std::string &imag
 DEVICE_RETURN_CODE_T CameraHalProxy::createHal(std::string subsystem)
 {
     PLOGI("subsystem : %s", subsystem.c_str());
+    if (hal_ == nullptr)
+    {
+        PLOGE("hal process is not ready");
+        return DEVICE_ERROR_CAN_NOT_OPEN;
+    }
     state_ = State::CREATE;
+    clearCache();
 
-    json jin;
-    jin[CONST_PARAM_NAME_SUBSYSTEM] = subsystem;
-    return luna_call_sync(__func__, to_string(jin));
+    // a process of the pool has the plugin already
+    if (!hal_->subsystem.empty() && hal_->subsystem == subsystem)
+    {
+        PLOGI("%s is created already", subsystem.c_str());
+    }
+    else
+    {
+        json jin;
+        jin[CONST_PARAM_NAME_SUBSYSTEM] = subsystem;
+        DEVICE_RETURN_CODE_T ret        = luna_call_sync(__func__, to_string(jin));
+        if (ret != DEVICE_OK)
+            return ret;
+    }
+
+    // the processes of the pool have it open already, luna is used without it
+    if (!hal_->channel)
+        hal_->openChannel(COMMAND_TIMEOUT);
+    return DEVICE_OK;
 }
 
 DEVICE_RETURN_CODE_T CameraHalProxy::destroyHal()
 {
     PLOGI("");
     state_ = State::DESTROY;
+    clearCache();
 
     return luna_call_sync(__func__, "{}");
 }
@@ -269,47 +514,13 @@ DEVICE_RETURN_CODE_T CameraHalProxy::getDeviceInfo(std::string strdevicenode,
 {
     PLOGI("device node : %s, device type : %s", strdevicenode.c_str(), strdevicetype.c_str());
 
-    // 1. start process
-    std::string serviceName = cstr_uricamearhal + GenerateUniqueID()();
-    std::string cmd         = "/usr/sbin/" + CameraHalProcessName + " -s" + serviceName;
-
-    std::unique_ptr<Process> proc_ = std::make_unique<Process>(cmd);
-
-    // 2. LunaClient
-    GMainContext *c = g_main_context_new();
-    GMainLoop *lp   = g_main_loop_new(c, false);
-    std::unique_ptr<std::thread> lpthd;
-
-    try
-    {
-        lpthd = std::make_unique<std::thread>(g_main_loop_run, lp);
-    }
-    catch (const std::system_error &e)
-    {
-        PLOGE("Caught a system_error with code %d meaning %s", e.code().value(), e.what());
-    }
-
-    while (!g_main_loop_is_running(lp))
-    {
-    }
-
-    pthread_setname_np(lpthd->native_handle(), "getinfo_luna");
-
-    std::string ls_service_name    = CameraHalProcessName + "." + __func__;
-    std::unique_ptr<LunaClient> lc = std::make_unique<LunaClient>(ls_service_name.c_str(), c);
-    g_main_context_unref(c);
-
-    // 3. sendMessage
-    std::string uri = "luna://" + serviceName + "/" + __func__;
-
     json jin;
     jin[CONST_PARAM_NAME_DEVICE_PATH] = strdevicenode;
     jin[CONST_PARAM_NAME_SUBSYSTEM]   = strdevicetype;
     std::string payload               = to_string(jin);
-    PLOGI("%s '%s'", uri.c_str(), payload.c_str());
 
     std::string resp;
-    lc->callSync(uri.c_str(), payload.c_str(), &resp, COMMAND_TIMEOUT);
+    DeviceInfoWorker::getInstance().call(payload, &resp);
     PLOGI("resp : %s", resp.c_str());
 
     auto j = json::parse(resp, nullptr, false);
@@ -347,20 +558,6 @@ DEVICE_RETURN_CODE_T CameraHalProxy::getDeviceInfo(std::string strdevicenode,
                        .value_or(DEVICE_RETURN_UNDEFINED);
     }
 
-    g_main_loop_quit(lp);
-    if (lpthd->joinable())
-    {
-        try
-        {
-            lpthd->join();
-        }
-        catch (const std::system_error &e)
-        {
-            PLOGE("Caught a system_error with code %d meaning %s", e.code().value(), e.what());
-        }
-    }
-    g_main_loop_unref(lp);
-
     return ret_code;
 }
 
@@ -368,38 +565,55 @@ DEVICE_RETURN_CODE_T CameraHalProxy::getDeviceProperty(CAMERA_PROPERTIES_T *opar
 {
     PLOGI("");
 
-    DEVICE_RETURN_CODE_T ret = luna_call_sync(__func__, "{}");
+    HalCommandMessage cmd{};
+    HAL_REPLY_T reply{};
+    cmd.command = HalCommand::GET_DEVICE_PROPERTY;
+    DEVICE_RETURN_CODE_T ret;
+    if (channel_call(cmd, &reply))
+    {
+        ret = reply.ret;
+        if (ret == DEVICE_OK)
+            oparams->stGetData = reply.properties;
+    }
+    else
+    {
+        ret = luna_call_sync(__func__, "{}");
+        if (ret == DEVICE_OK)
+            parseProperties(jOut[CONST_PARAM_NAME_PARAMS], oparams);
+    }
 
     if (ret == DEVICE_OK)
     {
-        auto jobj_params = jOut[CONST_PARAM_NAME_PARAMS];
-
-        for (json::iterator it = jobj_params.begin(); it != jobj_params.end(); ++it)
-        {
-            if (it.value().is_object() == false)
-                continue;
-
-            int i = getParamNumFromString(it.key());
-            if (i >= 0)
-            {
-                json queries = jobj_params[it.key()];
-                for (json::iterator q = queries.begin(); q != queries.end(); ++q)
-                {
-                    int n = getQueryNumFromString(q.key());
-                    if (n >= 0)
-                        oparams->stGetData.data[i][n] = q.value();
-                }
-            }
-        }
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        propertiesCache_  = *oparams;
+        propertiesCached_ = true;
     }
-
     return ret;
 }
 
-DEVICE_RETURN_CODE_T CameraHalProxy::setDeviceProperty(CAMERA_PROPERTIES_T *inparams)
+DEVICE_RETURN_CODE_T CameraHalProxy::setDeviceProperty(CAMERA_PROPERTIES_T *inparams,
+                                                       CAMERA_PROPERTIES_T *failed)
 {
     PLOGI("");
 
+    HalCommandMessage cmd{};
+    HAL_REPLY_T reply{};
+    cmd.command    = HalCommand::SET_DEVICE_PROPERTY;
+    cmd.properties = inparams->stGetData;
+    if (channel_call(cmd, &reply))
+    {
+        if (reply.ret == DEVICE_OK && failed != nullptr)
+        {
+            for (int i = 0; i < PROPERTY_END; i++)
+            {
+                failed->stGetData.data[i][QUERY_VALUE] = reply.properties.data[i][QUERY_VALUE];
+            }
+        }
+        if (reply.ret == DEVICE_OK)
+            refreshCachedDeviceProperty();
+        return reply.ret;
+    }
+
     json jin;
     for (int i = 0; i < PROPERTY_END; i++)
     {
@@ -408,46 +622,155 @@ DEVICE_RETURN_CODE_T CameraHalProxy::setDeviceProperty(CAMERA_PROPERTIES_T *inpa
         jin[CONST_PARAM_NAME_PARAMS][getParamString(i)] = inparams->stGetData.data[i][QUERY_VALUE];
     }
 
-    return luna_call_sync(__func__, to_string(jin));
+    DEVICE_RETURN_CODE_T ret = luna_call_sync(__func__, to_string(jin));
+    if (ret == DEVICE_OK && failed != nullptr && jOut.contains(CONST_PARAM_NAME_FAILED_PARAMS))
+    {
+        for (const auto &name : jOut[CONST_PARAM_NAME_FAILED_PARAMS])
+        {
+            int i = name.is_string() ? getParamNumFromString(name.get<std::string>()) : -1;
+            if (i >= 0)
+                failed->stGetData.data[i][QUERY_VALUE] = inparams->stGetData.data[i][QUERY_VALUE];
+        }
+    }
+    if (ret == DEVICE_OK)
+        refreshCachedDeviceProperty();
+
+    return ret;
 }
 
 DEVICE_RETURN_CODE_T CameraHalProxy::setFormat(CAMERA_FORMAT sformat)
 {
     PLOGI("");
 
-    json jin;
-    jin[CONST_PARAM_NAME_WIDTH]  = sformat.nWidth;
-    jin[CONST_PARAM_NAME_HEIGHT] = sformat.nHeight;
-    jin[CONST_PARAM_NAME_FPS]    = sformat.nFps;
-    jin[CONST_PARAM_NAME_FORMAT] = sformat.eFormat;
+    HalCommandMessage cmd{};
+    HAL_REPLY_T reply{};
+    cmd.command = HalCommand::SET_FORMAT;
+    cmd.format  = sformat;
+    DEVICE_RETURN_CODE_T ret;
+    if (channel_call(cmd, &reply))
+    {
+        ret = reply.ret;
+    }
+    else
+    {
+        json jin;
+        jin[CONST_PARAM_NAME_WIDTH]  = sformat.nWidth;
+        jin[CONST_PARAM_NAME_HEIGHT] = sformat.nHeight;
+        jin[CONST_PARAM_NAME_FPS]    = sformat.nFps;
+        jin[CONST_PARAM_NAME_FORMAT] = sformat.eFormat;
 
-    return luna_call_sync(__func__, to_string(jin));
+        ret = luna_call_sync(__func__, to_string(jin));
+    }
+
+    // the device may have taken a format near the one asked for, it is read back
+    if (ret == DEVICE_OK)
+    {
+        CAMERA_FORMAT format;
+        if (getFormat(&format) != DEVICE_OK)
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex_);
+            formatCached_ = false;
+        }
+    }
+    return ret;
 }
 
 DEVICE_RETURN_CODE_T CameraHalProxy::getFormat(CAMERA_FORMAT *pformat)
 {
     PLOGI("");
 
-    DEVICE_RETURN_CODE_T ret = luna_call_sync(__func__, "{}");
+    HalCommandMessage cmd{};
+    HAL_REPLY_T reply{};
+    cmd.command = HalCommand::GET_FORMAT;
+    DEVICE_RETURN_CODE_T ret;
+    if (channel_call(cmd, &reply))
+    {
+        ret = reply.ret;
+        if (ret == DEVICE_OK)
+            *pformat = reply.format;
+    }
+    else
+    {
+        ret = luna_call_sync(__func__, "{}");
+        if (ret == DEVICE_OK)
+        {
+            int w            = get_optional<int>(jOut, CONST_PARAM_NAME_WIDTH).value_or(0);
+            int h            = get_optional<int>(jOut, CONST_PARAM_NAME_HEIGHT).value_or(0);
+            pformat->nWidth  = (w > 0) ? w : 0;
+            pformat->nHeight = (h > 0) ? h : 0;
+            pformat->nFps    = get_optional<int>(jOut, CONST_PARAM_NAME_FPS).value_or(0);
+            pformat->eFormat = get_optional<camera_format_t>(jOut, CONST_PARAM_NAME_FORMAT)
+                                   .value_or(CAMERA_FORMAT_UNDEFINED);
+        }
+    }
 
     if (ret == DEVICE_OK)
     {
-        int w            = get_optional<int>(jOut, CONST_PARAM_NAME_WIDTH).value_or(0);
-        int h            = get_optional<int>(jOut, CONST_PARAM_NAME_HEIGHT).value_or(0);
-        pformat->nWidth  = (w > 0) ? w : 0;
-        pformat->nHeight = (h > 0) ? h : 0;
-        pformat->nFps    = get_optional<int>(jOut, CONST_PARAM_NAME_FPS).value_or(0);
-        pformat->eFormat = get_optional<camera_format_t>(jOut, CONST_PARAM_NAME_FORMAT)
-                               .value_or(CAMERA_FORMAT_UNDEFINED);
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        formatCache_  = *pformat;
+        formatCached_ = true;
     }
-
     return ret;
 }
 
+bool CameraHalProxy::getCachedFormat(CAMERA_FORMAT *pformat)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    if (formatCached_)
+        *pformat = formatCache_;
+    return formatCached_;
+}
+
+bool CameraHalProxy::getCachedDeviceProperty(CAMERA_PROPERTIES_T *oparams)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    if (propertiesCached_)
+        *oparams = propertiesCache_;
+    return propertiesCached_;
+}
+
+void CameraHalProxy::updateCachedDeviceProperty(const CAMERA_PROPERTIES_T &changed)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    if (!propertiesCached_)
+        return;
+    for (int i = 0; i < PROPERTY_END; i++)
+    {
+        if (changed.stGetData.data[i][QUERY_VALUE] != CONST_PARAM_DEFAULT_VALUE)
+            propertiesCache_.stGetData.data[i][QUERY_VALUE] =
+                changed.stGetData.data[i][QUERY_VALUE];
+    }
+}
+
+void CameraHalProxy::refreshCachedDeviceProperty()
+{
+    // the device may have clamped the values or changed others along, they are read back
+    CAMERA_PROPERTIES_T properties;
+    if (getDeviceProperty(&properties) != DEVICE_OK)
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        propertiesCached_ = false;
+    }
+}
+
+void CameraHalProxy::clearCache()
+{
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    formatCached_     = false;
+    propertiesCached_ = false;
+}
+
 DEVICE_RETURN_CODE_T CameraHalProxy::addClient(int id)
 {
     PLOGI("");
 
+    HalCommandMessage cmd{};
+    HAL_REPLY_T reply{};
+    cmd.command = HalCommand::ADD_CLIENT;
+    cmd.id      = id;
+    if (channel_call(cmd, &reply))
+        return reply.ret;
+
     json jin;
     jin[CONST_PARAM_NAME_ID] = id;
 
@@ -458,19 +781,36 @@ DEVICE_RETURN_CODE_T CameraHalProxy::removeClient(int id)
 {
     PLOGI("");
 
+    HalCommandMessage cmd{};
+    HAL_REPLY_T reply{};
+    cmd.command = HalCommand::REMOVE_CLIENT;
+    cmd.id      = id;
+    if (channel_call(cmd, &reply))
+        return reply.ret;
+
     json jin;
     jin[CONST_PARAM_NAME_ID] = id;
 
     return luna_call_sync(__func__, to_string(jin));
 }
 
-DEVICE_RETURN_CODE_T CameraHalProxy::getFd(const std::string &type, int id, int *fd)
+DEVICE_RETURN_CODE_T CameraHalProxy::getFd(const std::string &type, int id, int *fd, int index)
 {
     PLOGI("");
 
+    HalCommandMessage cmd{};
+    HAL_REPLY_T reply{};
+    cmd.command = HalCommand::GET_FD;
+    cmd.id      = id;
+    cmd.value   = index;
+    cmd.name    = type;
+    if (channel_call(cmd, &reply, COMMAND_TIMEOUT, fd, 1))
+        return reply.ret;
+
     json jin;
-    jin[CONST_PARAM_NAME_TYPE] = type;
-    jin[CONST_PARAM_NAME_ID]   = id;
+    jin[CONST_PARAM_NAME_TYPE]  = type;
+    jin[CONST_PARAM_NAME_ID]    = id;
+    jin[CONST_PARAM_NAME_INDEX] = index;
     return luna_call_sync(__func__, to_string(jin), COMMAND_TIMEOUT, fd);
 }
 
@@ -496,7 +836,8 @@ CameraHalProxy::getSupportedCameraSolutionInfo(std::vector<std::string> &solutio
 }
 
 DEVICE_RETURN_CODE_T
-CameraHalProxy::getEnabledCameraSolutionInfo(std::vector<std::string> &solutionsInfo)
+CameraHalProxy::getEnabledCameraSolutionInfo(std::vector<std::string> &solutionsInfo,
+                                             std::vector<solution_status_t> *pStatus)
 {
     PLOGI("");
 
@@ -512,10 +853,33 @@ CameraHalProxy::getEnabledCameraSolutionInfo(std::vector<std::string> &solutions
         }
     }
 
+    if (ret == DEVICE_OK && pStatus && jOut.contains(CONST_PARAM_NAME_STATUS))
+    {
+        for (const auto &j : jOut[CONST_PARAM_NAME_STATUS])
+        {
+            solution_status_t status;
+            status.name       = get_optional<std::string>(j, CONST_PARAM_NAME_NAME).value_or("");
+            status.fps        = get_optional<double>(j, CONST_PARAM_NAME_FPS).value_or(0.0);
+            status.latency_ms = get_optional<int>(j, CONST_PARAM_NAME_LATENCY).value_or(0);
+            status.skipped    = get_optional<uint64_t>(j, CONST_PARAM_NAME_SKIPPED).value_or(0);
+
+            json jparams = get_optional<json>(j, CONST_PARAM_NAME_PARAMS).value_or(json::object());
+            status.schedule.fps =
+                get_optional<double>(jparams, CONST_PARAM_NAME_FPS).value_or(0.0);
+            status.schedule.max_latency_ms =
+                get_optional<int>(jparams, CONST_PARAM_NAME_MAX_LATENCY).value_or(0);
+            status.schedule.priority =
+                get_optional<int>(jparams, CONST_PARAM_NAME_PRIORITY).value_or(0);
+            pStatus->push_back(std::move(status));
+        }
+    }
+
     return ret;
 }
 
-DEVICE_RETURN_CODE_T CameraHalProxy::enableCameraSolution(const std::vector<std::string> &solutions)
+DEVICE_RETURN_CODE_T
+CameraHalProxy::enableCameraSolution(const std::vector<std::string> &solutions,
+                                     const std::map<std::string, solution_schedule_t> &schedules)
 {
     PLOGI("");
 
@@ -526,6 +890,20 @@ DEVICE_RETURN_CODE_T CameraHalProxy::enableCameraSolution(const std::vector<std:
         jin[CONST_PARAM_NAME_SOLUTIONS].push_back(s);
     }
 
+    if (!schedules.empty())
+    {
+        jin[CONST_PARAM_NAME_SCHEDULES] = json::array();
+        for (const auto &[name, schedule] : schedules)
+        {
+            json jschedule;
+            jschedule[CONST_PARAM_NAME_NAME]        = name;
+            jschedule[CONST_PARAM_NAME_FPS]         = schedule.fps;
+            jschedule[CONST_PARAM_NAME_MAX_LATENCY] = schedule.max_latency_ms;
+            jschedule[CONST_PARAM_NAME_PRIORITY]    = schedule.priority;
+            jin[CONST_PARAM_NAME_SCHEDULES].push_back(jschedule);
+        }
+    }
+
     return luna_call_sync(__func__, to_string(jin));
 }
 
@@ -545,39 +923,90 @@ CameraHalProxy::disableCameraSolution(const std::vector<std::string> &solutions)
 }
 //[Camera Solution Manager] interfaces end
 
+struct CameraHalProxy::StatusWatch
+{
+    std::mutex mutex;
+    CameraHalProxy *proxy{nullptr}; // cleared by unsubscribe, the proxy may be gone after
+    LSHandle *sh{nullptr};
+    void *cookie{nullptr};
+};
+
+static void cancelServerStatus(LSHandle *sh, void **cookie)
+{
+    if (sh == nullptr || *cookie == nullptr)
+        return;
+
+    PLOGI("LSCancelServerStatus");
+    try
+    {
+        if (!LSCancelServerStatus(sh, *cookie, nullptr))
+        {
+            PLOGE("error LSCancelServerStatus");
+        }
+    }
+    catch (const std::ios::failure &e)
+    {
+        PLOGE("Caught a std::ios::failure %s", e.what());
+    }
+    *cookie = nullptr;
+}
+
 bool CameraHalProxy::subscribe()
 {
     PLOGI("");
 
+    if (watch_ != nullptr || hal_ == nullptr)
+        return true;
+
     auto func = [](LSHandle *input_handle, const char *service_name, bool connected,
                    void *ctx) -> bool
     {
         PLOGI("[ServerStatus cb] connected=%d, name=%s\n", connected, service_name);
 
-        CameraHalProxy *self = static_cast<CameraHalProxy *>(ctx);
+        StatusWatch *watch = static_cast<StatusWatch *>(ctx);
+        std::lock_guard<std::mutex> lock(watch->mutex);
+        CameraHalProxy *self = watch->proxy;
+        if (self == nullptr)
+            return true;
+
         if (connected)
         {
-            std::string uri = self->service_uri_ + "subscribe";
-            bool ret        = self->luna_client->subscribe(uri.c_str(), "{\"subscribe\":true}",
+            std::string uri = self->hal_->serviceUri + "subscribe";
+            bool ret        = self->hal_->client->subscribe(uri.c_str(), "{\"subscribe\":true}",
                                                            &self->subscribeKey_, cameraHalServiceCb, self);
             PLOGI("[ServerStatus cb] subscribeKey_ %ld, %d ", self->subscribeKey_, ret);
         }
         else
         {
             PLOGI("[ServerStatus cb] cancel server status");
-            if (self != nullptr && self->cookie != nullptr)
+            if (self->subscribeKey_)
             {
-                self->unsubscribe();
+                self->hal_->client->unsubscribe(self->subscribeKey_);
+                self->subscribeKey_ = 0;
             }
+            cancelServerStatus(watch->sh, &watch->cookie);
         }
         return true;
     };
 
-    if (!LSRegisterServerStatusEx(sh_, uid_.c_str(), func, static_cast<void *>(this), &cookie,
-                                  nullptr))
-    {
-        PLOGE("[ServerStatus cb] error LSRegisterServerStatusEx\n");
-    }
+    watch_        = std::make_shared<StatusWatch>();
+    watch_->proxy = this;
+    watch_->sh    = sh_;
+
+    // Called on the worker of the camera, the registration on the luna handle of the service
+    // is made on the main loop. The watch outlives the proxy until it is cancelled there.
+    RequestDispatcher::complete(
+        [watch = watch_, uid = hal_->uid, func]()
+        {
+            std::lock_guard<std::mutex> lock(watch->mutex);
+            if (watch->proxy == nullptr || watch->sh == nullptr)
+                return;
+            if (!LSRegisterServerStatusEx(watch->sh, uid.c_str(), func, watch.get(),
+                                          &watch->cookie, nullptr))
+            {
+                PLOGE("[ServerStatus cb] error LSRegisterServerStatusEx\n");
+            }
+        });
 
     return true;
 }
@@ -586,38 +1015,52 @@ bool CameraHalProxy::unsubscribe()
 {
     PLOGI("");
 
-    bool ret = true;
-    if (subscribeKey_)
-    {
-        PLOGI("remove subscribeKey_ %ld", subscribeKey_);
-        ret           = luna_client->unsubscribe(subscribeKey_);
-        subscribeKey_ = 0;
-    }
+    if (watch_ == nullptr)
+        return true;
 
-    if (sh_ != nullptr && cookie != nullptr)
+    bool ret = true;
     {
-        PLOGI("LSCancelServerStatus");
-        try
-        {
-            if (!LSCancelServerStatus(sh_, cookie, nullptr))
-            {
-                PLOGE("error LSCancelServerStatus");
-            }
-        }
-        catch (const std::ios::failure &e)
+        std::lock_guard<std::mutex> lock(watch_->mutex);
+        watch_->proxy = nullptr;
+        if (subscribeKey_)
         {
-            PLOGE("Caught a std::ios::failure %s", e.what());
+            PLOGI("remove subscribeKey_ %ld", subscribeKey_);
+            ret           = hal_->client->unsubscribe(subscribeKey_);
+            subscribeKey_ = 0;
         }
-        cookie = nullptr;
     }
 
+    // after the registration queued by subscribe
+    RequestDispatcher::complete(
+        [watch = std::move(watch_)]()
+        {
+            std::lock_guard<std::mutex> lock(watch->mutex);
+            cancelServerStatus(watch->sh, &watch->cookie);
+        });
+
     return ret;
 }
 
+bool CameraHalProxy::channel_call(HalCommandMessage &cmd, HAL_REPLY_T *reply, int timeout, int *fds,
+                                  size_t nfds)
+{
+    if (hal_ == nullptr || hal_->channel == nullptr)
+        return false;
+
+    int64_t startClk = g_get_monotonic_time();
+    if (!hal_->channel->call(cmd, reply, timeout, fds, nfds))
+        return false;
+    int64_t endClk = g_get_monotonic_time();
+
+    PLOGD("command %d, ret %d, runtime %lld us", static_cast<int>(cmd.command),
+          static_cast<int>(reply->ret), (long long int)(endClk - startClk));
+    return true;
+}
+
 DEVICE_RETURN_CODE_T CameraHalProxy::luna_call_sync(const char *func, const std::string &payload,
                                                     int timeout, int *fd)
 {
-    if (process_ == nullptr)
+    if (hal_ == nullptr)
     {
         PLOGE("hal process is not ready");
         return DEVICE_ERROR_UNKNOWN;
@@ -630,12 +1073,12 @@ DEVICE_RETURN_CODE_T CameraHalProxy::luna_call_sync(const char *func, const std:
     }
 
     // send message
-    std::string uri = service_uri_ + func;
+    std::string uri = hal_->serviceUri + func;
     PLOGI("%s '%s'", uri.c_str(), payload.c_str());
 
     std::string resp;
     int64_t startClk = g_get_monotonic_time();
-    luna_client->callSync(uri.c_str(), payload.c_str(), &resp, timeout, fd);
+    hal_->client->callSync(uri.c_str(), payload.c_str(), &resp, timeout, fd);
     int64_t endClk = g_get_monotonic_time();
 
     (startClk > endClk) ? PLOGE("diffClk is error")
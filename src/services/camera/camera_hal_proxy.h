@@ -16,7 +16,9 @@
 #pragma once
 
 #include "camera_types.h"
+#include <map>
 #include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <string>
 #include <thread>
@@ -25,19 +27,18 @@
 #define COMMAND_TIMEOUT 4000       // ms
 #define COMMAND_TIMEOUT_LONG 12000 // ms
 
-class LunaClient;
-class Process;
+class HalConnection;
+enum class HalCommand : int32_t;
+struct HalCommandMessage;
+struct HAL_REPLY_T;
 class CameraHalProxy
 {
-    std::unique_ptr<LunaClient> luna_client{nullptr};
-    std::unique_ptr<Process> process_{nullptr};
-    std::string service_uri_;
+    std::unique_ptr<HalConnection> hal_;
 
-    GMainLoop *loop_{nullptr};
-    std::unique_ptr<std::thread> loopThread_;
     unsigned long subscribeKey_{0};
-    void *cookie{nullptr};
-    std::string uid_;
+    // server status registration of the HAL, made and cancelled on the main loop
+    struct StatusWatch;
+    std::shared_ptr<StatusWatch> watch_;
     using json = nlohmann::json;
     json jOut;
 
@@ -48,38 +49,71 @@ class CameraHalProxy
         DESTROY
     } state_;
 
+    // format and properties last read from or set to the HAL, for the read-only requests
+    std::mutex cacheMutex_;
+    bool formatCached_{false};
+    CAMERA_FORMAT formatCache_{};
+    bool propertiesCached_{false};
+    CAMERA_PROPERTIES_T propertiesCache_;
+    void clearCache();
+    void refreshCachedDeviceProperty();
+
     DEVICE_RETURN_CODE_T luna_call_sync(const char *func, const std::string &payload,
                                         int timeout = COMMAND_TIMEOUT, int *fd = nullptr);
+    // Sends cmd on the command channel. Returns false if the channel is not available.
+    bool channel_call(HalCommandMessage &cmd, HAL_REPLY_T *reply, int timeout = COMMAND_TIMEOUT,
+                      int *fds = nullptr, size_t nfds = 0);
 
 public:
     CameraHalProxy();
     ~CameraHalProxy();
 
     DEVICE_RETURN_CODE_T open(std::string devicenode, int ndev_id, std::string payload);
+    // open, setFormat (if sformat.nWidth is set), startPreview, addClient(id) and, for shmem,
+    // getFd of the buffer and the signal of id as one command. The HAL undoes the done steps
+    // on a failure and reports the failed one in step. Returns false if the HAL can not take it,
+    // the caller goes step by step then.
+    bool openStream(const std::string &devicenode, int ndev_id, CAMERA_FORMAT sformat,
+                    LSHandle *sh, const std::string &memtype, int id, DEVICE_RETURN_CODE_T *ret,
+                    HalCommand *step, int *bufferfd, int *signalfd);
     DEVICE_RETURN_CODE_T close();
-    DEVICE_RETURN_CODE_T startPreview(LSHandle *sh);
+    DEVICE_RETURN_CODE_T startPreview(LSHandle *sh, const std::string &memtype = cstr_shmem);
     DEVICE_RETURN_CODE_T stopPreview(bool forceComplete);
     DEVICE_RETURN_CODE_T startCapture(CAMERA_FORMAT sformat, const std::string &imagepath,
                                       const std::string &mode, int ncount, const int devHandle = 0);
-    DEVICE_RETURN_CODE_T stopCapture(const int devHandle);
+    // The statistics of the capture are stored to pStats, if given.
+    DEVICE_RETURN_CODE_T stopCapture(const int devHandle, CAPTURE_STATS_T *pStats = nullptr);
     DEVICE_RETURN_CODE_T capture(int ncount, const std::string &imagepath,
-                                 std::vector<std::string> &capturedFiles);
+                                 std::vector<std::string> &capturedFiles,
+                                 CAPTURE_STATS_T *pStats = nullptr);
     DEVICE_RETURN_CODE_T createHal(std::string subsystem);
     DEVICE_RETURN_CODE_T destroyHal();
     static DEVICE_RETURN_CODE_T getDeviceInfo(std::string strdevicenode, std::string strdevicetype,
                                               camera_device_info_t *pinfo);
     DEVICE_RETURN_CODE_T getDeviceProperty(CAMERA_PROPERTIES_T *oparams);
-    DEVICE_RETURN_CODE_T setDeviceProperty(CAMERA_PROPERTIES_T *inparams);
+    // The values of the properties the device rejected are stored to failed, if given.
+    DEVICE_RETURN_CODE_T setDeviceProperty(CAMERA_PROPERTIES_T *inparams,
+                                           CAMERA_PROPERTIES_T *failed = nullptr);
     DEVICE_RETURN_CODE_T setFormat(CAMERA_FORMAT sformat);
     DEVICE_RETURN_CODE_T getFormat(CAMERA_FORMAT *pformat);
+    // The format and properties of the device without a command to the HAL, so any thread may
+    // call them. false if they have not been read since the device was opened.
+    bool getCachedFormat(CAMERA_FORMAT *pformat);
+    bool getCachedDeviceProperty(CAMERA_PROPERTIES_T *oparams);
+    // Takes the values of the properties event of the HAL into the cache.
+    void updateCachedDeviceProperty(const CAMERA_PROPERTIES_T &changed);
     DEVICE_RETURN_CODE_T addClient(int id);
     DEVICE_RETURN_CODE_T removeClient(int id);
-    DEVICE_RETURN_CODE_T getFd(const std::string &type, int id, int *fd);
+    DEVICE_RETURN_CODE_T getFd(const std::string &type, int id, int *fd, int index = 0);
 
     //[Camera Solution Manager] integration start
     DEVICE_RETURN_CODE_T getSupportedCameraSolutionInfo(std::vector<std::string> &);
-    DEVICE_RETURN_CODE_T getEnabledCameraSolutionInfo(std::vector<std::string> &);
-    DEVICE_RETURN_CODE_T enableCameraSolution(const std::vector<std::string> &);
+    DEVICE_RETURN_CODE_T
+    getEnabledCameraSolutionInfo(std::vector<std::string> &,
+                                 std::vector<solution_status_t> *pStatus = nullptr);
+    DEVICE_RETURN_CODE_T
+    enableCameraSolution(const std::vector<std::string> &,
+                         const std::map<std::string, solution_schedule_t> &schedules = {});
     DEVICE_RETURN_CODE_T disableCameraSolution(const std::vector<std::string> &);
     //[Camera Solution Manager] integration end
 
@@ -25,8 +25,10 @@
 #include "camera_types.h"
 #include "command_manager.h"
 #include "device_manager.h"
+#include "hal_process_pool.h"
 #include "json_schema.h"
 #include "notifier.h"
+#include "request_dispatcher.h"
 #include "whitelist_checker.h"
 #include <pbnjson.hpp>
 #include <signal.h>
@@ -58,6 +60,7 @@ CameraService::CameraService() : LS::Handle(LS::registerService(cstr_uricamerama
     LS_CATEGORY_METHOD(setSolutions)
     LS_CATEGORY_METHOD(getSolutions)
     LS_CATEGORY_METHOD(getFormat)
+    LS_CATEGORY_METHOD(openStream)
     LS_CATEGORY_END;
 
     // attach to mainloop and run it
@@ -75,6 +78,9 @@ CameraService::CameraService() : LS::Handle(LS::registerService(cstr_uricamerama
     // set LS handle for device manager
     DeviceManager::getInstance().setLSHandle(this->get());
 
+    // start the HAL processes that camera open takes
+    HalProcessPool::getInstance().start();
+
     // subscribe to pdm client
     Notifier notifier;
     notifier.setLSHandle(this->get());
@@ -116,41 +122,106 @@ int CameraService::getId(const std::string &cameraid)
 void CameraService::createEventMessage(EventType etype, void *p_old_data, int devhandle,
                                        std::string event_key)
 {
-    if (event_obj.getSubscribeCount(this->get(), event_key) > 0)
+    // called on the worker of the camera, the event goes out from the main loop
+    if (EventType::EVENT_TYPE_FORMAT == etype)
     {
-        if (EventType::EVENT_TYPE_FORMAT == etype)
-        {
-            PLOGI("EVENT_TYPE_FORMAT Event received\n");
-            CAMERA_FORMAT newformat;
-            CommandManager::getInstance().getFormat(devhandle, &newformat);
+        PLOGI("EVENT_TYPE_FORMAT Event received\n");
+        CAMERA_FORMAT newformat;
+        CommandManager::getInstance().getFormat(devhandle, &newformat);
 
-            auto *p_old_format = static_cast<CAMERA_FORMAT *>(p_old_data);
+        CAMERA_FORMAT oldformat = *static_cast<CAMERA_FORMAT *>(p_old_data);
 
-            if (*p_old_format != newformat)
-            {
-                auto *p_cur_data = static_cast<void *>(&newformat);
-                event_obj.eventReply(this->get(), event_key.c_str(), etype, p_cur_data, p_old_data);
-            }
-        }
-        else if (EventType::EVENT_TYPE_PROPERTIES == etype)
+        if (oldformat != newformat)
         {
-            PLOGI("EVENT_TYPE_PROPERTIES Event received\n");
-            CAMERA_PROPERTIES_T new_property;
-            CommandManager::getInstance().getProperty(devhandle, &new_property);
+            RequestDispatcher::complete(
+                [this, etype, event_key, oldformat, newformat]() mutable
+                {
+                    event_obj.eventReply(this->get(), event_key, etype,
+                                         static_cast<void *>(&newformat),
+                                         static_cast<void *>(&oldformat));
+                });
+        }
+    }
+    else if (EventType::EVENT_TYPE_PROPERTIES == etype)
+    {
+        PLOGI("EVENT_TYPE_PROPERTIES Event received\n");
+        CAMERA_PROPERTIES_T new_property;
+        CommandManager::getInstance().getProperty(devhandle, &new_property);
 
-            auto *p_old_property = static_cast<CAMERA_PROPERTIES_T *>(p_old_data);
+        CAMERA_PROPERTIES_T old_property = *static_cast<CAMERA_PROPERTIES_T *>(p_old_data);
 
-            if (*p_old_property != new_property)
-            {
-                auto *p_cur_data = static_cast<void *>(&new_property);
-                event_obj.eventReply(this->get(), event_key.c_str(), etype, p_cur_data, p_old_data);
-            }
-        }
-        else
+        if (old_property != new_property)
         {
-            PLOGI("Unknown Event received\n");
+            RequestDispatcher::complete(
+                [this, etype, event_key, old_property, new_property]() mutable
+                {
+                    event_obj.eventReply(this->get(), event_key, etype,
+                                         static_cast<void *>(&new_property),
+                                         static_cast<void *>(&old_property));
+                });
         }
     }
+    else
+    {
+        PLOGI("Unknown Event received\n");
+    }
+}
+
+// Responds to msg, referenced by the caller, from the main loop.
+static void respondRequest(LSMessage *msg, const std::string &output_reply)
+{
+    PLOGI("output_reply %s\n", output_reply.c_str());
+
+    RequestDispatcher::complete(
+        [msg, output_reply]()
+        {
+            LS::Message request(msg);
+            request.respond(output_reply.c_str());
+            LSMessageUnref(msg);
+        });
+}
+
+static void runRequest(LSMessage *msg, int deviceid, std::function<std::string()> job)
+{
+    auto run = [msg, job]() { respondRequest(msg, job()); };
+
+    if (n_invalid_id == deviceid)
+        run();
+    else
+        RequestDispatcher::getInstance().dispatch(deviceid, run);
+}
+
+void CameraService::dispatchRequest(LSMessage &message, int deviceid,
+                                    std::function<std::string()> job)
+{
+    // the message is kept until the reply is sent
+    LSMessage *msg = &message;
+    LSMessageRef(msg);
+
+    runRequest(msg, deviceid, std::move(job));
+}
+
+void CameraService::dispatchQuery(LSMessage &message, int deviceid,
+                                  std::function<bool(std::string &)> query,
+                                  std::function<std::string()> job)
+{
+    LSMessage *msg = &message;
+    LSMessageRef(msg);
+
+    auto run = [msg, deviceid, query, job]()
+    {
+        std::string output_reply;
+        if (query(output_reply) || !job)
+            respondRequest(msg, output_reply);
+        else
+            // the HAL is asked in the order of the commands of the camera
+            runRequest(msg, deviceid, job);
+    };
+
+    if (n_invalid_id == deviceid)
+        run();
+    else
+        RequestDispatcher::getInstance().dispatchQuery(deviceid, run);
 }
 
 bool CameraService::open(LSMessage &message)
@@ -163,6 +234,7 @@ bool CameraService::open(LSMessage &message)
     open.getOpenObject(payload, openSchema);
 
     DEVICE_RETURN_CODE_T err_id = DEVICE_OK;
+    int ndev_id                 = n_invalid_id;
 
     std::string app_id = open.getAppId();
     PLOGI("appId : %s", app_id.c_str());
@@ -181,36 +253,133 @@ bool CameraService::open(LSMessage &message)
     }
     else
     {
-        int ndev_id = getId(open.getCameraId());
+        ndev_id = getId(open.getCameraId());
         PLOGI("device Id %d\n", ndev_id);
-        std::string app_priority = open.getAppPriority();
-        PLOGI("priority : %s \n", app_priority.c_str());
-        int ndevice_handle = n_invalid_id;
+    }
 
-        // open camera device and save fd
-        err_id = CommandManager::getInstance().open(ndev_id, &ndevice_handle, std::move(app_id),
-                                                    std::move(app_priority));
-        if (DEVICE_OK != err_id)
-        {
-            PLOGE("err_id != DEVICE_OK\n");
-            open.setMethodReply(CONST_PARAM_VALUE_FALSE, (int)err_id, getErrorString(err_id));
-        }
-        else
+    LSMessage *msg = &message;
+    auto job       = [this, msg, open, err_id, ndev_id, app_id]() mutable
+    {
+        if (DEVICE_OK == err_id)
         {
-            PLOGD("err_id == DEVICE_OK\n");
-            open.setMethodReply(CONST_PARAM_VALUE_TRUE, (int)err_id, getErrorString(err_id));
-            open.setDeviceHandle(ndevice_handle);
+            std::string app_priority = open.getAppPriority();
+            PLOGI("priority : %s \n", app_priority.c_str());
+            int ndevice_handle = n_invalid_id;
 
-            addClientWatcher(this->get(), &message, ndevice_handle);
+            // open camera device and save fd
+            err_id = CommandManager::getInstance().open(ndev_id, &ndevice_handle, std::move(app_id),
+                                                        std::move(app_priority));
+            if (DEVICE_OK != err_id)
+            {
+                PLOGE("err_id != DEVICE_OK\n");
+                open.setMethodReply(CONST_PARAM_VALUE_FALSE, (int)err_id, getErrorString(err_id));
+            }
+            else
+            {
+                PLOGD("err_id == DEVICE_OK\n");
+                open.setMethodReply(CONST_PARAM_VALUE_TRUE, (int)err_id, getErrorString(err_id));
+                open.setDeviceHandle(ndevice_handle);
+
+                // queued before the reply, the message is still alive then
+                RequestDispatcher::complete([this, msg, ndevice_handle]()
+                                            { addClientWatcher(this->get(), msg, ndevice_handle); });
+            }
         }
+
+        // create json string now for LS reply
+        return open.createOpenObjectJsonString();
+    };
+    dispatchRequest(message, ndev_id, job);
+
+    return true;
+}
+
+bool CameraService::openStream(LSMessage &message)
+{
+    auto *payload = LSMessageGetPayload(&message);
+    PLOGI("payload %s", payload);
+
+    OpenStreamMethod obj_openstream;
+    obj_openstream.getOpenStreamObject(payload, openStreamSchema);
+
+    DEVICE_RETURN_CODE_T err_id = DEVICE_OK;
+    int ndev_id                 = n_invalid_id;
+
+    std::string app_id = obj_openstream.getAppId();
+    PLOGI("appId : %s", app_id.c_str());
+    // camera id & appId validation check, as open
+    if (cstr_invaliddeviceid == obj_openstream.getCameraId())
+    {
+        PLOGE("DEVICE_ERROR_JSON_PARSING");
+        err_id = DEVICE_ERROR_JSON_PARSING;
+    }
+    else if (pAddon_ && pAddon_->hasImplementation() && !pAddon_->isAppPermission(app_id))
+    {
+        PLOGE("CameraService::App Permission Fail\n");
+        err_id = DEVICE_ERROR_APP_PERMISSION;
+    }
+    else
+    {
+        ndev_id = getId(obj_openstream.getCameraId());
+        PLOGI("device Id %d\n", ndev_id);
     }
 
-    // create json string now for LS reply
-    std::string output_reply = open.createOpenObjectJsonString();
-    PLOGI("output_reply %s\n", output_reply.c_str());
+    // the reply carries the buffer fd, it is sent here rather than by dispatchRequest
+    LSMessage *msg = &message;
+    LSMessageRef(msg);
 
-    LS::Message request(&message);
-    request.respond(output_reply.c_str());
+    auto job = [this, msg, obj_openstream, err_id, ndev_id, app_id]() mutable
+    {
+        int ndevice_handle = n_invalid_id;
+        int shmfd          = -1;
+        if (DEVICE_OK == err_id)
+        {
+            std::string app_priority = obj_openstream.getAppPriority();
+            std::string memtype      = obj_openstream.getMemType();
+            std::string step;
+            PLOGI("priority : %s, memtype : %s\n", app_priority.c_str(), memtype.c_str());
+
+            err_id = CommandManager::getInstance().openStream(
+                ndev_id, &ndevice_handle, std::move(app_id), std::move(app_priority),
+                obj_openstream.rGetCameraFormat(), this->get(), memtype, &shmfd, step);
+            if (DEVICE_OK != err_id)
+                obj_openstream.setFailedStep(step);
+            else
+                obj_openstream.setDeviceHandle(ndevice_handle);
+        }
+        obj_openstream.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
+
+        // create json string now for reply
+        std::string output_reply = obj_openstream.createOpenStreamObjectJsonString();
+        PLOGI("output_reply %s\n", output_reply.c_str());
+
+        bool battach = (err_id == DEVICE_OK && shmfd >= 0);
+        bool bopened = (err_id == DEVICE_OK);
+        RequestDispatcher::complete(
+            [this, msg, output_reply, shmfd, battach, bopened, ndevice_handle]()
+            {
+                if (bopened)
+                    addClientWatcher(this->get(), msg, ndevice_handle);
+
+                LS::Message request(msg);
+                if (battach)
+                {
+                    LS::Payload response_payload(output_reply.c_str());
+                    response_payload.attachFd(shmfd); // attach a fd here
+                    request.respond(std::move(response_payload));
+                }
+                else
+                {
+                    request.respond(output_reply.c_str());
+                }
+                LSMessageUnref(msg);
+            });
+    };
+
+    if (n_invalid_id == ndev_id)
+        job();
+    else
+        RequestDispatcher::getInstance().dispatch(ndev_id, job);
 
     return true;
 }
@@ -230,31 +399,31 @@ bool CameraService::close(LSMessage &message)
 
     err_id = validateClient(&message, ndevhandle);
 
-    // close the device if there is no error on previous checks
-    if (err_id == DEVICE_OK)
+    auto job = [obj_close, ndevhandle, err_id]() mutable
     {
-        // close device here
-        err_id = CommandManager::getInstance().close(ndevhandle);
-
-        if (DEVICE_OK != err_id)
-        {
-            PLOGD("err_id != DEVICE_OK\n");
-        }
-        else
+        // close the device if there is no error on previous checks
+        if (err_id == DEVICE_OK)
         {
-            PLOGD("err_id == DEVICE_OK\n");
-        }
-    }
+            // close device here
+            err_id = CommandManager::getInstance().close(ndevhandle);
 
-    std::string errorMsg = getErrorString(err_id);
-    obj_close.setMethodReply(err_id == DEVICE_OK, (int)err_id, std::move(errorMsg));
+            if (DEVICE_OK != err_id)
+            {
+                PLOGD("err_id != DEVICE_OK\n");
+            }
+            else
+            {
+                PLOGD("err_id == DEVICE_OK\n");
+            }
+        }
 
-    // create json string now for reply
-    std::string output_reply = obj_close.createObjectJsonString();
-    PLOGI("output_reply %s\n", output_reply.c_str());
+        std::string errorMsg = getErrorString(err_id);
+        obj_close.setMethodReply(err_id == DEVICE_OK, (int)err_id, std::move(errorMsg));
 
-    LS::Message request(&message);
-    request.respond(output_reply.c_str());
+        // create json string now for reply
+        return obj_close.createObjectJsonString();
+    };
+    dispatchRequest(message, CommandManager::getInstance().getCameraId(ndevhandle), job);
 
     return true;
 }
@@ -272,27 +441,29 @@ bool CameraService::startCamera(LSMessage &message)
 
     err_id = validateClient(&message, ndevhandle);
 
-    if (err_id == DEVICE_OK)
+    auto job = [this, obj_startcamera, ndevhandle, err_id]() mutable
     {
-        // start preview here
-        err_id = CommandManager::getInstance().startCamera(ndevhandle, this->get());
-        if (DEVICE_OK != err_id)
-        {
-            PLOGE("err_id != DEVICE_OK\n");
-        }
-        else
+        if (err_id == DEVICE_OK)
         {
-            PLOGI("err_id == DEVICE_OK\n");
+            // start preview here
+            err_id = CommandManager::getInstance().startCamera(ndevhandle, this->get(),
+                                                               obj_startcamera.getMemType());
+            if (DEVICE_OK != err_id)
+            {
+                PLOGE("err_id != DEVICE_OK\n");
+            }
+            else
+            {
+                PLOGI("err_id == DEVICE_OK\n");
+            }
         }
-    }
 
-    obj_startcamera.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
+        obj_startcamera.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
 
-    // create json string now for reply
-    std::string output_reply = obj_startcamera.createStartCameraObjectJsonString();
-    PLOGI("output_reply %s\n", output_reply.c_str());
-    LS::Message request(&message);
-    request.respond(output_reply.c_str());
+        // create json string now for reply
+        return obj_startcamera.createStartCameraObjectJsonString();
+    };
+    dispatchRequest(message, CommandManager::getInstance().getCameraId(ndevhandle), job);
 
     return true;
 }
@@ -310,28 +481,28 @@ bool CameraService::stopCamera(LSMessage &message)
 
     err_id = validateClient(&message, ndevhandle);
 
-    if (err_id == DEVICE_OK)
+    auto job = [obj_stopcamera, ndevhandle, err_id]() mutable
     {
-        // stop preview here
-        err_id = CommandManager::getInstance().stopCamera(ndevhandle);
-
-        if (DEVICE_OK != err_id)
-        {
-            PLOGD("err_id != DEVICE_OK\n");
-        }
-        else
+        if (err_id == DEVICE_OK)
         {
-            PLOGD("err_id == DEVICE_OK\n");
-        }
-    }
+            // stop preview here
+            err_id = CommandManager::getInstance().stopCamera(ndevhandle);
 
-    obj_stopcamera.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
-    // create json string now for reply
-    std::string output_reply = obj_stopcamera.createObjectJsonString();
-    PLOGI("output_reply %s\n", output_reply.c_str());
+            if (DEVICE_OK != err_id)
+            {
+                PLOGD("err_id != DEVICE_OK\n");
+            }
+            else
+            {
+                PLOGD("err_id == DEVICE_OK\n");
+            }
+        }
 
-    LS::Message request(&message);
-    request.respond(output_reply.c_str());
+        obj_stopcamera.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
+        // create json string now for reply
+        return obj_stopcamera.createObjectJsonString();
+    };
+    dispatchRequest(message, CommandManager::getInstance().getCameraId(ndevhandle), job);
 
     return true;
 }
@@ -341,7 +512,6 @@ bool CameraService::startPreview(LSMessage &message)
     auto *payload = LSMessageGetPayload(&message);
     PLOGI("payload %s", payload);
     DEVICE_RETURN_CODE_T err_id = DEVICE_OK;
-    camera_display_source_t dispType;
 
     StartPreviewMethod obj_startpreview;
     obj_startpreview.getStartPreviewObject(payload, startPreviewSchema);
@@ -350,31 +520,32 @@ bool CameraService::startPreview(LSMessage &message)
 
     err_id = validateClient(&message, ndevhandle);
 
-    if (err_id == DEVICE_OK)
+    auto job = [this, obj_startpreview, ndevhandle, err_id]() mutable
     {
-        // start preview here
-        dispType = obj_startpreview.rGetDpyParams();
+        if (err_id == DEVICE_OK)
+        {
+            // start preview here
+            camera_display_source_t dispType = obj_startpreview.rGetDpyParams();
 
-        err_id = CommandManager::getInstance().startPreview(ndevhandle, dispType.str_window_id,
-                                                            this->get());
+            err_id = CommandManager::getInstance().startPreview(ndevhandle, dispType.str_window_id,
+                                                                this->get());
 
-        if (DEVICE_OK != err_id)
-        {
-            PLOGE("err_id != DEVICE_OK\n");
-        }
-        else
-        {
-            PLOGI("err_id == DEVICE_OK\n");
+            if (DEVICE_OK != err_id)
+            {
+                PLOGE("err_id != DEVICE_OK\n");
+            }
+            else
+            {
+                PLOGI("err_id == DEVICE_OK\n");
+            }
         }
-    }
 
-    obj_startpreview.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
+        obj_startpreview.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
 
-    // create json string now for reply
-    std::string output_reply = obj_startpreview.createStartPreviewObjectJsonString();
-    PLOGI("output_reply %s\n", output_reply.c_str());
-    LS::Message request(&message);
-    request.respond(output_reply.c_str());
+        // create json string now for reply
+        return obj_startpreview.createStartPreviewObjectJsonString();
+    };
+    dispatchRequest(message, CommandManager::getInstance().getCameraId(ndevhandle), job);
 
     return true;
 }
@@ -392,28 +563,28 @@ bool CameraService::stopPreview(LSMessage &message)
 
     err_id = validateClient(&message, ndevhandle);
 
-    if (err_id == DEVICE_OK)
+    auto job = [obj_stoppreview, ndevhandle, err_id]() mutable
     {
-        // stop preview here
-        err_id = CommandManager::getInstance().stopPreview(ndevhandle);
-
-        if (DEVICE_OK != err_id)
-        {
-            PLOGD("err_id != DEVICE_OK\n");
-        }
-        else
+        if (err_id == DEVICE_OK)
         {
-            PLOGD("err_id == DEVICE_OK\n");
-        }
-    }
+            // stop preview here
+            err_id = CommandManager::getInstance().stopPreview(ndevhandle);
 
-    obj_stoppreview.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
-    // create json string now for reply
-    std::string output_reply = obj_stoppreview.createObjectJsonString();
-    PLOGI("output_reply %s\n", output_reply.c_str());
+            if (DEVICE_OK != err_id)
+            {
+                PLOGD("err_id != DEVICE_OK\n");
+            }
+            else
+            {
+                PLOGD("err_id == DEVICE_OK\n");
+            }
+        }
 
-    LS::Message request(&message);
-    request.respond(output_reply.c_str());
+        obj_stoppreview.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
+        // create json string now for reply
+        return obj_stoppreview.createObjectJsonString();
+    };
+    dispatchRequest(message, CommandManager::getInstance().getCameraId(ndevhandle), job);
 
     return true;
 }
@@ -431,51 +602,53 @@ bool CameraService::startCapture(LSMessage &message)
 
     err_id = validateClient(&message, ndevhandle);
 
-    if (err_id == DEVICE_OK)
-    {
-        if ((CAMERA_FORMAT_JPEG != obj_startcapture.rGetParams().eFormat) &&
-            (CAMERA_FORMAT_YUV != obj_startcapture.rGetParams().eFormat))
-        {
-            err_id = DEVICE_ERROR_UNSUPPORTED_FORMAT;
-        }
-        else if (obj_startcapture.strGetCaptureMode() == cstr_burst &&
-                 obj_startcapture.getnImage() < 1)
-        {
-            err_id = DEVICE_ERROR_JSON_PARSING;
-        }
-        else
-        {
-            PLOGI("ndevhandle %d\n", ndevhandle);
-            PLOGI("path: %s\n", obj_startcapture.getImagePath().c_str());
-            PLOGI("mode: %s\n", obj_startcapture.strGetCaptureMode().c_str());
-            PLOGI("nImage : %d\n", obj_startcapture.getnImage());
-
-            uid_t requestor_uid = -1;
+    uid_t requestor_uid = -1;
 #if DAC_ENABLED
-            requestor_uid = LSMessageGetSenderUid(&message);
-            PLOGI("uid : %d\n", requestor_uid);
+    requestor_uid = LSMessageGetSenderUid(&message);
+    PLOGI("uid : %d\n", requestor_uid);
 #endif
-            err_id = CommandManager::getInstance().startCapture(
-                ndevhandle, obj_startcapture.rGetParams(), obj_startcapture.getImagePath(),
-                obj_startcapture.strGetCaptureMode(), obj_startcapture.getnImage(), requestor_uid);
-        }
-        if (DEVICE_OK != err_id)
-        {
-            PLOGD("err_id != DEVICE_OK\n");
-        }
-        else
+
+    auto job = [obj_startcapture, ndevhandle, err_id, requestor_uid]() mutable
+    {
+        if (err_id == DEVICE_OK)
         {
-            PLOGD("err_id == DEVICE_OK\n");
+            if ((CAMERA_FORMAT_JPEG != obj_startcapture.rGetParams().eFormat) &&
+                (CAMERA_FORMAT_YUV != obj_startcapture.rGetParams().eFormat))
+            {
+                err_id = DEVICE_ERROR_UNSUPPORTED_FORMAT;
+            }
+            else if (obj_startcapture.strGetCaptureMode() == cstr_burst &&
+                     obj_startcapture.getnImage() < 1)
+            {
+                err_id = DEVICE_ERROR_JSON_PARSING;
+            }
+            else
+            {
+                PLOGI("ndevhandle %d\n", ndevhandle);
+                PLOGI("path: %s\n", obj_startcapture.getImagePath().c_str());
+                PLOGI("mode: %s\n", obj_startcapture.strGetCaptureMode().c_str());
+                PLOGI("nImage : %d\n", obj_startcapture.getnImage());
+
+                err_id = CommandManager::getInstance().startCapture(
+                    ndevhandle, obj_startcapture.rGetParams(), obj_startcapture.getImagePath(),
+                    obj_startcapture.strGetCaptureMode(), obj_startcapture.getnImage(),
+                    requestor_uid);
+            }
+            if (DEVICE_OK != err_id)
+            {
+                PLOGD("err_id != DEVICE_OK\n");
+            }
+            else
+            {
+                PLOGD("err_id == DEVICE_OK\n");
+            }
         }
-    }
-
-    obj_startcapture.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
-    // create json string now for reply
-    std::string output_reply = obj_startcapture.createStartCaptureObjectJsonString();
-    PLOGI("output_reply %s\n", output_reply.c_str());
 
-    LS::Message request(&message);
-    request.respond(output_reply.c_str());
+        obj_startcapture.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
+        // create json string now for reply
+        return obj_startcapture.createStartCaptureObjectJsonString();
+    };
+    dispatchRequest(message, CommandManager::getInstance().getCameraId(ndevhandle), job);
 
     return true;
 }
@@ -493,28 +666,31 @@ bool CameraService::stopCapture(LSMessage &message)
 
     err_id = validateClient(&message, ndevhandle);
 
-    if (err_id == DEVICE_OK)
+    auto job = [obj_stopcapture, ndevhandle, err_id]() mutable
     {
-        // stop capture here
-        err_id = CommandManager::getInstance().stopCapture(ndevhandle);
-
-        if (DEVICE_OK != err_id)
-        {
-            PLOGD("err_id != DEVICE_OK\n");
-        }
-        else
+        if (err_id == DEVICE_OK)
         {
-            PLOGD("err_id == DEVICE_OK\n");
-        }
-    }
+            // stop capture here
+            CAPTURE_STATS_T stats = {0};
+            err_id = CommandManager::getInstance().stopCapture(ndevhandle, true, &stats);
+            if (err_id == DEVICE_OK)
+                obj_stopcapture.setCaptureStats(stats);
 
-    obj_stopcapture.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
-    // create json string now for reply
-    std::string output_reply = obj_stopcapture.createObjectJsonString();
-    PLOGI("output_reply %s\n", output_reply.c_str());
+            if (DEVICE_OK != err_id)
+            {
+                PLOGD("err_id != DEVICE_OK\n");
+            }
+            else
+            {
+                PLOGD("err_id == DEVICE_OK\n");
+            }
+        }
 
-    LS::Message request(&message);
-    request.respond(output_reply.c_str());
+        obj_stopcapture.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
+        // create json string now for reply
+        return obj_stopcapture.createObjectJsonString();
+    };
+    dispatchRequest(message, CommandManager::getInstance().getCameraId(ndevhandle), job);
 
     return true;
 }
@@ -524,58 +700,62 @@ bool CameraService::capture(LSMessage &message)
     auto *payload = LSMessageGetPayload(&message);
     PLOGI("payload %s", payload);
     DEVICE_RETURN_CODE_T err_id = DEVICE_OK;
-    const int max_capture       = 30;
 
     CaptureMethod obj_capture;
     obj_capture.getCaptureObject(payload, captureSchema);
 
     int ndevhandle = obj_capture.getDeviceHandle();
-    std::vector<std::string> capturedFileNames;
 
     err_id = validateClient(&message, ndevhandle);
 
-    if (err_id == DEVICE_OK)
+    uid_t requestor_uid = -1;
+#if DAC_ENABLED
+    requestor_uid = LSMessageGetSenderUid(&message);
+    PLOGI("uid : %d\n", requestor_uid);
+#endif
+
+    auto job = [obj_capture, ndevhandle, err_id, requestor_uid]() mutable
     {
-        PLOGI("ndevhandle %d\n", ndevhandle);
-        PLOGI("nImage : %d\n", obj_capture.getnImage());
-        PLOGI("path: %s\n", obj_capture.getImagePath().c_str());
+        const int max_capture = 30;
+        std::vector<std::string> capturedFileNames;
 
-        if (obj_capture.getnImage() > 0 && obj_capture.getnImage() <= max_capture)
+        if (err_id == DEVICE_OK)
         {
-            uid_t requestor_uid = -1;
+            PLOGI("ndevhandle %d\n", ndevhandle);
+            PLOGI("nImage : %d\n", obj_capture.getnImage());
+            PLOGI("path: %s\n", obj_capture.getImagePath().c_str());
 
-#if DAC_ENABLED
-            requestor_uid = LSMessageGetSenderUid(&message);
-            PLOGI("uid : %d\n", requestor_uid);
-#endif
+            if (obj_capture.getnImage() > 0 && obj_capture.getnImage() <= max_capture)
+            {
+                // capture image here
+                CAPTURE_STATS_T stats = {0};
+                err_id = CommandManager::getInstance().capture(ndevhandle, obj_capture.getnImage(),
+                                                               obj_capture.getImagePath(),
+                                                               capturedFileNames, requestor_uid,
+                                                               &stats);
+                if (err_id == DEVICE_OK)
+                    obj_capture.setCaptureStats(stats);
+            }
+            else
+            {
+                err_id = DEVICE_ERROR_OUT_OF_PARAM_RANGE;
+            }
+        }
 
-            // capture image here
-            err_id = CommandManager::getInstance().capture(ndevhandle, obj_capture.getnImage(),
-                                                           obj_capture.getImagePath(),
-                                                           capturedFileNames, requestor_uid);
+        if (DEVICE_OK != err_id)
+        {
+            PLOGD("err_id != DEVICE_OK\n");
         }
         else
         {
-            err_id = DEVICE_ERROR_OUT_OF_PARAM_RANGE;
+            PLOGD("err_id == DEVICE_OK\n");
         }
-    }
-
-    if (DEVICE_OK != err_id)
-    {
-        PLOGD("err_id != DEVICE_OK\n");
-    }
-    else
-    {
-        PLOGD("err_id == DEVICE_OK\n");
-    }
 
-    obj_capture.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
-    // create json string now for reply
-    std::string output_reply = obj_capture.createCaptureObjectJsonString(capturedFileNames);
-    PLOGI("output_reply %s\n", output_reply.c_str());
-
-    LS::Message request(&message);
-    request.respond(output_reply.c_str());
+        obj_capture.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
+        // create json string now for reply
+        return obj_capture.createCaptureObjectJsonString(capturedFileNames);
+    };
+    dispatchRequest(message, CommandManager::getInstance().getCameraId(ndevhandle), job);
 
     return true;
 }
@@ -585,7 +765,7 @@ bool CameraService::getInfo(LSMessage &message)
     auto *payload = LSMessageGetPayload(&message);
     PLOGI("payload %s", payload);
     DEVICE_RETURN_CODE_T err_id = DEVICE_OK;
-    bool supported              = false;
+    int ndev_id                 = n_invalid_id;
 
     GetInfoMethod obj_getinfo;
     obj_getinfo.getInfoObject(payload, getInfoSchema);
@@ -598,45 +778,58 @@ bool CameraService::getInfo(LSMessage &message)
     }
     else
     {
-        // get info here
-        camera_device_info_t o_camerainfo;
-
-        int ndev_id = getId(obj_getinfo.strGetDeviceId());
+        ndev_id = getId(obj_getinfo.strGetDeviceId());
         PLOGI("device Id %d\n", ndev_id);
+    }
 
-        err_id = CommandManager::getInstance().getDeviceInfo(ndev_id, &o_camerainfo);
+    auto job = [this, obj_getinfo, ndev_id, err_id]() mutable
+    {
+        bool supported = false;
 
-        if (DEVICE_OK != err_id)
-        {
-            PLOGD("err_id != DEVICE_OK\n");
-            obj_getinfo.setMethodReply(CONST_PARAM_VALUE_FALSE, (int)err_id,
-                                       getErrorString(err_id));
-        }
-        else
+        if (DEVICE_OK == err_id)
         {
-            PLOGD("err_id == DEVICE_OK\n");
-            obj_getinfo.setMethodReply(CONST_PARAM_VALUE_TRUE, (int)err_id, getErrorString(err_id));
-            obj_getinfo.setCameraInfo(o_camerainfo);
+            // get info here
+            camera_device_info_t o_camerainfo;
+
+            err_id = CommandManager::getInstance().getDeviceInfo(ndev_id, &o_camerainfo);
 
-            if (pAddon_ && pAddon_->hasImplementation())
+            if (DEVICE_OK != err_id)
             {
-                supported = pAddon_->isSupportedCamera(o_camerainfo.str_productid,
-                                                       o_camerainfo.str_vendorid);
+                PLOGD("err_id != DEVICE_OK\n");
+                obj_getinfo.setMethodReply(CONST_PARAM_VALUE_FALSE, (int)err_id,
+                                           getErrorString(err_id));
             }
             else
             {
-                supported = WhitelistChecker::isSupportedCamera(o_camerainfo.str_productid,
-                                                                o_camerainfo.str_vendorid);
+                PLOGD("err_id == DEVICE_OK\n");
+                obj_getinfo.setMethodReply(CONST_PARAM_VALUE_TRUE, (int)err_id,
+                                           getErrorString(err_id));
+                obj_getinfo.setCameraInfo(o_camerainfo);
+
+                if (pAddon_ && pAddon_->hasImplementation())
+                {
+                    supported = pAddon_->isSupportedCamera(o_camerainfo.str_productid,
+                                                           o_camerainfo.str_vendorid);
+                }
+                else
+                {
+                    supported = WhitelistChecker::isSupportedCamera(o_camerainfo.str_productid,
+                                                                    o_camerainfo.str_vendorid);
+                }
             }
         }
-    }
-
-    // create json string now for reply
-    std::string output_reply = obj_getinfo.createInfoObjectJsonString(supported);
-    PLOGI("output_reply %s\n", output_reply.c_str());
 
-    LS::Message request(&message);
-    request.respond(output_reply.c_str());
+        // create json string now for reply
+        return obj_getinfo.createInfoObjectJsonString(supported);
+    };
+    // the info comes from the device DB or the device info worker, never from the HAL of the
+    // camera, so it does not wait for the commands of the camera
+    dispatchQuery(message, ndev_id,
+                  [job](std::string &output_reply) mutable
+                  {
+                      output_reply = job();
+                      return true;
+                  });
 
     return true;
 }
@@ -717,8 +910,6 @@ bool CameraService::getProperties(LSMessage &message)
     {
         err_id = DEVICE_ERROR_WRONG_PARAM;
         PLOGI("err_id(%d)\n", err_id);
-        obj_getproperties.setMethodReply(CONST_PARAM_VALUE_FALSE, (int)err_id,
-                                         getErrorString(err_id));
     }
     else
     {
@@ -736,23 +927,6 @@ bool CameraService::getProperties(LSMessage &message)
         if (n_invalid_id != ndevhandle)
         {
             err_id = validateClient(&message, ndevhandle);
-
-            if (err_id == DEVICE_OK)
-            {
-                // get properties here
-                CAMERA_PROPERTIES_T dev_property;
-                err_id = CommandManager::getInstance().getProperty(ndevhandle, &dev_property);
-
-                if (DEVICE_OK != err_id)
-                {
-                    PLOGD("err_id != DEVICE_OK\n");
-                }
-                else
-                {
-                    PLOGD("err_id == DEVICE_OK\n");
-                    obj_getproperties.setCameraProperties(dev_property);
-                }
-            }
         }
         else
         {
@@ -761,13 +935,43 @@ bool CameraService::getProperties(LSMessage &message)
         }
     }
 
-    obj_getproperties.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
-    // create json string now for reply
-    std::string output_reply = obj_getproperties.createGetPropertiesObjectJsonString();
-    PLOGI("output_reply %s\n", output_reply.c_str());
+    auto reply = [obj_getproperties](DEVICE_RETURN_CODE_T err_id,
+                                     const CAMERA_PROPERTIES_T &dev_property) mutable
+    {
+        if (DEVICE_OK != err_id)
+        {
+            PLOGD("err_id != DEVICE_OK\n");
+        }
+        else
+        {
+            PLOGD("err_id == DEVICE_OK\n");
+            obj_getproperties.setCameraProperties(dev_property);
+        }
 
-    LS::Message request(&message);
-    request.respond(output_reply.c_str());
+        obj_getproperties.setMethodReply(err_id == DEVICE_OK, (int)err_id,
+                                         getErrorString(err_id));
+        // create json string now for reply
+        return obj_getproperties.createGetPropertiesObjectJsonString();
+    };
+    // the properties read last, kept up to date by setProperties and the events of the device
+    auto query = [reply, ndevhandle, err_id](std::string &output_reply) mutable
+    {
+        CAMERA_PROPERTIES_T dev_property;
+        if (err_id == DEVICE_OK &&
+            !CommandManager::getInstance().getCachedProperty(ndevhandle, &dev_property))
+            return false;
+        output_reply = reply(err_id, dev_property);
+        return true;
+    };
+    auto job = [reply, ndevhandle, err_id]() mutable
+    {
+        // get properties here
+        CAMERA_PROPERTIES_T dev_property;
+        if (err_id == DEVICE_OK)
+            err_id = CommandManager::getInstance().getProperty(ndevhandle, &dev_property);
+        return reply(err_id, dev_property);
+    };
+    dispatchQuery(message, ncamId, query, job);
 
     return true;
 }
@@ -785,6 +989,8 @@ bool CameraService::setProperties(LSMessage &message)
 
     err_id = validateClient(&message, ndevhandle);
 
+    std::string event_key;
+    bool bsubscribed = false;
     if (err_id == DEVICE_OK)
     {
         // check params object is empty or not
@@ -794,19 +1000,27 @@ bool CameraService::setProperties(LSMessage &message)
             err_id = DEVICE_ERROR_WRONG_PARAM;
         }
         else
+        {
+            event_key   = event_obj.getEventKeyWithId(ndevhandle, CONST_EVENT_KEY_PROPERTIES);
+            bsubscribed = event_obj.getSubscribeCount(this->get(), event_key) > 0;
+        }
+    }
+
+    auto job = [this, objsetproperties, ndevhandle, err_id, event_key, bsubscribed]() mutable
+    {
+        if (err_id == DEVICE_OK)
         {
             // get old properties before setting new
             CAMERA_PROPERTIES_T old_property;
-            std::string event_key =
-                event_obj.getEventKeyWithId(ndevhandle, CONST_EVENT_KEY_PROPERTIES);
-            if (event_obj.getSubscribeCount(this->get(), event_key) > 0)
+            if (bsubscribed)
             {
                 CommandManager::getInstance().getProperty(ndevhandle, &old_property);
             }
             // set properties here
             CAMERA_PROPERTIES_T oParams = objsetproperties.rGetCameraProperties();
             PLOGI("ndevhandle %d\n", ndevhandle);
-            err_id = CommandManager::getInstance().setProperty(ndevhandle, &oParams);
+            CAMERA_PROPERTIES_T failed;
+            err_id = CommandManager::getInstance().setProperty(ndevhandle, &oParams, &failed);
             if (DEVICE_OK != err_id)
             {
                 PLOGD("err_id != DEVICE_OK\n");
@@ -814,21 +1028,22 @@ bool CameraService::setProperties(LSMessage &message)
             else
             {
                 PLOGD("err_id == DEVICE_OK\n");
+                objsetproperties.setFailedProperties(failed);
                 // check if new properties are different from saved properties
-                auto *p_olddata = static_cast<void *>(&old_property);
-                createEventMessage(EventType::EVENT_TYPE_PROPERTIES, p_olddata, ndevhandle,
-                                   std::move(event_key));
+                if (bsubscribed)
+                {
+                    auto *p_olddata = static_cast<void *>(&old_property);
+                    createEventMessage(EventType::EVENT_TYPE_PROPERTIES, p_olddata, ndevhandle,
+                                       std::move(event_key));
+                }
             }
         }
-    }
-
-    objsetproperties.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
-    // create json string now for reply
-    std::string output_reply = objsetproperties.createSetPropertiesObjectJsonString();
-    PLOGI("output_reply %s\n", output_reply.c_str());
 
-    LS::Message request(&message);
-    request.respond(output_reply.c_str());
+        objsetproperties.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
+        // create json string now for reply
+        return objsetproperties.createSetPropertiesObjectJsonString();
+    };
+    dispatchRequest(message, CommandManager::getInstance().getCameraId(ndevhandle), job);
 
     return true;
 }
@@ -846,42 +1061,50 @@ bool CameraService::setFormat(LSMessage &message)
 
     err_id = validateClient(&message, ndevhandle);
 
+    std::string event_key;
+    bool bsubscribed = false;
     if (err_id == DEVICE_OK)
     {
-        // get saved format of the device
-        CAMERA_FORMAT savedformat;
-        std::string event_key = event_obj.getEventKeyWithId(ndevhandle, CONST_EVENT_KEY_FORMAT);
+        event_key   = event_obj.getEventKeyWithId(ndevhandle, CONST_EVENT_KEY_FORMAT);
+        bsubscribed = event_obj.getSubscribeCount(this->get(), event_key) > 0;
+    }
 
-        if (event_obj.getSubscribeCount(this->get(), event_key) > 0)
-        {
-            CommandManager::getInstance().getFormat(ndevhandle, &savedformat);
-        }
-        // setformat here
-        PLOGI("ndevhandle %d\n", ndevhandle);
-        CAMERA_FORMAT sformat = objsetformat.rGetCameraFormat();
-        err_id                = CommandManager::getInstance().setFormat(ndevhandle, sformat);
-        if (DEVICE_OK != err_id)
-        {
-            PLOGD("err_id != DEVICE_OK\n");
-        }
-        else
+    auto job = [this, objsetformat, ndevhandle, err_id, event_key, bsubscribed]() mutable
+    {
+        if (err_id == DEVICE_OK)
         {
-            PLOGD("err_id == DEVICE_OK\n");
-            // check if new format settings are different from saved format settings
             // get saved format of the device
-            auto *p_olddata = static_cast<void *>(&savedformat);
-            createEventMessage(EventType::EVENT_TYPE_FORMAT, p_olddata, ndevhandle,
-                               std::move(event_key));
+            CAMERA_FORMAT savedformat;
+            if (bsubscribed)
+            {
+                CommandManager::getInstance().getFormat(ndevhandle, &savedformat);
+            }
+            // setformat here
+            PLOGI("ndevhandle %d\n", ndevhandle);
+            CAMERA_FORMAT sformat = objsetformat.rGetCameraFormat();
+            err_id                = CommandManager::getInstance().setFormat(ndevhandle, sformat);
+            if (DEVICE_OK != err_id)
+            {
+                PLOGD("err_id != DEVICE_OK\n");
+            }
+            else
+            {
+                PLOGD("err_id == DEVICE_OK\n");
+                // check if new format settings are different from saved format settings
+                if (bsubscribed)
+                {
+                    auto *p_olddata = static_cast<void *>(&savedformat);
+                    createEventMessage(EventType::EVENT_TYPE_FORMAT, p_olddata, ndevhandle,
+                                       std::move(event_key));
+                }
+            }
         }
-    }
-
-    objsetformat.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
-    // create json string now for reply
-    std::string output_reply = objsetformat.createSetFormatObjectJsonString();
-    PLOGI("output_reply %s\n", output_reply.c_str());
 
-    LS::Message request(&message);
-    request.respond(output_reply.c_str());
+        objsetformat.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
+        // create json string now for reply
+        return objsetformat.createSetFormatObjectJsonString();
+    };
+    dispatchRequest(message, CommandManager::getInstance().getCameraId(ndevhandle), job);
 
     return true;
 }
@@ -924,10 +1147,8 @@ bool CameraService::getFd(LSMessage &message)
     auto *payload = LSMessageGetPayload(&message);
     PLOGI("payload %s", payload);
 
-    LS::Message request(&message);
     DEVICE_RETURN_CODE_T err_id = DEVICE_OK;
 
-    int shmfd = -1;
     GetFdMethod obj_getfd;
     obj_getfd.getObject(payload, getFdSchema);
 
@@ -937,32 +1158,51 @@ bool CameraService::getFd(LSMessage &message)
     if (ndevhandle == n_invalid_id)
         err_id = DEVICE_ERROR_JSON_PARSING;
 
-    if (err_id == DEVICE_OK)
-    {
-        std::string type = obj_getfd.getType();
-        PLOGI("ndevhandle %d type %s", ndevhandle, type.c_str());
-        err_id = CommandManager::getInstance().getFd(ndevhandle, type, &shmfd);
+    // the reply carries the fd, it is sent here rather than by dispatchRequest
+    LSMessage *msg = &message;
+    LSMessageRef(msg);
 
+    auto job = [msg, obj_getfd, ndevhandle, err_id]() mutable
+    {
+        int shmfd = -1;
         if (err_id == DEVICE_OK)
         {
-            obj_getfd.setMethodReply(CONST_PARAM_VALUE_TRUE, (int)err_id, getErrorString(err_id));
+            std::string type = obj_getfd.getType();
+            int index        = obj_getfd.getIndex();
+            PLOGI("ndevhandle %d type %s index %d", ndevhandle, type.c_str(), index);
+            err_id = CommandManager::getInstance().getFd(ndevhandle, type, index, &shmfd);
+        }
+        obj_getfd.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
 
-            // create json string now for reply
-            std::string output_reply = obj_getfd.createObjectJsonString();
-            PLOGI("output_reply %s\n", output_reply.c_str());
+        // create json string now for reply
+        std::string output_reply = obj_getfd.createObjectJsonString();
+        PLOGI("output_reply %s\n", output_reply.c_str());
 
-            LS::Payload response_payload(output_reply.c_str());
-            response_payload.attachFd(shmfd); // attach a fd here
-            request.respond(std::move(response_payload));
-            return true;
-        }
-    }
-    obj_getfd.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
-    // create json string now for reply
-    std::string output_reply = obj_getfd.createObjectJsonString();
-    PLOGI("output_reply %s\n", output_reply.c_str());
+        bool battach = (err_id == DEVICE_OK);
+        RequestDispatcher::complete(
+            [msg, output_reply, shmfd, battach]()
+            {
+                LS::Message request(msg);
+                if (battach)
+                {
+                    LS::Payload response_payload(output_reply.c_str());
+                    response_payload.attachFd(shmfd); // attach a fd here
+                    request.respond(std::move(response_payload));
+                }
+                else
+                {
+                    request.respond(output_reply.c_str());
+                }
+                LSMessageUnref(msg);
+            });
+    };
+
+    int deviceid = CommandManager::getInstance().getCameraId(ndevhandle);
+    if (n_invalid_id == deviceid)
+        job();
+    else
+        RequestDispatcher::getInstance().dispatch(deviceid, job);
 
-    request.respond(output_reply.c_str());
     return true;
 }
 
@@ -1063,8 +1303,6 @@ bool CameraService::getSolutions(LSMessage &message)
     PLOGI(" E \n");
     auto *payload               = LSMessageGetPayload(&message);
     DEVICE_RETURN_CODE_T err_id = DEVICE_OK;
-    std::vector<std::string> supportedSolutionList;
-    std::vector<std::string> enabledSolutionList;
 
     GetSolutionsMethod obj_getsolutions;
     obj_getsolutions.getObject(payload, getSolutionsSchema);
@@ -1092,48 +1330,53 @@ bool CameraService::getSolutions(LSMessage &message)
     if (err_id == DEVICE_OK && ndevhandle != n_invalid_id)
         err_id = validateClient(&message, ndevhandle);
 
-    if (err_id != DEVICE_OK)
+    if (err_id == DEVICE_OK && n_invalid_id == ndevhandle)
     {
-        PLOGI("err_id(%d)\n", err_id);
-        obj_getsolutions.setMethodReply(CONST_PARAM_VALUE_FALSE, (int)err_id,
-                                        getErrorString(err_id));
+        ndevhandle = CommandManager::getInstance().getCameraHandle(ncamId);
+        PLOGI("devhandel by camera(%d) is (%d)\n", ncamId, ndevhandle);
     }
-    else
+
+    auto job = [obj_getsolutions, ndevhandle, err_id]() mutable
     {
-        if (n_invalid_id == ndevhandle)
-        {
-            ndevhandle = CommandManager::getInstance().getCameraHandle(ncamId);
-            PLOGI("devhandel by camera(%d) is (%d)\n", ncamId, ndevhandle);
-        }
-        PLOGI("DEVICE_OK\n");
-        obj_getsolutions.setMethodReply(CONST_PARAM_VALUE_TRUE, (int)err_id,
-                                        getErrorString(err_id));
+        std::vector<std::string> supportedSolutionList;
+        std::vector<std::string> enabledSolutionList;
+        std::vector<solution_status_t> statusList;
 
-        err_id = CommandManager::getInstance().getSupportedCameraSolutionInfo(
-            ndevhandle, supportedSolutionList);
-        if (DEVICE_OK != err_id)
+        if (err_id != DEVICE_OK)
         {
-            PLOGI("error happens on getting supported solution list by err_id(%d)\n", err_id);
+            PLOGI("err_id(%d)\n", err_id);
             obj_getsolutions.setMethodReply(CONST_PARAM_VALUE_FALSE, (int)err_id,
                                             getErrorString(err_id));
         }
-
-        err_id = CommandManager::getInstance().getEnabledCameraSolutionInfo(ndevhandle,
-                                                                            enabledSolutionList);
-        if (DEVICE_OK != err_id)
+        else
         {
-            PLOGI("error happens on getting enabled solution list by err_id(%d)\n", err_id);
-            obj_getsolutions.setMethodReply(CONST_PARAM_VALUE_FALSE, (int)err_id,
+            PLOGI("DEVICE_OK\n");
+            obj_getsolutions.setMethodReply(CONST_PARAM_VALUE_TRUE, (int)err_id,
                                             getErrorString(err_id));
-        }
-    }
 
-    std::string output_reply =
-        obj_getsolutions.createObjectJsonString(supportedSolutionList, enabledSolutionList);
+            err_id = CommandManager::getInstance().getSupportedCameraSolutionInfo(
+                ndevhandle, supportedSolutionList);
+            if (DEVICE_OK != err_id)
+            {
+                PLOGI("error happens on getting supported solution list by err_id(%d)\n", err_id);
+                obj_getsolutions.setMethodReply(CONST_PARAM_VALUE_FALSE, (int)err_id,
+                                                getErrorString(err_id));
+            }
+
+            err_id = CommandManager::getInstance().getEnabledCameraSolutionInfo(
+                ndevhandle, enabledSolutionList, &statusList);
+            if (DEVICE_OK != err_id)
+            {
+                PLOGI("error happens on getting enabled solution list by err_id(%d)\n", err_id);
+                obj_getsolutions.setMethodReply(CONST_PARAM_VALUE_FALSE, (int)err_id,
+                                                getErrorString(err_id));
+            }
+        }
 
-    LS::Message request(&message);
-    request.respond(output_reply.c_str());
-    PLOGI(" output_reply(%s) \n", output_reply.c_str());
+        return obj_getsolutions.createObjectJsonString(supportedSolutionList,
+                                                       enabledSolutionList, statusList);
+    };
+    dispatchRequest(message, CommandManager::getInstance().getCameraId(ndevhandle), job);
 
     PLOGI(" X \n");
     return true;
@@ -1171,17 +1414,23 @@ bool CameraService::setSolutions(LSMessage &message)
     if (err_id == DEVICE_OK && ndevhandle != n_invalid_id)
         err_id = validateClient(&message, ndevhandle);
 
-    if (err_id != DEVICE_OK)
+    if (err_id == DEVICE_OK && n_invalid_id == ndevhandle)
     {
-        PLOGI("err_id(%d)\n", err_id);
-
-        obj_setSolutions.setMethodReply(CONST_PARAM_VALUE_FALSE, (int)err_id,
-                                        getErrorString(err_id));
+        ndevhandle = CommandManager::getInstance().getCameraHandle(ncamId);
+        PLOGI("devhandel by camera(%d) is (%d)\n", ncamId, ndevhandle);
     }
-    else
+
+    auto job = [obj_setSolutions, ndevhandle, err_id]() mutable
     {
+        if (err_id != DEVICE_OK)
+        {
+            PLOGI("err_id(%d)\n", err_id);
+
+            obj_setSolutions.setMethodReply(CONST_PARAM_VALUE_FALSE, (int)err_id,
+                                            getErrorString(err_id));
+        }
         // check solutions is empty or not
-        if (obj_setSolutions.isEmpty())
+        else if (obj_setSolutions.isEmpty())
         {
             PLOGI("solutions is empty\n");
             err_id = DEVICE_ERROR_WRONG_PARAM;
@@ -1190,12 +1439,6 @@ bool CameraService::setSolutions(LSMessage &message)
         }
         else
         {
-            if (n_invalid_id == ndevhandle)
-            {
-                ndevhandle = CommandManager::getInstance().getCameraHandle(ncamId);
-                PLOGI("devhandel by camera(%d) is (%d)\n", ncamId, ndevhandle);
-            }
-
             // check if the requested solution parameter is valid or not. If not valid at least one
             // of them, this method didn't do anything
             std::vector<std::string> supportedSolutionList;
@@ -1262,7 +1505,8 @@ bool CameraService::setSolutions(LSMessage &message)
             if (DEVICE_OK == err_id)
             {
                 err_id = CommandManager::getInstance().enableCameraSolution(
-                    ndevhandle, obj_setSolutions.getEnableSolutionList());
+                    ndevhandle, obj_setSolutions.getEnableSolutionList(),
+                    obj_setSolutions.getSolutionSchedules());
                 err_id = CommandManager::getInstance().disableCameraSolution(
                     ndevhandle, obj_setSolutions.getDisableSolutionList());
             }
@@ -1280,11 +1524,10 @@ bool CameraService::setSolutions(LSMessage &message)
                                                 getErrorString(err_id));
             }
         }
-    }
 
-    std::string output_reply = obj_setSolutions.createObjectJsonString();
-    LS::Message request(&message);
-    request.respond(output_reply.c_str());
+        return obj_setSolutions.createObjectJsonString();
+    };
+    dispatchRequest(message, CommandManager::getInstance().getCameraId(ndevhandle), job);
 
     return true;
 }
@@ -1309,7 +1552,6 @@ bool CameraService::getFormat(LSMessage &message)
     {
         err_id = DEVICE_ERROR_WRONG_PARAM;
         PLOGI("err_id(%d)\n", err_id);
-        obj_getFormat.setMethodReply(CONST_PARAM_VALUE_FALSE, (int)err_id, getErrorString(err_id));
     }
     else
     {
@@ -1323,36 +1565,44 @@ bool CameraService::getFormat(LSMessage &message)
 
         ndevhandle = CommandManager::getInstance().getCameraHandle(ncamId);
         PLOGI("devhandel by camera(%d) is (%d)\n", ncamId, ndevhandle);
-        if (n_invalid_id != ndevhandle)
-        {
-            CAMERA_FORMAT output_format;
-            err_id = CommandManager::getInstance().getFormat(ndevhandle, &output_format);
+        if (n_invalid_id == ndevhandle)
+            err_id = DEVICE_ERROR_DEVICE_IS_NOT_OPENED;
+    }
 
-            if (DEVICE_OK != err_id)
-            {
-                PLOGI("DEVICE_NOT_OK err_id(%d)\n", err_id);
-                obj_getFormat.setMethodReply(CONST_PARAM_VALUE_FALSE, (int)err_id,
-                                             getErrorString(err_id));
-            }
-            else
-            {
-                PLOGI("DEVICE_OK\n");
-                obj_getFormat.setMethodReply(CONST_PARAM_VALUE_TRUE, (int)err_id,
-                                             getErrorString(err_id));
-                obj_getFormat.setCameraFormat(output_format);
-            }
+    auto reply = [obj_getFormat](DEVICE_RETURN_CODE_T err_id,
+                                 const CAMERA_FORMAT &output_format) mutable
+    {
+        if (DEVICE_OK != err_id)
+        {
+            PLOGI("DEVICE_NOT_OK err_id(%d)\n", err_id);
         }
         else
         {
-            err_id = DEVICE_ERROR_DEVICE_IS_NOT_OPENED;
-            obj_getFormat.setMethodReply(CONST_PARAM_VALUE_FALSE, (int)err_id,
-                                         getErrorString(err_id));
+            PLOGI("DEVICE_OK\n");
+            obj_getFormat.setCameraFormat(output_format);
         }
-    }
 
-    std::string output_reply = obj_getFormat.createObjectJsonString();
-    LS::Message request(&message);
-    request.respond(output_reply.c_str());
+        obj_getFormat.setMethodReply(err_id == DEVICE_OK, (int)err_id, getErrorString(err_id));
+        return obj_getFormat.createObjectJsonString();
+    };
+    // the format read or set last
+    auto query = [reply, ndevhandle, err_id](std::string &output_reply) mutable
+    {
+        CAMERA_FORMAT output_format{};
+        if (err_id == DEVICE_OK &&
+            !CommandManager::getInstance().getCachedFormat(ndevhandle, &output_format))
+            return false;
+        output_reply = reply(err_id, output_format);
+        return true;
+    };
+    auto job = [reply, ndevhandle, err_id]() mutable
+    {
+        CAMERA_FORMAT output_format{};
+        if (err_id == DEVICE_OK)
+            err_id = CommandManager::getInstance().getFormat(ndevhandle, &output_format);
+        return reply(err_id, output_format);
+    };
+    dispatchQuery(message, ncamId, query, job);
 
     return true;
 }
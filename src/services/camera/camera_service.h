@@ -25,6 +25,7 @@
 #include "event_notification.h"
 #include "json_parser.h"
 #include "luna-service2/lunaservice.hpp"
+#include <functional>
 #include <glib.h>
 
 class CameraService : public LS::Handle
@@ -43,6 +44,15 @@ private:
 
     bool addClientWatcher(LSHandle *handle, LSMessage *message, int ndevice_handle);
     DEVICE_RETURN_CODE_T validateClient(LSMessage *message, int ndevice_handle);
+    // Runs job on the request worker of the camera deviceid and responds with the string it
+    // returns from the main loop. An invalid deviceid runs it here.
+    void dispatchRequest(LSMessage &message, int deviceid, std::function<std::string()> job);
+    // Runs query on the query worker of the camera deviceid, for the read-only requests, and
+    // responds with the string it stores. If query returns false, it could not answer without
+    // the HAL, and job runs on the request worker as with dispatchRequest.
+    void dispatchQuery(LSMessage &message, int deviceid,
+                       std::function<bool(std::string &)> query,
+                       std::function<std::string()> job = nullptr);
 
 public:
     CameraService();
@@ -53,6 +63,7 @@ public:
     CameraService &operator=(CameraService &&)      = delete;
 
     bool open(LSMessage &);
+    bool openStream(LSMessage &);
     bool close(LSMessage &);
     bool getInfo(LSMessage &);
     bool getCameraList(LSMessage &);
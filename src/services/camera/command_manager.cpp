@@ -22,12 +22,14 @@
 #include "addon.h"
 #include "camera_constants.h"
 #include "device_manager.h"
+#include "request_dispatcher.h"
 #ifdef DAC_ENABLED
 #include "camera_dac_policy.h"
 #endif
 
 std::shared_ptr<VirtualDeviceManager> CommandManager::getVirtualDeviceMgrObj(int devhandle)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     std::multimap<std::string, Device>::iterator it;
     for (it = virtualdevmgrobj_map_.begin(); it != virtualdevmgrobj_map_.end(); ++it)
     {
@@ -40,6 +42,7 @@ std::shared_ptr<VirtualDeviceManager> CommandManager::getVirtualDeviceMgrObj(int
 
 void CommandManager::removeVirtualDevMgrObj(int devhandle)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     std::multimap<std::string, Device>::iterator it;
     for (it = virtualdevmgrobj_map_.begin(); it != virtualdevmgrobj_map_.end(); ++it)
     {
@@ -53,19 +56,13 @@ void CommandManager::removeVirtualDevMgrObj(int devhandle)
     }
 }
 
-DEVICE_RETURN_CODE_T CommandManager::open(int deviceid, int *devicehandle, std::string appId,
-                                          std::string apppriority)
+Device CommandManager::findDevice(const std::string &devicenode)
 {
-    PLOGI("deviceid : %d \n", deviceid);
-
-    std::string devicenode;
-    DeviceManager::getInstance().getDeviceNode(deviceid, devicenode);
-    PLOGI("devicenode : %s \n", devicenode.c_str());
-
+    Device obj;
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     std::multimap<std::string, Device>::iterator it;
     it = virtualdevmgrobj_map_.find(devicenode);
 
-    Device obj;
     if (it == virtualdevmgrobj_map_.end())
     {
         obj.ptr = std::make_shared<VirtualDeviceManager>();
@@ -74,29 +71,49 @@ DEVICE_RETURN_CODE_T CommandManager::open(int deviceid, int *devicehandle, std::
         obj = it->second;
 
     PLOGI("ptr : %p \n", obj.ptr.get());
-
     if (nullptr != obj.ptr)
-    {
         obj.ptr->setAddon(pAddon_);
+    return obj;
+}
+
+void CommandManager::addDevice(const std::string &devicenode, Device obj, int deviceid,
+                               int devicehandle, std::string appId, std::string apppriority)
+{
+    PLOGI("devicehandle : %d \n", devicehandle);
+    obj.devicehandle = devicehandle;
+    obj.deviceid     = deviceid;
+    obj.clientName   = "";
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex_);
+        virtualdevmgrobj_map_.insert(std::make_pair(devicenode, obj));
+    }
+
+    if (pAddon_ && pAddon_->hasImplementation())
+    {
+        std::string deviceKey = DeviceManager::getInstance().getDeviceKey(deviceid);
+        bool res = pAddon_->notifyDeviceOpened(std::move(deviceKey), std::move(appId),
+                                               std::move(apppriority));
+        PLOGI("AddOn::notifyDeviceOpened = %d ", res);
+    }
+}
 
+DEVICE_RETURN_CODE_T CommandManager::open(int deviceid, int *devicehandle, std::string appId,
+                                          std::string apppriority)
+{
+    PLOGI("deviceid : %d \n", deviceid);
+
+    std::string devicenode;
+    DeviceManager::getInstance().getDeviceNode(deviceid, devicenode);
+    PLOGI("devicenode : %s \n", devicenode.c_str());
+
+    Device obj = findDevice(devicenode);
+    if (nullptr != obj.ptr)
+    {
         // open device and return devicehandle
         DEVICE_RETURN_CODE_T ret = obj.ptr->open(deviceid, devicehandle, appId, apppriority);
         if (DEVICE_OK == ret)
-        {
-            PLOGI("devicehandle : %d \n", *devicehandle);
-            obj.devicehandle = *devicehandle;
-            obj.deviceid     = deviceid;
-            obj.clientName   = "";
-            virtualdevmgrobj_map_.insert(std::make_pair(devicenode, obj));
-
-            if (pAddon_ && pAddon_->hasImplementation())
-            {
-                std::string deviceKey = DeviceManager::getInstance().getDeviceKey(deviceid);
-                bool res = pAddon_->notifyDeviceOpened(std::move(deviceKey), std::move(appId),
-                                                       std::move(apppriority));
-                PLOGI("AddOn::notifyDeviceOpened = %d ", res);
-            }
-        }
+            addDevice(devicenode, obj, deviceid, *devicehandle, std::move(appId),
+                      std::move(apppriority));
         else
         {
             PLOGE("open fail");
@@ -107,6 +124,36 @@ DEVICE_RETURN_CODE_T CommandManager::open(int deviceid, int *devicehandle, std::
         return DEVICE_ERROR_UNKNOWN;
 }
 
+DEVICE_RETURN_CODE_T CommandManager::openStream(int deviceid, int *devicehandle, std::string appId,
+                                                std::string apppriority, CAMERA_FORMAT sformat,
+                                                LSHandle *sh, const std::string &memtype,
+                                                int *shmfd, std::string &step)
+{
+    PLOGI("deviceid : %d \n", deviceid);
+
+    std::string devicenode;
+    DeviceManager::getInstance().getDeviceNode(deviceid, devicenode);
+    PLOGI("devicenode : %s \n", devicenode.c_str());
+
+    Device obj = findDevice(devicenode);
+    if (nullptr == obj.ptr)
+    {
+        step = "open";
+        return DEVICE_ERROR_UNKNOWN;
+    }
+
+    DEVICE_RETURN_CODE_T ret = obj.ptr->openStream(deviceid, devicehandle, appId, apppriority,
+                                                   sformat, sh, memtype, shmfd, step);
+    if (DEVICE_OK == ret)
+        addDevice(devicenode, obj, deviceid, *devicehandle, std::move(appId),
+                  std::move(apppriority));
+    else
+    {
+        PLOGE("openStream fail at %s", step.c_str());
+    }
+    return ret;
+}
+
 DEVICE_RETURN_CODE_T CommandManager::close(int devhandle)
 {
     PLOGI("devhandle : %d \n", devhandle);
@@ -171,7 +218,8 @@ DEVICE_RETURN_CODE_T CommandManager::getProperty(int devhandle, CAMERA_PROPERTIE
         return DEVICE_ERROR_UNKNOWN;
 }
 
-DEVICE_RETURN_CODE_T CommandManager::setProperty(int devhandle, CAMERA_PROPERTIES_T *oInfo)
+DEVICE_RETURN_CODE_T CommandManager::setProperty(int devhandle, CAMERA_PROPERTIES_T *oInfo,
+                                                 CAMERA_PROPERTIES_T *failed)
 {
     PLOGI("devhandle : %d\n", devhandle);
 
@@ -181,7 +229,7 @@ DEVICE_RETURN_CODE_T CommandManager::setProperty(int devhandle, CAMERA_PROPERTIE
     std::shared_ptr<VirtualDeviceManager> ptr = getVirtualDeviceMgrObj(devhandle);
     if (nullptr != ptr)
         // send request to set property of device
-        return ptr->setProperty(devhandle, oInfo);
+        return ptr->setProperty(devhandle, oInfo, failed);
     else
         return DEVICE_ERROR_UNKNOWN;
 }
@@ -201,9 +249,10 @@ DEVICE_RETURN_CODE_T CommandManager::setFormat(int devhandle, CAMERA_FORMAT ofor
         return DEVICE_ERROR_UNKNOWN;
 }
 
-DEVICE_RETURN_CODE_T CommandManager::startCamera(int devhandle, LSHandle *sh)
+DEVICE_RETURN_CODE_T CommandManager::startCamera(int devhandle, LSHandle *sh,
+                                                 const std::string &memtype)
 {
-    PLOGI("devhandle : %d\n", devhandle);
+    PLOGI("devhandle : %d, memtype : %s\n", devhandle, memtype.c_str());
 
     if (n_invalid_id == devhandle)
         return DEVICE_ERROR_WRONG_PARAM;
@@ -211,7 +260,7 @@ DEVICE_RETURN_CODE_T CommandManager::startCamera(int devhandle, LSHandle *sh)
     std::shared_ptr<VirtualDeviceManager> ptr = getVirtualDeviceMgrObj(devhandle);
     if (nullptr != ptr)
         // start preview
-        return ptr->startCamera(devhandle, sh);
+        return ptr->startCamera(devhandle, sh, memtype);
     else
         return DEVICE_ERROR_UNKNOWN;
 }
@@ -291,7 +340,8 @@ DEVICE_RETURN_CODE_T CommandManager::startCapture(int devhandle, CAMERA_FORMAT s
         return DEVICE_ERROR_UNKNOWN;
 }
 
-DEVICE_RETURN_CODE_T CommandManager::stopCapture(int devhandle, bool request)
+DEVICE_RETURN_CODE_T CommandManager::stopCapture(int devhandle, bool request,
+                                                 CAPTURE_STATS_T *pStats)
 {
     PLOGI("devhandle : %d\n", devhandle);
 
@@ -301,14 +351,15 @@ DEVICE_RETURN_CODE_T CommandManager::stopCapture(int devhandle, bool request)
     std::shared_ptr<VirtualDeviceManager> ptr = getVirtualDeviceMgrObj(devhandle);
     if (nullptr != ptr)
         // stop capture
-        return ptr->stopCapture(devhandle, request);
+        return ptr->stopCapture(devhandle, request, pStats);
     else
         return DEVICE_ERROR_UNKNOWN;
 }
 
 DEVICE_RETURN_CODE_T CommandManager::capture(int devhandle, int ncount,
                                              const std::string &imagepath,
-                                             std::vector<std::string> &capturedFiles, int userid)
+                                             std::vector<std::string> &capturedFiles, int userid,
+                                             CAPTURE_STATS_T *pStats)
 {
     PLOGI("devhandle : %d\n", devhandle);
 
@@ -333,7 +384,7 @@ DEVICE_RETURN_CODE_T CommandManager::capture(int devhandle, int ncount,
     if (nullptr != ptr)
     {
         // capture image
-        return ptr->capture(devhandle, ncount, capture_path, capturedFiles);
+        return ptr->capture(devhandle, ncount, capture_path, capturedFiles, pStats);
     }
     else
         return DEVICE_ERROR_UNKNOWN;
@@ -354,12 +405,25 @@ DEVICE_RETURN_CODE_T CommandManager::getFormat(int devhandle, CAMERA_FORMAT *ofo
         return DEVICE_ERROR_UNKNOWN;
 }
 
+bool CommandManager::getCachedFormat(int devhandle, CAMERA_FORMAT *oformat)
+{
+    std::shared_ptr<VirtualDeviceManager> ptr = getVirtualDeviceMgrObj(devhandle);
+    return (nullptr != ptr) && ptr->getCachedFormat(oformat);
+}
+
+bool CommandManager::getCachedProperty(int devhandle, CAMERA_PROPERTIES_T *devproperty)
+{
+    std::shared_ptr<VirtualDeviceManager> ptr = getVirtualDeviceMgrObj(devhandle);
+    return (nullptr != ptr) && ptr->getCachedProperty(devproperty);
+}
+
 int CommandManager::getCameraId(int devhandle)
 {
     PLOGI("devhandle : %d\n", devhandle);
     if (n_invalid_id == devhandle)
         return n_invalid_id;
 
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     std::multimap<std::string, Device>::iterator it;
     for (it = virtualdevmgrobj_map_.begin(); it != virtualdevmgrobj_map_.end(); ++it)
     {
@@ -374,6 +438,7 @@ int CommandManager::getCameraHandle(int devid)
 {
     PLOGI("devid : %d\n", devid);
 
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     std::multimap<std::string, Device>::iterator it;
     for (it = virtualdevmgrobj_map_.begin(); it != virtualdevmgrobj_map_.end(); ++it)
     {
@@ -384,14 +449,15 @@ int CommandManager::getCameraHandle(int devid)
     return n_invalid_id;
 }
 
-DEVICE_RETURN_CODE_T CommandManager::getFd(int devhandle, const std::string &type, int *shmfd)
+DEVICE_RETURN_CODE_T CommandManager::getFd(int devhandle, const std::string &type, int index,
+                                           int *shmfd)
 {
     PLOGI("devhandle : %d\n", devhandle);
 
     std::shared_ptr<VirtualDeviceManager> ptr = getVirtualDeviceMgrObj(devhandle);
     if (nullptr != ptr)
     {
-        return ptr->getFd(devhandle, type, shmfd);
+        return ptr->getFd(devhandle, type, index, shmfd);
     }
     return DEVICE_ERROR_HANDLE_NOT_EXIST;
 }
@@ -402,6 +468,7 @@ bool CommandManager::setClientDevice(int devhandle, std::string clientName)
     if (n_invalid_id == devhandle)
         return false;
 
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     std::multimap<std::string, Device>::iterator it;
     for (it = virtualdevmgrobj_map_.begin(); it != virtualdevmgrobj_map_.end(); ++it)
     {
@@ -418,6 +485,7 @@ bool CommandManager::setClientDevice(int devhandle, std::string clientName)
 
 DEVICE_RETURN_CODE_T CommandManager::checkDeviceClient(int devhandle, std::string clientID)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     std::multimap<std::string, Device>::iterator it;
     for (it = virtualdevmgrobj_map_.begin(); it != virtualdevmgrobj_map_.end(); ++it)
     {
@@ -440,16 +508,19 @@ void CommandManager::closeClientDevice(std::string clientName)
 {
     PLOGI("clientName : %s", clientName.c_str());
 
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     auto it = virtualdevmgrobj_map_.begin();
     while (it != virtualdevmgrobj_map_.end())
     {
-        Device &device = it->second;
+        Device device = it->second;
 
         if (clientName == device.clientName && nullptr != device.ptr)
         {
             PLOGI("stop & close devicehandle : %d", device.devicehandle);
 
-            stopAndCloseDevice(device);
+            // after the requests of the camera queued before
+            RequestDispatcher::getInstance().dispatch(
+                device.deviceid, [this, device]() mutable { stopAndCloseDevice(device); });
 
             it = virtualdevmgrobj_map_.erase(it);
         }
@@ -464,6 +535,8 @@ void CommandManager::handleCrash()
 {
     PLOGI("start freeing resources for abnormal service termination \n");
 
+    // called from the signal handler, the lock is taken if it can be
+    std::unique_lock<std::recursive_mutex> lock(mutex_, std::try_to_lock);
     auto it = virtualdevmgrobj_map_.begin();
     while (it != virtualdevmgrobj_map_.end())
     {
@@ -481,20 +554,28 @@ void CommandManager::release(int deviceid)
 {
     PLOGI("deviceid : %d", deviceid);
 
-    auto it = virtualdevmgrobj_map_.begin();
-    while (it != virtualdevmgrobj_map_.end())
+    std::vector<Device> devices;
     {
-        Device &device = it->second;
-        if (deviceid == device.deviceid)
+        std::lock_guard<std::recursive_mutex> lock(mutex_);
+        auto it = virtualdevmgrobj_map_.begin();
+        while (it != virtualdevmgrobj_map_.end())
         {
-            stopAndCloseDevice(device);
-            it = virtualdevmgrobj_map_.erase(it);
-        }
-        else
-        {
-            it++;
+            if (deviceid == it->second.deviceid)
+            {
+                devices.push_back(it->second);
+                it = virtualdevmgrobj_map_.erase(it);
+            }
+            else
+            {
+                it++;
+            }
         }
     }
+
+    for (auto &device : devices)
+    {
+        stopAndCloseDevice(device);
+    }
 }
 
 DEVICE_RETURN_CODE_T
@@ -515,14 +596,15 @@ CommandManager::getSupportedCameraSolutionInfo(int devhandle,
 }
 
 DEVICE_RETURN_CODE_T
-CommandManager::getEnabledCameraSolutionInfo(int devhandle, std::vector<std::string> &solutionsInfo)
+CommandManager::getEnabledCameraSolutionInfo(int devhandle, std::vector<std::string> &solutionsInfo,
+                                             std::vector<solution_status_t> *pStatus)
 {
     PLOGI("getSupportedCameraSolutionInfo : devhandle : %d\n", devhandle);
 
     std::shared_ptr<VirtualDeviceManager> ptr = getVirtualDeviceMgrObj(devhandle);
     if (nullptr != ptr)
     {
-        return ptr->getEnabledCameraSolutionInfo(devhandle, solutionsInfo);
+        return ptr->getEnabledCameraSolutionInfo(devhandle, solutionsInfo, pStatus);
     }
     else
     {
@@ -530,15 +612,16 @@ CommandManager::getEnabledCameraSolutionInfo(int devhandle, std::vector<std::str
     }
 }
 
-DEVICE_RETURN_CODE_T CommandManager::enableCameraSolution(int devhandle,
-                                                          const std::vector<std::string> &solutions)
+DEVICE_RETURN_CODE_T
+CommandManager::enableCameraSolution(int devhandle, const std::vector<std::string> &solutions,
+                                     const std::map<std::string, solution_schedule_t> &schedules)
 {
     PLOGI("enableCameraSolutionInfo : devhandle : %d\n", devhandle);
 
     std::shared_ptr<VirtualDeviceManager> ptr = getVirtualDeviceMgrObj(devhandle);
     if (nullptr != ptr)
     {
-        return ptr->enableCameraSolution(devhandle, solutions);
+        return ptr->enableCameraSolution(devhandle, solutions, schedules);
     }
     else
     {
@@ -580,14 +663,15 @@ void CommandManager::stopAndCloseDevice(Device &device)
     // send request to stop all and close the device
     device.ptr->stopCapture(device.devicehandle);
 
-    CameraDeviceState state = getDeviceState(device.devicehandle);
+    // the device may be out of the map already, ptr is used directly
+    CameraDeviceState state = device.ptr->getDeviceState(device.devicehandle);
     if (state == CameraDeviceState::CAM_DEVICE_STATE_STREAMING)
     {
-        stopCamera(device.devicehandle, true);
+        device.ptr->stopCamera(device.devicehandle, true);
     }
     else if (state == CameraDeviceState::CAM_DEVICE_STATE_PREVIEW)
     {
-        stopPreview(device.devicehandle, true);
+        device.ptr->stopPreview(device.devicehandle, true);
     }
 
     device.ptr->close(device.devicehandle);
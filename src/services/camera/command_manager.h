@@ -24,6 +24,7 @@
 #include "camera_types.h"
 #include "virtual_device_manager.h"
 #include <map>
+#include <mutex>
 #include <string>
 
 class Device
@@ -39,10 +40,14 @@ class CommandManager
 {
 private:
     std::multimap<std::string, Device> virtualdevmgrobj_map_;
+    // guards virtualdevmgrobj_map_, the requests of the cameras run on their own workers
+    std::recursive_mutex mutex_;
 
     std::shared_ptr<VirtualDeviceManager> getVirtualDeviceMgrObj(int);
     void removeVirtualDevMgrObj(int);
     void stopAndCloseDevice(Device &);
+    Device findDevice(const std::string &);
+    void addDevice(const std::string &, Device, int, int, std::string, std::string);
     std::shared_ptr<AddOn> pAddon_;
 
 public:
@@ -53,25 +58,40 @@ public:
     }
 
     DEVICE_RETURN_CODE_T open(int, int *, std::string = "", std::string = "");
+    // open, setFormat (if the width is set), startCamera and getFd of the buffer for shmem in one.
+    // On a failure the done steps are undone and step is the name of the failed one.
+    DEVICE_RETURN_CODE_T openStream(int, int *, std::string, std::string, CAMERA_FORMAT,
+                                    LSHandle *, const std::string &, int *, std::string &);
     DEVICE_RETURN_CODE_T close(int);
     static DEVICE_RETURN_CODE_T getDeviceInfo(int, camera_device_info_t *);
     static DEVICE_RETURN_CODE_T getDeviceList(std::vector<int> &);
     DEVICE_RETURN_CODE_T getProperty(int, CAMERA_PROPERTIES_T *);
-    DEVICE_RETURN_CODE_T setProperty(int, CAMERA_PROPERTIES_T *);
+    DEVICE_RETURN_CODE_T setProperty(int, CAMERA_PROPERTIES_T *,
+                                     CAMERA_PROPERTIES_T *failed = nullptr);
     DEVICE_RETURN_CODE_T setFormat(int, CAMERA_FORMAT);
-    DEVICE_RETURN_CODE_T startCamera(int, LSHandle *);
+    DEVICE_RETURN_CODE_T startCamera(int, LSHandle *, const std::string &memtype = cstr_shmem);
     DEVICE_RETURN_CODE_T stopCamera(int, bool = false);
     DEVICE_RETURN_CODE_T startPreview(int, std::string, LSHandle *);
     DEVICE_RETURN_CODE_T stopPreview(int, bool = false);
     DEVICE_RETURN_CODE_T startCapture(int, CAMERA_FORMAT, const std::string &, const std::string &,
                                       int, int);
-    DEVICE_RETURN_CODE_T stopCapture(int, bool request = true);
-    DEVICE_RETURN_CODE_T capture(int, int, const std::string &, std::vector<std::string> &, int);
+    // The statistics of the capture are stored to pStats, if given.
+    DEVICE_RETURN_CODE_T stopCapture(int, bool request = true, CAPTURE_STATS_T *pStats = nullptr);
+    DEVICE_RETURN_CODE_T capture(int, int, const std::string &, std::vector<std::string> &, int,
+                                 CAPTURE_STATS_T *pStats = nullptr);
     DEVICE_RETURN_CODE_T getFormat(int, CAMERA_FORMAT *);
-    DEVICE_RETURN_CODE_T getFd(int, const std::string &, int *);
+    // getFormat and getProperty without a command to the HAL, for the query lane of the
+    // requests. false if the camera has nothing cached, getFormat or getProperty go to the HAL.
+    bool getCachedFormat(int, CAMERA_FORMAT *);
+    bool getCachedProperty(int, CAMERA_PROPERTIES_T *);
+    DEVICE_RETURN_CODE_T getFd(int, const std::string &, int, int *);
     DEVICE_RETURN_CODE_T getSupportedCameraSolutionInfo(int, std::vector<std::string> &);
-    DEVICE_RETURN_CODE_T getEnabledCameraSolutionInfo(int, std::vector<std::string> &);
-    DEVICE_RETURN_CODE_T enableCameraSolution(int, const std::vector<std::string> &);
+    DEVICE_RETURN_CODE_T
+    getEnabledCameraSolutionInfo(int, std::vector<std::string> &,
+                                 std::vector<solution_status_t> *pStatus = nullptr);
+    DEVICE_RETURN_CODE_T
+    enableCameraSolution(int, const std::vector<std::string> &,
+                         const std::map<std::string, solution_schedule_t> &schedules = {});
     DEVICE_RETURN_CODE_T disableCameraSolution(int, const std::vector<std::string> &);
 
     int getCameraId(int);
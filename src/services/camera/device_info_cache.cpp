@@ -0,0 +1,162 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/*-----------------------------------------------------------------------------
+ (File Inclusions)
+ ----------------------------------------------------------------------------*/
+#define LOG_TAG "DeviceInfoCache"
+#include "device_info_cache.h"
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+using json = nlohmann::json;
+
+std::string DeviceInfoCache::makeKey(const DEVICE_LIST_T &device)
+{
+    // Without the firmware version a camera can not be told from an updated one.
+    if (device.strVendorID.empty() || device.strProductID.empty() || device.strVersion.empty())
+        return "";
+
+    // The video nodes of a camera with several of them share the ids but not the capabilities.
+    // The device key ends with the node then, which is not stable across plugs.
+    const std::string &node = device.strDeviceNode;
+    const std::string &key  = device.strDeviceKey;
+    if (!node.empty() && key.size() >= node.size() &&
+        key.compare(key.size() - node.size(), node.size(), node) == 0)
+        return "";
+
+    return device.strDeviceType + "/" + device.strVendorID + "/" + device.strProductID + "/" +
+           device.strVersion;
+}
+
+bool DeviceInfoCache::load(const DEVICE_LIST_T &device, camera_device_info_t *p_info)
+{
+    std::string key = makeKey(device);
+    if (key.empty())
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    readFile();
+
+    auto it = devices_.find(key);
+    if (it == devices_.end())
+    {
+        PLOGI("%s is not cached", key.c_str());
+        return false;
+    }
+
+    try
+    {
+        p_info->stResolution.clear();
+        for (const auto &res : (*it)["resolutions"])
+        {
+            p_info->stResolution.emplace_back(res["res"].get<std::vector<std::string>>(),
+                                              res["format"].get<camera_format_t>());
+        }
+        p_info->n_devicetype = (*it)["deviceType"].get<device_t>();
+        p_info->b_builtin    = (*it)["builtin"].get<int>();
+    }
+    catch (const json::exception &e)
+    {
+        PLOGE("invalid cache entry %s : %s", key.c_str(), e.what());
+        devices_.erase(it);
+        p_info->stResolution.clear();
+        return false;
+    }
+
+    PLOGI("%s loaded from cache", key.c_str());
+    return true;
+}
+
+void DeviceInfoCache::save(const DEVICE_LIST_T &device, const camera_device_info_t &info)
+{
+    std::string key = makeKey(device);
+    if (key.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    readFile();
+
+    json resolutions = json::array();
+    for (const auto &v : info.stResolution)
+    {
+        resolutions.push_back({{"format", v.e_format}, {"res", v.c_res}});
+    }
+    json entry = {{"deviceType", info.n_devicetype},
+                  {"builtin", info.b_builtin},
+                  {"resolutions", std::move(resolutions)}};
+    if (devices_.contains(key) && devices_[key] == entry)
+        return;
+
+    devices_[key] = std::move(entry);
+    writeFile();
+    PLOGI("%s saved to cache", key.c_str());
+}
+
+void DeviceInfoCache::readFile()
+{
+    if (loaded_)
+        return;
+    loaded_  = true;
+    devices_ = json::object();
+
+    std::ifstream file(CACHE_PATH);
+    if (!file.is_open())
+        return;
+
+    json j = json::parse(file, nullptr, false);
+    if (j.is_discarded() || !j.is_object() || j["version"] != CACHE_VERSION ||
+        !j["devices"].is_object())
+    {
+        PLOGW("%s is not valid, ignored", CACHE_PATH);
+        return;
+    }
+    devices_ = std::move(j["devices"]);
+    PLOGI("%zu cameras in %s", devices_.size(), CACHE_PATH);
+}
+
+void DeviceInfoCache::writeFile()
+{
+    std::filesystem::path path(CACHE_PATH);
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    // Written aside and renamed, a reader never sees a partial file.
+    std::string tmp = path.string() + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::trunc);
+        if (!file.is_open())
+        {
+            PLOGE("cannot open %s", tmp.c_str());
+            return;
+        }
+        json j = {{"version", CACHE_VERSION}, {"devices", devices_}};
+        file << j.dump();
+        if (!file.good())
+        {
+            PLOGE("cannot write %s", tmp.c_str());
+            std::filesystem::remove(tmp, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if (ec)
+    {
+        PLOGE("cannot rename %s : %s", tmp.c_str(), ec.message().c_str());
+        std::filesystem::remove(tmp, ec);
+    }
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef SERVICE_DEVICE_INFO_CACHE_H_
+#define SERVICE_DEVICE_INFO_CACHE_H_
+
+/*-----------------------------------------------------------------------------
+ (File Inclusions)
+ ----------------------------------------------------------------------------*/
+#include "camera_types.h"
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+
+// Capabilities (formats, resolutions, frame rates) of the cameras seen so far, kept on disk so
+// that getInfo does not enumerate a known camera again, also after the service restarts.
+// A camera is known by its type, vendor id, product id and firmware version.
+class DeviceInfoCache
+{
+public:
+    static DeviceInfoCache &getInstance()
+    {
+        static DeviceInfoCache obj;
+        return obj;
+    }
+
+    // Returns false if the device can not be cached, see makeKey.
+    bool load(const DEVICE_LIST_T &device, camera_device_info_t *p_info);
+    void save(const DEVICE_LIST_T &device, const camera_device_info_t &info);
+
+private:
+    DeviceInfoCache() {}
+
+    static std::string makeKey(const DEVICE_LIST_T &device);
+    void readFile();
+    void writeFile();
+
+    static constexpr const char *CACHE_PATH = "/var/cache/camera/device_info.json";
+    static constexpr int CACHE_VERSION      = 1;
+
+    nlohmann::json devices_;
+    bool loaded_{false};
+    std::mutex mutex_;
+};
+
+#endif /* SERVICE_DEVICE_INFO_CACHE_H_ */
@@ -22,7 +22,9 @@
 #include "addon.h" /* calls platform specific functionality if addon interface has been implemented */
 #include "camera_hal_proxy.h"
 #include "command_manager.h"
+#include "device_info_cache.h"
 #include "event_notification.h"
+#include "request_dispatcher.h"
 #include "whitelist_checker.h"
 
 DeviceManager::DeviceManager() {}
@@ -36,6 +38,7 @@ bool DeviceManager::isDeviceIdValid(int deviceid)
 
 bool DeviceManager::setDeviceStatus(int deviceid, bool status)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     PLOGI("deviceid %d status : %d \n!!", deviceid, status);
 
     if (!isDeviceIdValid(deviceid))
@@ -48,6 +51,7 @@ bool DeviceManager::setDeviceStatus(int deviceid, bool status)
 
 bool DeviceManager::isDeviceOpen(int deviceid)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     if (!isDeviceIdValid(deviceid))
     {
         PLOGE("deviceid %d is an invalid ID", deviceid);
@@ -68,10 +72,15 @@ bool DeviceManager::isDeviceOpen(int deviceid)
     }
 }
 
-bool DeviceManager::isDeviceValid(int deviceid) { return isDeviceIdValid(deviceid); }
+bool DeviceManager::isDeviceValid(int deviceid)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return isDeviceIdValid(deviceid);
+}
 
 void DeviceManager::getDeviceNode(int deviceid, std::string &devicenode)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     PLOGI("deviceid : %d", deviceid);
 
     devicenode = "";
@@ -83,6 +92,7 @@ void DeviceManager::getDeviceNode(int deviceid, std::string &devicenode)
 
 std::string DeviceManager::getDeviceType(int deviceid)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     std::string deviceType = "unknown";
     if (isDeviceIdValid(deviceid))
     {
@@ -93,6 +103,7 @@ std::string DeviceManager::getDeviceType(int deviceid)
 
 std::string DeviceManager::getDeviceKey(int deviceid)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     std::string deviceKey;
     if (isDeviceIdValid(deviceid))
     {
@@ -103,6 +114,7 @@ std::string DeviceManager::getDeviceKey(int deviceid)
 
 int DeviceManager::getDeviceCounts(std::string type)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     int count = 0;
     for (const auto &iter : deviceMap_)
     {
@@ -117,6 +129,7 @@ int DeviceManager::getDeviceCounts(std::string type)
 
 bool DeviceManager::getDeviceUserData(int deviceid, std::string &userData)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     if (isDeviceIdValid(deviceid))
     {
         userData = deviceMap_[deviceid].stList.strUserData;
@@ -127,6 +140,7 @@ bool DeviceManager::getDeviceUserData(int deviceid, std::string &userData)
 
 DEVICE_RETURN_CODE_T DeviceManager::getDeviceIdList(std::vector<int> &idList)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     for (const auto &list : deviceMap_)
         idList.push_back(list.first);
     return DEVICE_OK;
@@ -134,6 +148,7 @@ DEVICE_RETURN_CODE_T DeviceManager::getDeviceIdList(std::vector<int> &idList)
 
 int DeviceManager::addDevice(const DEVICE_LIST_T &deviceInfo)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     DEVICE_STATUS devStatus;
     devStatus.isDeviceOpen      = false;
     devStatus.isDeviceInfoSaved = false;
@@ -149,6 +164,11 @@ int DeviceManager::addDevice(const DEVICE_LIST_T &deviceInfo)
     PLOGI("isPowerOnConnect : %d", deviceInfo.isPowerOnConnect);
     PLOGI("strDeviceNode    : %s", deviceInfo.strDeviceNode.c_str());
     PLOGI("strDeviceKey     : %s", deviceInfo.strDeviceKey.c_str());
+    PLOGI("strVersion       : %s", deviceInfo.strVersion.c_str());
+
+    // a camera seen before does not need to be enumerated by the HAL
+    devStatus.isDeviceInfoSaved =
+        DeviceInfoCache::getInstance().load(deviceInfo, &devStatus.deviceInfoDB);
 
     // Assign a new deviceid
     int deviceid = 0;
@@ -186,6 +206,7 @@ int DeviceManager::addDevice(const DEVICE_LIST_T &deviceInfo)
 
 bool DeviceManager::removeDevice(int deviceid)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     PLOGI("deviceid : %d", deviceid);
 
     if (!isDeviceIdValid(deviceid))
@@ -196,9 +217,10 @@ bool DeviceManager::removeDevice(int deviceid)
 
     if (deviceMap_[deviceid].isDeviceOpen)
     {
-        PLOGI("start cleaning the unplugged device!");
-        CommandManager::getInstance().release(deviceid);
-        PLOGI("end cleaning the unplugged device!");
+        // after the requests of the camera queued before, the main loop does not wait for it
+        PLOGI("cleaning the unplugged device!");
+        RequestDispatcher::getInstance().dispatch(
+            deviceid, [deviceid]() { CommandManager::getInstance().release(deviceid); });
     }
 
     // Pop platform-specific private data associated with this device.
@@ -224,6 +246,7 @@ bool DeviceManager::removeDevice(int deviceid)
 bool DeviceManager::updateDeviceList(std::string deviceType,
                                      const std::vector<DEVICE_LIST_T> &deviceList)
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
     // find unplugged device & remove device
     std::vector<int> unpluggedDeviceIdList;
     for (auto &curDev : deviceMap_)
@@ -270,25 +293,36 @@ DEVICE_RETURN_CODE_T DeviceManager::getInfo(int deviceid, camera_device_info_t *
 
     DEVICE_RETURN_CODE_T ret = DEVICE_OK;
 
+    std::unique_lock<std::recursive_mutex> lock(mutex_);
     if (!isDeviceIdValid(deviceid))
         return DEVICE_ERROR_NODEVICE;
 
     if (!deviceMap_[deviceid].isDeviceInfoSaved)
     {
-        std::string strdevicenode;
-        strdevicenode = deviceMap_[deviceid].stList.strDeviceNode;
+        // the camera asked about, the id may be given to another camera meanwhile
+        const DEVICE_LIST_T device = deviceMap_[deviceid].stList;
 
         std::string deviceType = getDeviceType(deviceid);
         PLOGI("deviceType : %s", deviceType.c_str());
 
-        ret =
-            CameraHalProxy::getDeviceInfo(std::move(strdevicenode), std::move(deviceType), p_info);
+        // the list is not held while the HAL answers
+        lock.unlock();
+        ret = CameraHalProxy::getDeviceInfo(device.strDeviceNode, std::move(deviceType), p_info);
+        lock.lock();
 
         if (DEVICE_OK != ret)
         {
             PLOGI("Failed to get device info\n");
             return ret;
         }
+        if (!isDeviceIdValid(deviceid) ||
+            deviceMap_[deviceid].stList.strDeviceNode != device.strDeviceNode ||
+            deviceMap_[deviceid].stList.strVendorID != device.strVendorID ||
+            deviceMap_[deviceid].stList.strProductID != device.strProductID)
+        {
+            PLOGW("device %d was unplugged while the HAL answered", deviceid);
+            return DEVICE_ERROR_NODEVICE;
+        }
         // save DB data S
         deviceMap_[deviceid].deviceInfoDB.stResolution.clear();
 
@@ -302,6 +336,8 @@ DEVICE_RETURN_CODE_T DeviceManager::getInfo(int deviceid, camera_device_info_t *
 
         deviceMap_[deviceid].deviceInfoDB.n_devicetype = p_info->n_devicetype;
         deviceMap_[deviceid].deviceInfoDB.b_builtin    = p_info->b_builtin;
+        DeviceInfoCache::getInstance().save(deviceMap_[deviceid].stList,
+                                            deviceMap_[deviceid].deviceInfoDB);
         PLOGI("save DB, deviceid:%d\n", deviceid);
         // save DB data E
         p_info->str_devicename = deviceMap_[deviceid].stList.strProductName;
@@ -24,6 +24,7 @@
 #include "camera_types.h"
 #include "luna-service2/lunaservice.h"
 #include <map>
+#include <mutex>
 #include <vector>
 
 typedef struct DEVICE_STATUS_
@@ -41,6 +42,8 @@ private:
     std::map<int, DEVICE_STATUS> deviceMap_;
     LSHandle *lshandle_{nullptr};
     std::shared_ptr<AddOn> pAddon_;
+    // the list changes on the main loop and is read by the request workers of the cameras
+    std::recursive_mutex mutex_;
 
     bool isDeviceIdValid(int deviceid);
 
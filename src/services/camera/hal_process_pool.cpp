@@ -0,0 +1,292 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/*-----------------------------------------------------------------------------
+ (File Inclusions)
+ ----------------------------------------------------------------------------*/
+#define LOG_TAG "HalProcessPool"
+#include "hal_process_pool.h"
+#include "camera/luna_client.h"
+#include "camera_constants.h"
+#include "camera_log.h"
+#include "generate_unique_id.h"
+#include "hal_command_channel.h"
+#include "json_utils.h"
+#include "process.h"
+#include <chrono>
+#include <cstdlib>
+#include <system_error>
+#include <unistd.h>
+
+#define WARM_UP_TIMEOUT 4000 // ms
+
+const std::string CameraHalExecutable = "/usr/sbin/com.webos.service.camera2.hal";
+
+HalConnection::HalConnection(const std::string &options)
+{
+    GMainContext *c = g_main_context_new();
+    loop_           = g_main_loop_new(c, false);
+
+    // the first dispatch of the loop tells that it runs
+    struct LoopStart
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool running{false};
+    } start;
+    GSource *idle = g_idle_source_new();
+    g_source_set_callback(
+        idle,
+        +[](gpointer data) -> gboolean
+        {
+            LoopStart *start = static_cast<LoopStart *>(data);
+            {
+                std::lock_guard<std::mutex> lock(start->mutex);
+                start->running = true;
+            }
+            start->cv.notify_one();
+            return G_SOURCE_REMOVE;
+        },
+        &start, nullptr);
+    g_source_attach(idle, c);
+    g_source_unref(idle);
+
+    try
+    {
+        loopThread_ = std::make_unique<std::thread>(g_main_loop_run, loop_);
+    }
+    catch (const std::system_error &e)
+    {
+        PLOGE("Caught a system_error with code %d meaning %s", e.code().value(), e.what());
+        g_main_loop_unref(loop_);
+        g_main_context_unref(c);
+        throw;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(start.mutex);
+        start.cv.wait(lock, [&start] { return start.running; });
+    }
+
+    pthread_setname_np(loopThread_->native_handle(), "halproxy_luna");
+
+    std::string guid         = GenerateUniqueID()();
+    std::string service_name = cstr_uricameramain + "." + guid;
+    client                   = std::make_unique<LunaClient>(service_name.c_str(), c);
+    g_main_context_unref(c);
+
+    // start process
+    uid        = cstr_uricamearhal + guid;
+    serviceUri = "luna://" + uid + "/";
+
+    std::string cmd = CameraHalExecutable + " " + options + " -s" + uid;
+    process         = std::make_unique<Process>(cmd);
+}
+
+HalConnection::~HalConnection()
+{
+    // waits for the HAL process to exit
+    process.reset();
+
+    g_main_loop_quit(loop_);
+    if (loopThread_->joinable())
+    {
+        try
+        {
+            loopThread_->join();
+        }
+        catch (const std::system_error &e)
+        {
+            PLOGE("Caught a system_error with code %d meaning %s", e.code().value(), e.what());
+        }
+    }
+    g_main_loop_unref(loop_);
+}
+
+bool HalConnection::openChannel(int timeout)
+{
+    std::string uri = serviceUri + "openChannel";
+    std::string resp;
+    int fd = -1;
+    if (!client->callSync(uri.c_str(), "{}", &resp, timeout, &fd))
+    {
+        PLOGE("%s failed", uri.c_str());
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    json j = json::parse(resp, nullptr, false);
+    if (j.is_discarded() || !get_optional<bool>(j, CONST_PARAM_NAME_RETURNVALUE).value_or(false) ||
+        fd < 0)
+    {
+        PLOGE("no channel to %s : %s", uid.c_str(), resp.c_str());
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    channel = std::make_unique<HalCommandClient>(fd);
+    PLOGI("channel to %s is open", uid.c_str());
+    return true;
+}
+
+HalProcessPool::~HalProcessPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (tidRefill_.joinable())
+    {
+        tidRefill_.join();
+    }
+
+    // the idle processes have no device open, nothing to close
+    for (auto &hal : idle_)
+    {
+        hal->process->terminate();
+    }
+    idle_.clear();
+}
+
+size_t HalProcessPool::configuredSize()
+{
+    const char *env = getenv("CAMERA_HAL_POOL_SIZE");
+    if (env == nullptr || *env == '\0')
+        return CAMERA_HAL_POOL_SIZE;
+
+    char *end = nullptr;
+    long size = strtol(env, &end, 10);
+    if (*end != '\0' || size < 0)
+    {
+        PLOGW("invalid CAMERA_HAL_POOL_SIZE '%s', %d is used", env, CAMERA_HAL_POOL_SIZE);
+        return CAMERA_HAL_POOL_SIZE;
+    }
+    return static_cast<size_t>(size);
+}
+
+void HalProcessPool::start(size_t size)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_ || size == 0)
+        return;
+
+    PLOGI("pool size %zu", size);
+    size_      = size;
+    running_   = true;
+    tidRefill_ = std::thread{[this]() { this->run(); }};
+}
+
+std::unique_ptr<HalConnection> HalProcessPool::acquire()
+{
+    // a process may have died while idle, its createHal and channel would go nowhere
+    std::deque<std::unique_ptr<HalConnection>> dead;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (!idle_.empty())
+        {
+            std::unique_ptr<HalConnection> hal = std::move(idle_.front());
+            idle_.pop_front();
+            cv_.notify_all();
+            if (!hal->process->isRunning())
+            {
+                PLOGW("%s in pool has exited", hal->uid.c_str());
+                dead.push_back(std::move(hal));
+                continue;
+            }
+            PLOGI("%s from pool, %zu left", hal->uid.c_str(), idle_.size());
+            return hal;
+        }
+    }
+    // released without the lock, the refill goes on meanwhile
+    dead.clear();
+
+    PLOGI("pool is empty, start a new HAL process");
+    try
+    {
+        return std::make_unique<HalConnection>();
+    }
+    catch (const std::system_error &e)
+    {
+        PLOGE("no connection to a HAL process : %s", e.what());
+        return nullptr;
+    }
+}
+
+std::unique_ptr<HalConnection> HalProcessPool::createWarm()
+{
+    std::unique_ptr<HalConnection> hal;
+    try
+    {
+        hal = std::make_unique<HalConnection>();
+    }
+    catch (const std::system_error &e)
+    {
+        PLOGE("no connection to a HAL process : %s", e.what());
+        return nullptr;
+    }
+
+    // createHal loads the plugin. A failure leaves a cold but usable process.
+    json jin;
+    jin[CONST_PARAM_NAME_SUBSYSTEM] = CAMERA_HAL_POOL_SUBSYSTEM;
+    std::string uri                 = hal->serviceUri + "createHal";
+    std::string resp;
+    if (hal->client->callSync(uri.c_str(), to_string(jin).c_str(), &resp, WARM_UP_TIMEOUT))
+    {
+        json j = json::parse(resp, nullptr, false);
+        if (!j.is_discarded() &&
+            get_optional<bool>(j, CONST_PARAM_NAME_RETURNVALUE).value_or(false))
+            hal->subsystem = CAMERA_HAL_POOL_SUBSYSTEM;
+    }
+    hal->openChannel(WARM_UP_TIMEOUT);
+    PLOGI("%s ready, subsystem '%s'", hal->uid.c_str(), hal->subsystem.c_str());
+    return hal;
+}
+
+void HalProcessPool::run()
+{
+    pthread_setname_np(pthread_self(), "hal_pool");
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        cv_.wait(lock, [this] { return idle_.size() < size_ || !running_; });
+        if (!running_)
+            break;
+
+        // started without the lock, acquire does not wait for the refill
+        lock.unlock();
+        std::unique_ptr<HalConnection> hal = createWarm();
+        lock.lock();
+
+        if (!running_)
+        {
+            if (hal)
+                hal->process->terminate();
+            break;
+        }
+        // tried again later, acquire starts processes of its own meanwhile
+        if (!hal)
+        {
+            cv_.wait_for(lock, std::chrono::milliseconds(WARM_UP_TIMEOUT),
+                         [this] { return !running_; });
+            continue;
+        }
+        idle_.push_back(std::move(hal));
+    }
+}
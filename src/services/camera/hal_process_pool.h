@@ -0,0 +1,98 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef SERVICE_HAL_PROCESS_POOL_H_
+#define SERVICE_HAL_PROCESS_POOL_H_
+
+/*-----------------------------------------------------------------------------
+ (File Inclusions)
+ ----------------------------------------------------------------------------*/
+#include <condition_variable>
+#include <deque>
+#include <glib.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifndef CAMERA_HAL_POOL_SIZE
+#define CAMERA_HAL_POOL_SIZE 1
+#endif
+// plugin created in the pooled processes, the one of the PDM cameras
+#define CAMERA_HAL_POOL_SUBSYSTEM "v4l2"
+
+class HalCommandClient;
+class LunaClient;
+class Process;
+
+// A HAL process and the luna client, with its loop thread, that talks to it.
+class HalConnection
+{
+    GMainLoop *loop_{nullptr};
+    std::unique_ptr<std::thread> loopThread_;
+
+public:
+    // options : command line options of the HAL process besides its service name
+    HalConnection(const std::string &options = "");
+    ~HalConnection();
+
+    // Opens the binary command channel, see HalCommandChannel. Luna is used without it.
+    bool openChannel(int timeout);
+
+    std::unique_ptr<LunaClient> client;
+    std::unique_ptr<HalCommandClient> channel;
+    std::unique_ptr<Process> process;
+    std::string uid;        // service name of the HAL process
+    std::string serviceUri; // "luna://<uid>/"
+    std::string subsystem;  // plugin created ahead by the pool, empty if none
+};
+
+// HAL processes started ahead of time, with the plugin of CAMERA_HAL_POOL_SUBSYSTEM created, so
+// that opening a camera does not wait for fork/exec, luna registration and plugin loading.
+// A connection taken from the pool is replaced in the background.
+class HalProcessPool
+{
+public:
+    static HalProcessPool &getInstance()
+    {
+        static HalProcessPool obj;
+        return obj;
+    }
+
+    // Size of the pool, from the environment variable CAMERA_HAL_POOL_SIZE if it is set, else
+    // the one of the build.
+    static size_t configuredSize();
+    // Fills the pool up to size processes, 0 disables the pool.
+    void start(size_t size = configuredSize());
+    // Returns a warm connection, or starts a new one if the pool has no live process.
+    std::unique_ptr<HalConnection> acquire();
+
+private:
+    HalProcessPool() {}
+    ~HalProcessPool();
+
+    void run();
+    static std::unique_ptr<HalConnection> createWarm();
+
+    size_t size_{0};
+    bool running_{false};
+    std::deque<std::unique_ptr<HalConnection>> idle_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread tidRefill_;
+};
+
+#endif /* SERVICE_HAL_PROCESS_POOL_H_ */
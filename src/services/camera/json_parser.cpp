@@ -139,6 +139,98 @@ std::string OpenMethod::createOpenObjectJsonString() const
     return str_reply;
 }
 
+void OpenStreamMethod::getOpenStreamObject(const char *input, const char *schemapath)
+{
+    jvalue_ref j_obj;
+    int retval = deSerialize(input, schemapath, j_obj);
+
+    if (0 == retval)
+    {
+        raw_buffer str_appid =
+            jstring_get_fast(jobject_get(j_obj, J_CSTR_TO_BUF(CONST_PARAM_NAME_APPID)));
+        setAppId(str_appid.m_str);
+        raw_buffer str_id =
+            jstring_get_fast(jobject_get(j_obj, J_CSTR_TO_BUF(CONST_PARAM_NAME_ID)));
+        setCameraId(str_id.m_str);
+        str_id = jstring_get_fast(jobject_get(j_obj, J_CSTR_TO_BUF(CONST_PARAM_NAME_APP_PRIORITY)));
+        std::string priority = str_id.m_str;
+        // Only empty or primary or secondary are valid, as open
+        if ((0 == priority.length()) || (cstr_primary == priority) || (cstr_secondary == priority))
+        {
+            setAppPriority(str_id.m_str);
+        }
+        else
+        {
+            setCameraId(cstr_invaliddeviceid);
+        }
+
+        jvalue_ref jobj_params;
+        if (jobject_get_exists(j_obj, J_CSTR_TO_BUF(CONST_PARAM_NAME_PARAMS), &jobj_params))
+        {
+            CAMERA_FORMAT rcameraparams;
+            int nWidth = 0, nHeight = 0;
+
+            jvalue_ref jparams = jobject_get(jobj_params, J_CSTR_TO_BUF(CONST_PARAM_NAME_WIDTH));
+            jnumber_get_i32(jparams, &nWidth);
+            rcameraparams.nWidth = (nWidth > 0) ? nWidth : 0;
+            jparams = jobject_get(jobj_params, J_CSTR_TO_BUF(CONST_PARAM_NAME_HEIGHT));
+            jnumber_get_i32(jparams, &nHeight);
+            rcameraparams.nHeight = (nHeight > 0) ? nHeight : 0;
+            jparams               = jobject_get(jobj_params, J_CSTR_TO_BUF(CONST_PARAM_NAME_FPS));
+            jnumber_get_i32(jparams, &rcameraparams.nFps);
+            raw_buffer strformat =
+                jstring_get_fast(jobject_get(jobj_params, J_CSTR_TO_BUF(CONST_PARAM_NAME_FORMAT)));
+            std::string format = strformat.m_str;
+
+            camera_format_t eformat;
+            convertFormatToCode(std::move(format), &eformat);
+            rcameraparams.eFormat = eformat;
+
+            setCameraFormat(rcameraparams);
+        }
+
+        raw_buffer str_memtype =
+            jstring_get_fast(jobject_get(j_obj, J_CSTR_TO_BUF(CONST_PARAM_NAME_MEMTYPE)));
+        setMemType(str_memtype.m_str ? std::string(str_memtype.m_str, str_memtype.m_len)
+                                     : cstr_shmem);
+    }
+    else
+    {
+        setCameraId(cstr_invaliddeviceid);
+    }
+    j_release(&j_obj);
+}
+
+std::string OpenStreamMethod::createOpenStreamObjectJsonString() const
+{
+    jvalue_ref json_outobj = jobject_create();
+    std::string str_reply;
+
+    MethodReply obj_reply = getMethodReply();
+
+    if (obj_reply.bGetReturnValue())
+    {
+        jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_RETURNVALUE),
+                    jboolean_create(obj_reply.bGetReturnValue()));
+        jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_DEVICE_HANDLE),
+                    jnumber_create_i32(getDeviceHandle()));
+    }
+    else
+    {
+        createJsonStringFailure(obj_reply, json_outobj);
+        if (!getFailedStep().empty())
+            jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_FAILED_STEP),
+                        jstring_create(getFailedStep().c_str()));
+    }
+
+    const char *str = jvalue_stringify(json_outobj);
+    if (str)
+        str_reply = str;
+    j_release(&json_outobj);
+
+    return str_reply;
+}
+
 void StartCameraMethod::getStartCameraObject(const char *input, const char *schemapath)
 {
     jvalue_ref j_obj;
@@ -150,6 +242,11 @@ void StartCameraMethod::getStartCameraObject(const char *input, const char *sche
         jvalue_ref jnum    = jobject_get(j_obj, J_CSTR_TO_BUF(CONST_DEVICE_HANDLE));
         jnumber_get_i32(jnum, &n_devicehandle);
         setDeviceHandle(n_devicehandle);
+
+        raw_buffer str_memtype =
+            jstring_get_fast(jobject_get(j_obj, J_CSTR_TO_BUF(CONST_PARAM_NAME_MEMTYPE)));
+        setMemType(str_memtype.m_str ? std::string(str_memtype.m_str, str_memtype.m_len)
+                                     : cstr_shmem);
     }
     else
     {
@@ -253,6 +350,22 @@ void StopCameraPreviewCaptureCloseMethod::getObject(const char *input, const cha
     j_release(&j_obj);
 }
 
+static jvalue_ref createCaptureStatsJson(const CAPTURE_STATS_T &stats)
+{
+    jvalue_ref json_stats = jobject_create();
+    jobject_put(json_stats, J_CSTR_TO_JVAL(CONST_PARAM_NAME_FRAMES),
+                jnumber_create_i64(stats.frames));
+    jobject_put(json_stats, J_CSTR_TO_JVAL(CONST_PARAM_NAME_DROPPED),
+                jnumber_create_i64(stats.dropped));
+    jobject_put(json_stats, J_CSTR_TO_JVAL(CONST_PARAM_NAME_BYTES),
+                jnumber_create_i64(stats.bytes));
+    jobject_put(json_stats, J_CSTR_TO_JVAL(CONST_PARAM_NAME_MAX_QUEUE_DEPTH),
+                jnumber_create_i64(stats.maxQueueDepth));
+    jobject_put(json_stats, J_CSTR_TO_JVAL(CONST_PARAM_NAME_THROUGHPUT),
+                jnumber_create_i64(stats.throughputKBps));
+    return json_stats;
+}
+
 std::string StopCameraPreviewCaptureCloseMethod::createObjectJsonString() const
 {
     jvalue_ref json_outobj = jobject_create();
@@ -264,6 +377,9 @@ std::string StopCameraPreviewCaptureCloseMethod::createObjectJsonString() const
     {
         jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_RETURNVALUE),
                     jboolean_create(objreply.bGetReturnValue()));
+        if (b_capturestats_)
+            jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_CAPTURE_STATS),
+                        createCaptureStatsJson(ro_capturestats_));
     }
     else
     {
@@ -431,6 +547,9 @@ CaptureMethod::createCaptureObjectJsonString(std::vector<std::string> &capturedF
             jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_IMAGE_PATH),
                         json_captured_files_array);
         }
+        if (b_capturestats_)
+            jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_CAPTURE_STATS),
+                        createCaptureStatsJson(ro_capturestats_));
     }
     else
     {
@@ -709,6 +828,18 @@ std::string GetSetPropertiesMethod::createSetPropertiesObjectJsonString() const
     {
         jobject_put(json_outbj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_RETURNVALUE),
                     jboolean_create(objreply.bGetReturnValue()));
+
+        // the other properties are set, the failed ones keep their previous values
+        jvalue_ref json_failed = jarray_create(0);
+        for (int i = 0; i < PROPERTY_END; i++)
+        {
+            if (ro_failed_.stGetData.data[i][QUERY_VALUE] != CONST_PARAM_DEFAULT_VALUE)
+                jarray_append(json_failed, jstring_create(getParamString(i).c_str()));
+        }
+        if (jarray_size(json_failed) > 0)
+            jobject_put(json_outbj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_FAILED_PARAMS), json_failed);
+        else
+            j_release(&json_failed);
     }
     else
     {
@@ -816,6 +947,10 @@ void GetFdMethod::getObject(const char *input, const char *schemapath)
         raw_buffer str_type =
             jstring_get_fast(jobject_get(j_obj, J_CSTR_TO_BUF(CONST_PARAM_NAME_TYPE)));
         setType(str_type.m_str);
+
+        int index = 0;
+        jnumber_get_i32(jobject_get(j_obj, J_CSTR_TO_BUF(CONST_PARAM_NAME_INDEX)), &index);
+        setIndex(index);
     }
     else
     {
@@ -884,7 +1019,8 @@ void GetSolutionsMethod::getObject(const char *input, const char *schemapath)
 
 std::string
 GetSolutionsMethod::createObjectJsonString(std::vector<std::string> &supportedSolutionList,
-                                           std::vector<std::string> &enabledSolutionList) const
+                                           std::vector<std::string> &enabledSolutionList,
+                                           const std::vector<solution_status_t> &statusList) const
 {
     jvalue_ref json_outobj                    = jobject_create();
     jvalue_ref json_supported_solutions_array = jarray_create(0);
@@ -919,11 +1055,31 @@ GetSolutionsMethod::createObjectJsonString(std::vector<std::string> &supportedSo
 
                 jvalue_ref json_paramsobj = jobject_create();
                 jobject_put(json_paramsobj, J_CSTR_TO_JVAL("enable"), jboolean_create(isEnabled));
-                /* To do: TBD */
-                /*
-                jobject_put(json_paramsobj, J_CSTR_TO_JVAL("Key_1"), jstring_create(string_value));
-                jobject_put(json_paramsobj, J_CSTR_TO_JVAL("Key_2"), jnumber_create_i32(num_value));
-                */
+
+                // schedule of a running solution, and the rate and latency it achieves
+                for (const auto &status : statusList)
+                {
+                    if (status.name != supportedSolution)
+                        continue;
+
+                    jobject_put(json_paramsobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_FPS),
+                                jnumber_create_f64(status.schedule.fps));
+                    jobject_put(json_paramsobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_MAX_LATENCY),
+                                jnumber_create_i32(status.schedule.max_latency_ms));
+                    jobject_put(json_paramsobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_PRIORITY),
+                                jnumber_create_i32(status.schedule.priority));
+
+                    jvalue_ref json_statusobj = jobject_create();
+                    jobject_put(json_statusobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_FPS),
+                                jnumber_create_f64(status.fps));
+                    jobject_put(json_statusobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_LATENCY),
+                                jnumber_create_i32(status.latency_ms));
+                    jobject_put(json_statusobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_SKIPPED),
+                                jnumber_create_i64(static_cast<int64_t>(status.skipped)));
+                    jobject_put(json_solution_obj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_STATUS),
+                                json_statusobj);
+                    break;
+                }
                 jobject_put(json_solution_obj, J_CSTR_TO_JVAL("params"), json_paramsobj);
 
                 jarray_append(json_supported_solutions_array, json_solution_obj);
@@ -1000,15 +1156,26 @@ void SetSolutionsMethod::getObject(const char *input, const char *schemapath)
             jvalue_ref j_param_obj =
                 jobject_get(jarray_get(j_solutions_obj, i), J_CSTR_TO_BUF("params"));
             jboolean_get(jobject_get(j_param_obj, J_CSTR_TO_BUF("enable")), &enable);
-            /* To do: TBD */
-            /*
-            jboolean_get(jobject_get(j_param_obj, J_CSTR_TO_BUF("Key1")), &enable);
-            jboolean_get(jobject_get(j_param_obj, J_CSTR_TO_BUF("Key2")), &enable);
-            */
 
             if (true == enable)
             {
                 setEnableSolutionList(strid.m_str);
+
+                // optional schedule, zero fields keep the values of the solution
+                solution_schedule_t schedule;
+                jvalue_ref j_value = jobject_get(j_param_obj, J_CSTR_TO_BUF(CONST_PARAM_NAME_FPS));
+                if (jis_number(j_value))
+                    jnumber_get_f64(j_value, &schedule.fps);
+                j_value = jobject_get(j_param_obj, J_CSTR_TO_BUF(CONST_PARAM_NAME_MAX_LATENCY));
+                if (jis_number(j_value))
+                    jnumber_get_i32(j_value, &schedule.max_latency_ms);
+                j_value = jobject_get(j_param_obj, J_CSTR_TO_BUF(CONST_PARAM_NAME_PRIORITY));
+                if (jis_number(j_value))
+                    jnumber_get_i32(j_value, &schedule.priority);
+                if (schedule.fps > 0.0 || schedule.max_latency_ms > 0 || schedule.priority != 0)
+                {
+                    schedules_[strid.m_str] = schedule;
+                }
             }
             else
             {
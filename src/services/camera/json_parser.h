@@ -141,11 +141,17 @@ private:
 class StartCameraMethod
 {
 public:
-    StartCameraMethod() { n_devicehandle_ = -1; }
+    StartCameraMethod()
+    {
+        n_devicehandle_ = -1;
+        str_memtype_    = cstr_shmem;
+    }
     ~StartCameraMethod() {}
 
     void setDeviceHandle(int devhandle) { n_devicehandle_ = devhandle; }
     int getDeviceHandle() const { return n_devicehandle_; }
+    void setMemType(const std::string &memtype) { str_memtype_ = memtype; }
+    std::string getMemType() const { return str_memtype_; }
 
     void setMethodReply(bool returnvalue, int errorcode, std::string errortext)
     {
@@ -160,6 +166,57 @@ public:
 
 private:
     int n_devicehandle_;
+    std::string str_memtype_;
+    MethodReply objreply_;
+};
+
+class OpenStreamMethod
+{
+public:
+    OpenStreamMethod() : n_devicehandle_(n_invalid_id), str_memtype_(cstr_shmem), ro_params_() {}
+    ~OpenStreamMethod() {}
+
+    void setDeviceHandle(int devhandle) { n_devicehandle_ = devhandle; }
+    int getDeviceHandle() const { return n_devicehandle_; }
+
+    void setCameraId(const std::string &devid) { str_devid_ = devid; }
+    std::string getCameraId() const { return str_devid_; }
+
+    void setAppId(const std::string &appid) { str_appid_ = appid; }
+    std::string getAppId() const { return str_appid_; }
+
+    void setAppPriority(const std::string &priority) { str_priority_ = priority; }
+    std::string getAppPriority() const { return str_priority_; }
+
+    // nWidth is 0 if the format is not given, the device keeps its format then
+    void setCameraFormat(CAMERA_FORMAT rin_params) { ro_params_ = rin_params; }
+    CAMERA_FORMAT rGetCameraFormat() const { return ro_params_; }
+
+    void setMemType(const std::string &memtype) { str_memtype_ = memtype; }
+    std::string getMemType() const { return str_memtype_; }
+
+    void setFailedStep(const std::string &step) { str_step_ = step; }
+    std::string getFailedStep() const { return str_step_; }
+
+    void setMethodReply(bool returnvalue, int errorcode, std::string errortext)
+    {
+        objreply_.setReturnValue(returnvalue);
+        objreply_.setErrorCode(errorcode);
+        objreply_.setErrorText(errortext);
+    }
+    MethodReply getMethodReply() const { return objreply_; }
+
+    void getOpenStreamObject(const char *, const char *);
+    std::string createOpenStreamObjectJsonString() const;
+
+private:
+    int n_devicehandle_;
+    std::string str_devid_;
+    std::string str_appid_;
+    std::string str_priority_;
+    std::string str_memtype_;
+    std::string str_step_;
+    CAMERA_FORMAT ro_params_;
     MethodReply objreply_;
 };
 
@@ -267,6 +324,12 @@ public:
     }
     MethodReply getMethodReply() const { return objreply_; }
 
+    void setCaptureStats(const CAPTURE_STATS_T &stats)
+    {
+        ro_capturestats_ = stats;
+        b_capturestats_  = true;
+    }
+
     void getCaptureObject(const char *, const char *);
     std::string createCaptureObjectJsonString(std::vector<std::string> &capturedFiles) const;
 
@@ -274,6 +337,8 @@ private:
     int n_devicehandle_;
     int n_image_;
     std::string str_path_;
+    CAPTURE_STATS_T ro_capturestats_{};
+    bool b_capturestats_{false};
     MethodReply objreply_;
 };
 
@@ -293,12 +358,20 @@ public:
         objreply_.setErrorText(errortext);
     }
     MethodReply getMethodReply() const { return objreply_; }
+    // stopCapture only
+    void setCaptureStats(const CAPTURE_STATS_T &stats)
+    {
+        ro_capturestats_ = stats;
+        b_capturestats_  = true;
+    }
 
     void getObject(const char *, const char *);
     std::string createObjectJsonString() const;
 
 private:
     int n_devicehandle_;
+    CAPTURE_STATS_T ro_capturestats_{};
+    bool b_capturestats_{false};
     MethodReply objreply_;
 };
 
@@ -374,6 +447,8 @@ public:
 
     void setParams(const std::string &param) { str_params_.push_back(param); }
     std::vector<std::string> getParams() { return str_params_; }
+    // properties of setProperties the device did not take
+    void setFailedProperties(const CAMERA_PROPERTIES_T &failed) { ro_failed_ = failed; }
 
     void setMethodReply(bool returnvalue, int errorcode, std::string errortext)
     {
@@ -393,6 +468,7 @@ public:
 private:
     int n_devicehandle_;
     CAMERA_PROPERTIES_T ro_camproperties_;
+    CAMERA_PROPERTIES_T ro_failed_;
     std::vector<std::string> str_params_;
     std::string str_devid_;
     bool b_issubscribed_;
@@ -437,7 +513,11 @@ private:
 class GetFdMethod
 {
 public:
-    GetFdMethod() { n_devicehandle_ = -1; };
+    GetFdMethod()
+    {
+        n_devicehandle_ = -1;
+        n_index_        = 0;
+    };
     ~GetFdMethod() {}
 
     void setDeviceHandle(int devhandle) { n_devicehandle_ = devhandle; }
@@ -446,6 +526,9 @@ public:
     void setType(const std::string &type) { str_type_ = type; }
     std::string getType() const { return str_type_; }
 
+    void setIndex(int index) { n_index_ = index; }
+    int getIndex() const { return n_index_; }
+
     void setMethodReply(bool returnvalue, int errorcode, std::string errortext)
     {
         objreply_.setReturnValue(returnvalue);
@@ -460,6 +543,7 @@ public:
 private:
     int n_devicehandle_;
     std::string str_type_;
+    int n_index_;
     MethodReply objreply_;
 };
 
@@ -483,7 +567,8 @@ public:
 
     void getObject(const char *, const char *);
     std::string createObjectJsonString(std::vector<std::string> &supportedSolutionList,
-                                       std::vector<std::string> &enabledSolutionList) const;
+                                       std::vector<std::string> &enabledSolutionList,
+                                       const std::vector<solution_status_t> &statusList) const;
 
 private:
     int n_devicehandle_;
@@ -511,6 +596,10 @@ public:
         str_disable_solutions_.push_back(solution);
     }
     std::vector<std::string> getDisableSolutionList() { return str_disable_solutions_; }
+    const std::map<std::string, solution_schedule_t> &getSolutionSchedules() const
+    {
+        return schedules_;
+    }
     bool isEmpty();
     void setMethodReply(bool returnvalue, int errorcode, std::string errortext)
     {
@@ -528,6 +617,7 @@ private:
     std::string str_devid_;
     std::vector<std::string> str_enable_solutions_;
     std::vector<std::string> str_disable_solutions_;
+    std::map<std::string, solution_schedule_t> schedules_;
     MethodReply objreply_;
 };
 
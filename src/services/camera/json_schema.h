@@ -145,6 +145,69 @@ const char *setFormatSchema = "{ \
   } \
 }";
 
+const char *openStreamSchema = "{ \
+  \"type\": \"object\", \
+  \"title\": \"The Root Schema\", \
+  \"required\": [ \
+    \"id\" \
+  ], \
+  \"properties\": { \
+    \"id\": { \
+      \"type\": \"string\", \
+      \"title\": \"The Id Schema\", \
+      \"default\": \"\", \
+      \"pattern\": \"^(.*)$\" \
+    }, \
+    \"mode\": { \
+      \"type\": \"string\", \
+      \"title\": \"The Priority Schema\", \
+      \"default\": \"\", \
+      \"pattern\": \"^(.*)$\" \
+    }, \
+    \"appId\": { \
+      \"type\": \"string\", \
+      \"title\": \"Application Id of The Client Application\", \
+      \"default\": \"\" \
+    }, \
+    \"params\": { \
+      \"type\": \"object\", \
+      \"title\": \"The Params Schema\", \
+      \"required\": [ \
+        \"width\", \
+        \"height\", \
+        \"format\", \
+        \"fps\" \
+      ], \
+      \"properties\": { \
+        \"width\": { \
+          \"type\": \"integer\", \
+          \"title\": \"The Width Schema\", \
+          \"default\": 0 \
+        }, \
+        \"height\": { \
+          \"type\": \"integer\", \
+          \"title\": \"The Height Schema\", \
+          \"default\": 0 \
+        }, \
+        \"fps\": { \
+          \"type\": \"integer\", \
+          \"title\": \"The fps Schema\", \
+          \"default\": 0 \
+        }, \
+        \"format\": { \
+          \"type\": \"string\", \
+          \"title\": \"The Format Schema\" \
+        } \
+      } \
+    }, \
+    \"memType\": { \
+      \"type\": \"string\", \
+      \"title\": \"The Memory Type Schema\", \
+      \"enum\": [\"shmem\", \"dmabuf\"] \
+    } \
+  } \
+}";
+
 const char *setPropertiesSchema = "{ \
   \"type\": \"object\", \
   \"title\": \"The Root Schema\", \
@@ -261,6 +324,11 @@ const char *startCameraSchema = "{ \
       \"type\": \"integer\", \
       \"title\": \"The Handle Schema\", \
       \"default\": 0 \
+    }, \
+    \"memType\": { \
+      \"type\": \"string\", \
+      \"title\": \"The Memory Type Schema\", \
+      \"enum\": [\"shmem\", \"dmabuf\"] \
     } \
   } \
 }";
@@ -333,6 +401,12 @@ const char *getFdSchema = "{ \
       \"title\": \"The FD type Schema\", \
       \"default\": \"\", \
       \"pattern\": \"^(.*)$\" \
+    }, \
+    \"index\": { \
+      \"type\": \"integer\", \
+      \"title\": \"The Buffer Index Schema\", \
+      \"minimum\": 0, \
+      \"default\": 0 \
     } \
   } \
 }";
@@ -401,6 +475,22 @@ const char *setSolutionsSchema = "{ \
                 \"type\": \"boolean\", \
                 \"title\": \"The enable Schema\", \
                 \"default\": false \
+              }, \
+              \"fps\": { \
+                \"type\": \"number\", \
+                \"title\": \"The fps Schema\", \
+                \"minimum\": 0 \
+              }, \
+              \"maxLatency\": { \
+                \"type\": \"integer\", \
+                \"title\": \"The maxLatency Schema\", \
+                \"minimum\": 0 \
+              }, \
+              \"priority\": { \
+                \"type\": \"integer\", \
+                \"title\": \"The priority Schema\", \
+                \"minimum\": -20, \
+                \"maximum\": 19 \
               } \
             } \
           } \
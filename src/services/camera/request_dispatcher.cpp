@@ -0,0 +1,138 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/*-----------------------------------------------------------------------------
+ (File Inclusions)
+ ----------------------------------------------------------------------------*/
+#define LOG_TAG "RequestDispatcher"
+#include "request_dispatcher.h"
+#include "camera_log.h"
+#include <glib.h>
+#include <string>
+#include <system_error>
+
+RequestDispatcher::~RequestDispatcher()
+{
+    for (auto *workers : {&workers_, &queryWorkers_})
+    {
+        for (auto &it : *workers)
+        {
+            Worker *worker = it.second.get();
+            {
+                std::lock_guard<std::mutex> lock(worker->mutex);
+                worker->running = false;
+            }
+            worker->cv.notify_all();
+            if (worker->thread.joinable())
+            {
+                worker->thread.join();
+            }
+        }
+    }
+}
+
+void RequestDispatcher::dispatch(int deviceid, std::function<void()> job)
+{
+    queue(workers_, "camera_req" + std::to_string(deviceid), deviceid, std::move(job));
+}
+
+void RequestDispatcher::dispatchQuery(int deviceid, std::function<void()> job)
+{
+    queue(queryWorkers_, "camera_qry" + std::to_string(deviceid), deviceid, std::move(job));
+}
+
+void RequestDispatcher::queue(std::map<int, std::unique_ptr<Worker>> &workers,
+                              const std::string &name, int deviceid, std::function<void()> job)
+{
+    Worker *worker = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = workers.find(deviceid);
+        if (it == workers.end())
+        {
+            // the worker of a camera lives as long as the service, the ids are reused
+            auto w = std::make_unique<Worker>();
+            try
+            {
+                w->thread = std::thread(run, name, w.get());
+            }
+            catch (const std::system_error &e)
+            {
+                PLOGE("Caught a system_error with code %d meaning %s", e.code().value(), e.what());
+            }
+            if (w->thread.joinable())
+                it = workers.emplace(deviceid, std::move(w)).first;
+        }
+        if (it != workers.end())
+            worker = it->second.get();
+    }
+
+    // without a worker the request runs here, as it did before
+    if (worker == nullptr)
+    {
+        job();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->jobs.push_back(std::move(job));
+        PLOGD("%s : %zu queued", name.c_str(), worker->jobs.size());
+    }
+    worker->cv.notify_one();
+}
+
+void RequestDispatcher::complete(std::function<void()> done)
+{
+    // the luna main loop of the service runs the default context
+    g_main_context_invoke_full(
+        nullptr, G_PRIORITY_DEFAULT,
+        +[](gpointer data) -> gboolean
+        {
+            (*static_cast<std::function<void()> *>(data))();
+            return G_SOURCE_REMOVE;
+        },
+        new std::function<void()>(std::move(done)),
+        +[](gpointer data) { delete static_cast<std::function<void()> *>(data); });
+}
+
+void RequestDispatcher::run(std::string name, Worker *worker)
+{
+    pthread_setname_np(pthread_self(), name.c_str());
+
+    std::unique_lock<std::mutex> lock(worker->mutex);
+    while (true)
+    {
+        worker->cv.wait(lock, [worker] { return !worker->jobs.empty() || !worker->running; });
+        if (worker->jobs.empty())
+            break;
+
+        std::function<void()> job = std::move(worker->jobs.front());
+        worker->jobs.pop_front();
+        lock.unlock();
+
+        try
+        {
+            job();
+        }
+        catch (const std::exception &e)
+        {
+            PLOGE("%s : request failed %s", name.c_str(), e.what());
+        }
+
+        lock.lock();
+    }
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef SERVICE_REQUEST_DISPATCHER_H_
+#define SERVICE_REQUEST_DISPATCHER_H_
+
+/*-----------------------------------------------------------------------------
+ (File Inclusions)
+ ----------------------------------------------------------------------------*/
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Runs the requests of each camera in order on a worker thread of that camera, so that a slow
+// command of one camera (capture, start) does not hold the luna main loop nor the other cameras.
+// The read-only requests of a camera go to a second worker of that camera, so that they do not
+// wait behind its commands. The results go back to the main loop with complete().
+class RequestDispatcher
+{
+public:
+    static RequestDispatcher &getInstance()
+    {
+        static RequestDispatcher obj;
+        return obj;
+    }
+
+    // Queues job on the worker of the camera deviceid.
+    void dispatch(int deviceid, std::function<void()> job);
+    // Queues job on the query worker of the camera deviceid. job must not send commands to the
+    // HAL of the camera, those stay in order on the worker of dispatch().
+    void dispatchQuery(int deviceid, std::function<void()> job);
+    // Runs done on the main loop, in the order of the calls.
+    static void complete(std::function<void()> done);
+
+private:
+    struct Worker
+    {
+        std::deque<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool running{true};
+        std::thread thread;
+    };
+
+    RequestDispatcher() {}
+    ~RequestDispatcher();
+
+    void queue(std::map<int, std::unique_ptr<Worker>> &workers, const std::string &name,
+               int deviceid, std::function<void()> job);
+    static void run(std::string name, Worker *worker);
+
+    std::map<int, std::unique_ptr<Worker>> workers_;
+    std::map<int, std::unique_ptr<Worker>> queryWorkers_;
+    std::mutex mutex_;
+};
+
+#endif /* SERVICE_REQUEST_DISPATCHER_H_ */
@@ -23,7 +23,9 @@
 #include "camera_constants.h"
 #include "command_manager.h"
 #include "device_manager.h"
+#include "hal_command_channel.h"
 #include "preview_display_control.h"
+#include <unistd.h>
 
 VirtualDeviceManager::VirtualDeviceManager()
     : virtualhandle_map_(), handlepriority_map_(), bcaptureinprogress_(false), sformat_()
@@ -31,7 +33,12 @@ VirtualDeviceManager::VirtualDeviceManager()
     PLOGI("");
 }
 
-VirtualDeviceManager::~VirtualDeviceManager() { PLOGI(""); }
+VirtualDeviceManager::~VirtualDeviceManager()
+{
+    PLOGI("");
+    for (auto &it : signalfd_map_)
+        ::close(it.second);
+}
 
 bool VirtualDeviceManager::checkDeviceOpen(int devhandle)
 {
@@ -125,11 +132,8 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::openDevice(int devid, int *devhandle)
     return ret;
 }
 
-DEVICE_RETURN_CODE_T VirtualDeviceManager::open(int devid, int *devhandle, std::string appId,
-                                                std::string apppriority)
+DEVICE_RETURN_CODE_T VirtualDeviceManager::checkAppPriority(std::string &apppriority)
 {
-    PLOGI("deviceid : %d \n", devid);
-
     // check if priortiy is not set by user
     if (cstr_empty == apppriority)
     {
@@ -152,6 +156,17 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::open(int devid, int *devhandle, std::
             return DEVICE_ERROR_ALREADY_OEPENED_PRIMARY_DEVICE;
         }
     }
+    return DEVICE_OK;
+}
+
+DEVICE_RETURN_CODE_T VirtualDeviceManager::open(int devid, int *devhandle, std::string appId,
+                                                std::string apppriority)
+{
+    PLOGI("deviceid : %d \n", devid);
+
+    DEVICE_RETURN_CODE_T ret = checkAppPriority(apppriority);
+    if (DEVICE_OK != ret)
+        return ret;
 
     // check if camera device requested to open is valid
     if (!DeviceManager::getInstance().isDeviceValid(devid))
@@ -173,7 +188,7 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::open(int devid, int *devhandle, std::
     }
 
     // open the actual device
-    DEVICE_RETURN_CODE_T ret = openDevice(devid, devhandle);
+    ret = openDevice(devid, devhandle);
     if (DEVICE_OK == ret)
     {
         // add handle with priority to map
@@ -182,6 +197,145 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::open(int devid, int *devhandle, std::
     return ret;
 }
 
+DEVICE_RETURN_CODE_T VirtualDeviceManager::openStreamDevice(int devid, int *devhandle,
+                                                            const std::string &apppriority,
+                                                            CAMERA_FORMAT sformat, LSHandle *sh,
+                                                            const std::string &memtype,
+                                                            int *shmfd, std::string &step)
+{
+    std::string deviceType   = DeviceManager::getInstance().getDeviceType(devid);
+    DEVICE_RETURN_CODE_T ret = objcamerahalproxy_.createHal(std::move(deviceType));
+    if (DEVICE_OK != ret)
+    {
+        PLOGI("Failed to create handle\n");
+        return DEVICE_ERROR_CAN_NOT_OPEN;
+    }
+
+    std::string devnode;
+    DeviceManager::getInstance().getDeviceNode(devid, devnode);
+    std::string payload = "";
+    DeviceManager::getInstance().getDeviceUserData(devid, payload);
+
+    *devhandle = getVirtualDeviceHandle(devid);
+    handlepriority_map_.insert(std::make_pair(*devhandle, apppriority));
+
+    // the user data of the device goes on luna, the HAL is opened step by step then
+    HalCommand halstep = HalCommand::OPEN;
+    int signalfd       = -1;
+    if (!payload.empty() ||
+        !objcamerahalproxy_.openStream(devnode, devid, sformat, sh, memtype, *devhandle, &ret,
+                                       &halstep, shmfd, &signalfd))
+    {
+        ret = objcamerahalproxy_.open(std::move(devnode), devid, std::move(payload));
+        if (DEVICE_OK != ret)
+        {
+            PLOGI("Failed to open device\n");
+            removeVirtualDeviceHandle(*devhandle);
+            removeHandlePriorityObj(*devhandle);
+            return ret;
+        }
+        DeviceManager::getInstance().setDeviceStatus(devid, TRUE);
+
+        ret = startStream(*devhandle, sformat, sh, memtype, shmfd, step);
+        if (DEVICE_OK != ret)
+            close(*devhandle);
+        return ret;
+    }
+
+    if (DEVICE_OK != ret)
+    {
+        // the HAL has undone the steps before the failed one, the proxy has closed the device
+        // if the HAL did not answer in time
+        PLOGE("openStream error : %d at command %d", ret, static_cast<int>(halstep));
+        if (halstep == HalCommand::SET_FORMAT)
+            step = "setFormat";
+        else if (halstep == HalCommand::START_PREVIEW || halstep == HalCommand::ADD_CLIENT)
+            step = "startCamera";
+        else if (halstep == HalCommand::GET_FD)
+            step = "getFd";
+        removeVirtualDeviceHandle(*devhandle);
+        removeHandlePriorityObj(*devhandle);
+        return ret;
+    }
+
+    DeviceManager::getInstance().setDeviceStatus(devid, TRUE);
+    if (sformat.nWidth != 0)
+    {
+        sformat_.eFormat = sformat.eFormat;
+        sformat_.nHeight = sformat.nHeight;
+        sformat_.nWidth  = sformat.nWidth;
+    }
+    memtype_ = memtype;
+    if (signalfd >= 0)
+        signalfd_map_[*devhandle] = signalfd;
+
+    objcamerahalproxy_.subscribe();
+    enableAddonSolutions(devid);
+
+    nstreaminghandle_.push_back(*devhandle);
+    virtualhandle_map_[*devhandle].ecamstate_ = CameraDeviceState::CAM_DEVICE_STATE_STREAMING;
+    return DEVICE_OK;
+}
+
+DEVICE_RETURN_CODE_T VirtualDeviceManager::startStream(int devhandle, CAMERA_FORMAT sformat,
+                                                       LSHandle *sh, const std::string &memtype,
+                                                       int *shmfd, std::string &step)
+{
+    DEVICE_RETURN_CODE_T ret = DEVICE_OK;
+    if (sformat.nWidth != 0)
+    {
+        step = "setFormat";
+        ret  = setFormat(devhandle, sformat);
+    }
+    if (DEVICE_OK == ret)
+    {
+        step = "startCamera";
+        ret  = startCamera(devhandle, sh, memtype);
+        if (DEVICE_OK == ret && memtype == cstr_shmem)
+        {
+            // the dmabuf fds are per buffer, the client asks for them with getFd
+            step = "getFd";
+            ret  = getFd(devhandle, "buffer", 0, shmfd);
+            if (DEVICE_OK != ret)
+                stopCamera(devhandle);
+        }
+    }
+    return ret;
+}
+
+DEVICE_RETURN_CODE_T VirtualDeviceManager::openStream(int devid, int *devhandle, std::string appId,
+                                                      std::string apppriority,
+                                                      CAMERA_FORMAT sformat, LSHandle *sh,
+                                                      const std::string &memtype, int *shmfd,
+                                                      std::string &step)
+{
+    PLOGI("deviceid : %d, memtype : %s\n", devid, memtype.c_str());
+
+    step                     = "open";
+    DEVICE_RETURN_CODE_T ret = checkAppPriority(apppriority);
+    if (DEVICE_OK != ret)
+        return ret;
+
+    if (!DeviceManager::getInstance().isDeviceValid(devid))
+    {
+        PLOGI("Device is invalid\n");
+        return DEVICE_ERROR_NODEVICE;
+    }
+
+    // the first client brings the device up with one HAL command if it can
+    if (!DeviceManager::getInstance().isDeviceOpen(devid))
+        return openStreamDevice(devid, devhandle, apppriority, sformat, sh, memtype, shmfd, step);
+
+    *devhandle = getVirtualDeviceHandle(devid);
+    PLOGI("Device is already opened! Handle : %d \n", *devhandle);
+    handlepriority_map_.insert(std::make_pair(*devhandle, apppriority));
+
+    ret = startStream(*devhandle, sformat, sh, memtype, shmfd, step);
+    if (DEVICE_OK != ret)
+        close(*devhandle);
+    return ret;
+}
+
 DEVICE_RETURN_CODE_T VirtualDeviceManager::close(int devhandle)
 {
     PLOGI("devhandle : %d \n", devhandle);
@@ -256,9 +410,10 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::close(int devhandle)
     return ret;
 }
 
-DEVICE_RETURN_CODE_T VirtualDeviceManager::startCamera(int devhandle, LSHandle *sh)
+DEVICE_RETURN_CODE_T VirtualDeviceManager::startCamera(int devhandle, LSHandle *sh,
+                                                       const std::string &memtype)
 {
-    PLOGI("devhandle : %d \n", devhandle);
+    PLOGI("devhandle : %d memtype : %s\n", devhandle, memtype.c_str());
 
     // Get device id for virtual device handle
     DeviceStateMap obj_devstate = virtualhandle_map_[devhandle];
@@ -285,12 +440,13 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::startCamera(int devhandle, LSHandle *
     if (streaming_handle_size == 0) // Primary
     {
         // start preview
-        DEVICE_RETURN_CODE_T ret = objcamerahalproxy_.startPreview(sh);
+        DEVICE_RETURN_CODE_T ret = objcamerahalproxy_.startPreview(sh, memtype);
         if (DEVICE_OK != ret)
         {
             PLOGE("startPreview error : %d", ret);
             return ret;
         }
+        memtype_ = memtype;
 
         // add client
         ret = objcamerahalproxy_.addClient(devhandle);
@@ -302,19 +458,18 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::startCamera(int devhandle, LSHandle *
         }
 
         objcamerahalproxy_.subscribe();
-
-        // Apply platform-specific policy to solutions if exists.
-        if (pAddon_ && pAddon_->hasImplementation())
-        {
-            std::string deviceKey       = DeviceManager::getInstance().getDeviceKey(deviceid);
-            DEVICE_RETURN_CODE_T result = objcamerahalproxy_.enableCameraSolution(
-                pAddon_->getEnabledSolutionList(std::move(deviceKey)));
-            PLOGI("Enable camera solution : %d", result);
-        }
+        enableAddonSolutions(deviceid);
     }
     else
     {
         PLOGI("streaming or preview already started by other app \n");
+        // the buffer of the running stream is shared, a client can not have another type
+        if (memtype != memtype_)
+        {
+            PLOGE("stream is running in %s mode, requested %s", memtype_.c_str(),
+                  memtype.c_str());
+            return DEVICE_ERROR_WRONG_PARAM;
+        }
 
         DEVICE_RETURN_CODE_T ret = DEVICE_OK;
 
@@ -338,6 +493,28 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::startCamera(int devhandle, LSHandle *
     return DEVICE_OK;
 }
 
+void VirtualDeviceManager::enableAddonSolutions(int deviceid)
+{
+    // Apply platform-specific policy to solutions if exists.
+    if (pAddon_ && pAddon_->hasImplementation())
+    {
+        std::string deviceKey       = DeviceManager::getInstance().getDeviceKey(deviceid);
+        DEVICE_RETURN_CODE_T result = objcamerahalproxy_.enableCameraSolution(
+            pAddon_->getEnabledSolutionList(std::move(deviceKey)));
+        PLOGI("Enable camera solution : %d", result);
+    }
+}
+
+void VirtualDeviceManager::closeSignalFd(int devhandle)
+{
+    auto it = signalfd_map_.find(devhandle);
+    if (it != signalfd_map_.end())
+    {
+        ::close(it->second);
+        signalfd_map_.erase(it);
+    }
+}
+
 DEVICE_RETURN_CODE_T VirtualDeviceManager::stopCamera(int devhandle, bool forceComplete)
 {
     PLOGI("devhandle : %d \n", devhandle);
@@ -414,6 +591,7 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::stopCamera(int devhandle, bool forceC
 
     // remove the handle from vector since stopCamera is called
     nstreaminghandle_.erase(position);
+    closeSignalFd(devhandle);
 
     // update state of device to open
     obj_devstate.ecamstate_       = CameraDeviceState::CAM_DEVICE_STATE_OPEN;
@@ -593,7 +771,8 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::startCapture(int devhandle, CAMERA_FO
         return singleCapture(devhandle, sformat, imagepath, mode, ncount);
 }
 
-DEVICE_RETURN_CODE_T VirtualDeviceManager::stopCapture(int devhandle, bool request)
+DEVICE_RETURN_CODE_T VirtualDeviceManager::stopCapture(int devhandle, bool request,
+                                                       CAPTURE_STATS_T *pStats)
 {
     PLOGI("devhandle : %d\n", devhandle);
 
@@ -631,7 +810,7 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::stopCapture(int devhandle, bool reque
     {
         // stop capture
         if (request)
-            ret = objcamerahalproxy_.stopCapture(devhandle);
+            ret = objcamerahalproxy_.stopCapture(devhandle, pStats);
 
         // reset capture parameters for camera device
         if (DEVICE_OK == ret)
@@ -648,7 +827,8 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::stopCapture(int devhandle, bool reque
 
 DEVICE_RETURN_CODE_T VirtualDeviceManager::capture(int devhandle, int ncount,
                                                    const std::string &imagepath,
-                                                   std::vector<std::string> &capturedFiles)
+                                                   std::vector<std::string> &capturedFiles,
+                                                   CAPTURE_STATS_T *pStats)
 {
     PLOGI("devhandle : %d ncount : %d \n", devhandle, ncount);
 
@@ -667,7 +847,7 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::capture(int devhandle, int ncount,
         }
 
         // capture number of images specified by ncount
-        return objcamerahalproxy_.capture(ncount, imagepath, capturedFiles);
+        return objcamerahalproxy_.capture(ncount, imagepath, capturedFiles, pStats);
     }
     else
     {
@@ -699,7 +879,8 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::getProperty(int devhandle,
     }
 }
 
-DEVICE_RETURN_CODE_T VirtualDeviceManager::setProperty(int devhandle, CAMERA_PROPERTIES_T *oInfo)
+DEVICE_RETURN_CODE_T VirtualDeviceManager::setProperty(int devhandle, CAMERA_PROPERTIES_T *oInfo,
+                                                       CAMERA_PROPERTIES_T *failed)
 {
     PLOGI("devhandle : %d\n", devhandle);
 
@@ -725,7 +906,7 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::setProperty(int devhandle, CAMERA_PRO
     if (DeviceManager::getInstance().isDeviceOpen(deviceid))
     {
         // set device properties
-        DEVICE_RETURN_CODE_T ret = objcamerahalproxy_.setDeviceProperty(oInfo);
+        DEVICE_RETURN_CODE_T ret = objcamerahalproxy_.setDeviceProperty(oInfo, failed);
         return ret;
     }
     else
@@ -798,7 +979,19 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::getFormat(int devhandle, CAMERA_FORMA
     }
 }
 
-DEVICE_RETURN_CODE_T VirtualDeviceManager::getFd(int devhandle, const std::string &type, int *shmfd)
+bool VirtualDeviceManager::getCachedFormat(CAMERA_FORMAT *oformat)
+{
+    // the proxy drops the cache when the device is closed
+    return objcamerahalproxy_.getCachedFormat(oformat);
+}
+
+bool VirtualDeviceManager::getCachedProperty(CAMERA_PROPERTIES_T *devproperty)
+{
+    return objcamerahalproxy_.getCachedDeviceProperty(devproperty);
+}
+
+DEVICE_RETURN_CODE_T VirtualDeviceManager::getFd(int devhandle, const std::string &type, int index,
+                                                 int *shmfd)
 {
     PLOGI("devhandle : %d\n", devhandle);
 
@@ -806,7 +999,17 @@ DEVICE_RETURN_CODE_T VirtualDeviceManager::getFd(int devhandle, const std::strin
 
     if (obj_devstate.ecamstate_ >= CameraDeviceState::CAM_DEVICE_STATE_OPEN)
     {
-        DEVICE_RETURN_CODE_T ret = objcamerahalproxy_.getFd(type, devhandle, shmfd);
+        // openStream has brought the signal fd along already
+        auto it = signalfd_map_.find(devhandle);
+        if (type == "signal" && it != signalfd_map_.end())
+        {
+            *shmfd = it->second;
+            signalfd_map_.erase(it);
+            PLOGI("signal fd of openStream : %d\n", *shmfd);
+            return DEVICE_OK;
+        }
+
+        DEVICE_RETURN_CODE_T ret = objcamerahalproxy_.getFd(type, devhandle, shmfd, index);
         if (ret == DEVICE_OK)
         {
             PLOGI("shared memory fd is : %d\n", *shmfd);
@@ -845,7 +1048,8 @@ VirtualDeviceManager::getSupportedCameraSolutionInfo(int devhandle,
 
 DEVICE_RETURN_CODE_T
 VirtualDeviceManager::getEnabledCameraSolutionInfo(int devhandle,
-                                                   std::vector<std::string> &solutionsInfo)
+                                                   std::vector<std::string> &solutionsInfo,
+                                                   std::vector<solution_status_t> *pStatus)
 {
     // get device id for virtual device handle
     DeviceStateMap obj_devstate = virtualhandle_map_[devhandle];
@@ -855,7 +1059,8 @@ VirtualDeviceManager::getEnabledCameraSolutionInfo(int devhandle,
     if (DeviceManager::getInstance().isDeviceOpen(deviceid))
     {
         // get enabled solutions of device opened
-        DEVICE_RETURN_CODE_T ret = objcamerahalproxy_.getEnabledCameraSolutionInfo(solutionsInfo);
+        DEVICE_RETURN_CODE_T ret =
+            objcamerahalproxy_.getEnabledCameraSolutionInfo(solutionsInfo, pStatus);
         return ret;
     }
     else
@@ -866,7 +1071,9 @@ VirtualDeviceManager::getEnabledCameraSolutionInfo(int devhandle,
 }
 
 DEVICE_RETURN_CODE_T
-VirtualDeviceManager::enableCameraSolution(int devhandle, const std::vector<std::string> &solutions)
+VirtualDeviceManager::enableCameraSolution(
+    int devhandle, const std::vector<std::string> &solutions,
+    const std::map<std::string, solution_schedule_t> &schedules)
 {
     PLOGI("VirtualDeviceManager enableCameraSolutionInfo E\n");
 
@@ -878,7 +1085,7 @@ VirtualDeviceManager::enableCameraSolution(int devhandle, const std::vector<std:
     if (DeviceManager::getInstance().isDeviceOpen(deviceid))
     {
         // get enabled solutions of device opened
-        DEVICE_RETURN_CODE_T ret = objcamerahalproxy_.enableCameraSolution(solutions);
+        DEVICE_RETURN_CODE_T ret = objcamerahalproxy_.enableCameraSolution(solutions, schedules);
         if (ret == DEVICE_OK)
         {
             // Attach platform-specific private component to device in order to enforce
@@ -45,6 +45,9 @@ private:
     std::vector<int> nstreaminghandle_;
     std::vector<int> ncapturehandle_;
     CAMERA_FORMAT sformat_;
+    std::string memtype_{cstr_shmem};
+    // signal fds of openStream, handed out by the next getFd of the handle
+    std::map<int, int> signalfd_map_;
 
     // for render preview
     std::vector<std::unique_ptr<PreviewDisplayControl>> previewDisplayControls;
@@ -61,6 +64,13 @@ private:
     void removeHandlePriorityObj(int);
     void updateFormat(CAMERA_FORMAT &, int);
     DEVICE_RETURN_CODE_T openDevice(int, int *);
+    DEVICE_RETURN_CODE_T checkAppPriority(std::string &);
+    DEVICE_RETURN_CODE_T openStreamDevice(int, int *, const std::string &, CAMERA_FORMAT,
+                                          LSHandle *, const std::string &, int *, std::string &);
+    DEVICE_RETURN_CODE_T startStream(int, CAMERA_FORMAT, LSHandle *, const std::string &, int *,
+                                     std::string &);
+    void enableAddonSolutions(int);
+    void closeSignalFd(int);
     DEVICE_RETURN_CODE_T singleCapture(int, CAMERA_FORMAT, const std::string &, const std::string &,
                                        int);
     DEVICE_RETURN_CODE_T continuousCapture(int, CAMERA_FORMAT, const std::string &);
@@ -72,23 +82,31 @@ public:
     ~VirtualDeviceManager();
     DEVICE_RETURN_CODE_T open(int, int *, std::string, std::string);
     DEVICE_RETURN_CODE_T close(int);
-    DEVICE_RETURN_CODE_T startCamera(int, LSHandle *);
+    DEVICE_RETURN_CODE_T openStream(int, int *, std::string, std::string, CAMERA_FORMAT,
+                                    LSHandle *, const std::string &, int *, std::string &);
+    DEVICE_RETURN_CODE_T startCamera(int, LSHandle *, const std::string &memtype = cstr_shmem);
     DEVICE_RETURN_CODE_T stopCamera(int, bool forceComplete = false);
     DEVICE_RETURN_CODE_T startPreview(int, std::string, LSHandle *);
     DEVICE_RETURN_CODE_T stopPreview(int, bool forceComplete = false);
     DEVICE_RETURN_CODE_T startCapture(int, CAMERA_FORMAT, const std::string &, const std::string &,
                                       int);
-    DEVICE_RETURN_CODE_T stopCapture(int, bool request = true);
-    DEVICE_RETURN_CODE_T capture(int, int, const std::string &, std::vector<std::string> &);
+    DEVICE_RETURN_CODE_T stopCapture(int, bool request = true, CAPTURE_STATS_T *pStats = nullptr);
+    DEVICE_RETURN_CODE_T capture(int, int, const std::string &, std::vector<std::string> &,
+                                 CAPTURE_STATS_T *pStats = nullptr);
     DEVICE_RETURN_CODE_T getProperty(int, CAMERA_PROPERTIES_T *);
-    DEVICE_RETURN_CODE_T setProperty(int, CAMERA_PROPERTIES_T *);
+    DEVICE_RETURN_CODE_T setProperty(int, CAMERA_PROPERTIES_T *,
+                                     CAMERA_PROPERTIES_T *failed = nullptr);
     DEVICE_RETURN_CODE_T setFormat(int, CAMERA_FORMAT);
     DEVICE_RETURN_CODE_T getFormat(int, CAMERA_FORMAT *);
-    DEVICE_RETURN_CODE_T getFd(int, const std::string &, int *);
+    bool getCachedFormat(CAMERA_FORMAT *);
+    bool getCachedProperty(CAMERA_PROPERTIES_T *);
+    DEVICE_RETURN_CODE_T getFd(int, const std::string &, int, int *);
 
     DEVICE_RETURN_CODE_T getSupportedCameraSolutionInfo(int, std::vector<std::string> &);
-    DEVICE_RETURN_CODE_T getEnabledCameraSolutionInfo(int, std::vector<std::string> &);
-    DEVICE_RETURN_CODE_T enableCameraSolution(int, const std::vector<std::string> &);
+    DEVICE_RETURN_CODE_T getEnabledCameraSolutionInfo(int, std::vector<std::string> &,
+                                                      std::vector<solution_status_t> *pStatus);
+    DEVICE_RETURN_CODE_T enableCameraSolution(int, const std::vector<std::string> &,
+                                              const std::map<std::string, solution_schedule_t> &);
     DEVICE_RETURN_CODE_T disableCameraSolution(int, const std::vector<std::string> &);
 
     void setAddon(std::shared_ptr<AddOn> &addon) { pAddon_ = addon; }
@@ -0,0 +1,249 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/*-----------------------------------------------------------------------------
+ (File Inclusions)
+ ----------------------------------------------------------------------------*/
+#define LOG_TAG "HalCommandChannel"
+#include "hal_command_channel.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+bool HalCommandChannel::send(int sock, const void *msg, size_t size, const int *fds, size_t nfds)
+{
+    struct iovec iov;
+    iov.iov_base = const_cast<void *>(msg);
+    iov.iov_len  = size;
+
+    char control[CMSG_SPACE(sizeof(int) * HAL_REPLY_MAX_FDS)];
+    memset(control, 0, sizeof(control));
+
+    if (nfds > HAL_REPLY_MAX_FDS)
+        nfds = HAL_REPLY_MAX_FDS;
+
+    struct msghdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov    = &iov;
+    hdr.msg_iovlen = 1;
+    if (fds != nullptr && nfds > 0)
+    {
+        hdr.msg_control    = control;
+        hdr.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+        cmsg->cmsg_level     = SOL_SOCKET;
+        cmsg->cmsg_type      = SCM_RIGHTS;
+        cmsg->cmsg_len       = CMSG_LEN(sizeof(int) * nfds);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * nfds);
+    }
+
+    ssize_t n;
+    do
+    {
+        n = sendmsg(sock, &hdr, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+
+    return n == static_cast<ssize_t>(size);
+}
+
+ssize_t HalCommandChannel::receive(int sock, void *msg, size_t size, int *fds, size_t nfds)
+{
+    struct iovec iov;
+    iov.iov_base = msg;
+    iov.iov_len  = size;
+
+    char control[CMSG_SPACE(sizeof(int) * HAL_REPLY_MAX_FDS)];
+
+    struct msghdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov        = &iov;
+    hdr.msg_iovlen     = 1;
+    hdr.msg_control    = control;
+    hdr.msg_controllen = sizeof(control);
+
+    ssize_t n;
+    do
+    {
+        n = recvmsg(sock, &hdr, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+
+    for (size_t i = 0; fds != nullptr && i < nfds; i++)
+        fds[i] = -1;
+
+    size_t count = 0;
+    if (n >= 0)
+    {
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr;
+             cmsg                 = CMSG_NXTHDR(&hdr, cmsg))
+        {
+            if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+                continue;
+
+            size_t received = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < received; i++)
+            {
+                int fd;
+                memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                if (fds != nullptr && count < nfds)
+                    fds[count++] = fd;
+                else
+                    close(fd);
+            }
+        }
+    }
+
+    // a message of another size is not one of ours
+    if (n >= 0 && (hdr.msg_flags & MSG_TRUNC))
+        return -1;
+    return n;
+}
+
+bool HalCommandChannel::sendCommand(int sock, HalCommandMessage &cmd)
+{
+    if (cmd.name.size() > HAL_COMMAND_NAME_MAX || cmd.path.size() > HAL_COMMAND_PATH_MAX)
+    {
+        errno = EMSGSIZE;
+        return false;
+    }
+
+    cmd.nameSize = static_cast<uint32_t>(cmd.name.size());
+    cmd.pathSize = static_cast<uint32_t>(cmd.path.size());
+
+    const HAL_COMMAND_T &header = cmd;
+    std::string msg(reinterpret_cast<const char *>(&header), sizeof(header));
+    msg += cmd.name;
+    msg += cmd.path;
+    return send(sock, msg.data(), msg.size());
+}
+
+bool HalCommandChannel::receiveCommand(int sock, HalCommandMessage *cmd)
+{
+    char msg[sizeof(HAL_COMMAND_T) + HAL_COMMAND_NAME_MAX + HAL_COMMAND_PATH_MAX];
+    ssize_t len = receive(sock, msg, sizeof(msg));
+    if (len < static_cast<ssize_t>(sizeof(HAL_COMMAND_T)))
+        return false;
+
+    HAL_COMMAND_T &header = *cmd;
+    memcpy(&header, msg, sizeof(header));
+    if (cmd->nameSize > HAL_COMMAND_NAME_MAX || cmd->pathSize > HAL_COMMAND_PATH_MAX ||
+        static_cast<size_t>(len) != sizeof(header) + cmd->nameSize + cmd->pathSize)
+    {
+        PLOGE("malformed command of %zd bytes", len);
+        return false;
+    }
+
+    const char *strings = msg + sizeof(header);
+    cmd->name.assign(strings, cmd->nameSize);
+    cmd->path.assign(strings + cmd->nameSize, cmd->pathSize);
+    return true;
+}
+
+static void closeFds(int *fds, size_t nfds)
+{
+    for (size_t i = 0; i < nfds; i++)
+    {
+        if (fds[i] >= 0)
+            close(fds[i]);
+    }
+}
+
+HalCommandClient::HalCommandClient(int sock) : sock_(sock) {}
+
+HalCommandClient::~HalCommandClient()
+{
+    if (sock_ >= 0)
+        close(sock_);
+}
+
+bool HalCommandClient::call(HalCommandMessage &cmd, HAL_REPLY_T *reply, int timeout, int *fds,
+                            size_t nfds)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (sock_ < 0)
+        return false;
+
+    // the channel stays for the next commands, this one goes by luna
+    if (cmd.name.size() > HAL_COMMAND_NAME_MAX || cmd.path.size() > HAL_COMMAND_PATH_MAX)
+    {
+        PLOGW("command %d does not fit the channel", static_cast<int>(cmd.command));
+        return false;
+    }
+
+    cmd.seq = ++seq_;
+    if (!HalCommandChannel::sendCommand(sock_, cmd))
+    {
+        PLOGE("channel is broken : %s", strerror(errno));
+        close(sock_);
+        sock_ = -1;
+        return false;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    while (true)
+    {
+        auto remain = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          deadline - std::chrono::steady_clock::now())
+                          .count();
+        struct pollfd pfd = {sock_, POLLIN, 0};
+        int n             = poll(&pfd, 1, remain > 0 ? static_cast<int>(remain) : 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n == 0)
+        {
+            // the late reply is dropped by its seq
+            PLOGE("command %d timed out", static_cast<int>(cmd.command));
+            reply->ret = DEVICE_ERROR_TIMEOUT;
+            return true;
+        }
+
+        HAL_REPLY_T r;
+        // receive() is skipped when poll() fails, no fd is left unset
+        int rfds[HAL_REPLY_MAX_FDS] = {-1, -1};
+        ssize_t len =
+            (n > 0) ? HalCommandChannel::receive(sock_, &r, sizeof(r), rfds, HAL_REPLY_MAX_FDS) : -1;
+        if (len != static_cast<ssize_t>(sizeof(r)))
+        {
+            PLOGE("channel is closed : %s", len < 0 ? strerror(errno) : "no reply");
+            // a truncated message has its fds received already
+            closeFds(rfds, HAL_REPLY_MAX_FDS);
+            close(sock_);
+            sock_      = -1;
+            reply->ret = DEVICE_ERROR_UNKNOWN;
+            return true;
+        }
+
+        if (r.seq != cmd.seq)
+        {
+            closeFds(rfds, HAL_REPLY_MAX_FDS);
+            continue;
+        }
+
+        *reply = r;
+        for (size_t i = 0; i < HAL_REPLY_MAX_FDS; i++)
+        {
+            if (fds != nullptr && i < nfds)
+                fds[i] = rfds[i];
+            else if (rfds[i] >= 0)
+                close(rfds[i]);
+        }
+        return true;
+    }
+}
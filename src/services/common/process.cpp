@@ -17,6 +17,7 @@
 #define LOG_TAG "Process"
 #include "process.h"
 #include "camera_log.h"
+#include <csignal>
 #include <iterator>
 #include <sstream>
 #include <sys/wait.h>
@@ -60,12 +61,41 @@ void Process::start(const std::string &cmd)
         _exit(0);
     }
 }
+void Process::terminate()
+{
+    PLOGI("pid %d", _pid);
+
+    // the pid of a reaped process may belong to another one already
+    if (_pid > 0 && !_exited && kill(_pid, SIGTERM) != 0)
+    {
+        PLOGE("kill error : %d", errno);
+    }
+}
+
+bool Process::isRunning()
+{
+    if (_exited || _pid <= 0)
+        return false;
+
+    int status    = 0;
+    pid_t waitPid = waitpid(_pid, &status, WNOHANG);
+    if (waitPid == 0)
+        return true;
+
+    PLOGW("pid %d has exited, status 0x%x", _pid, status);
+    _exited = true;
+    return false;
+}
+
 void Process::stop()
 {
     PLOGI("pid %d", _pid);
+    if (_exited)
+        return;
 
+    // only this child, the others are reaped by their own Process
     int status    = 0;
-    pid_t waitPid = wait(&status);
+    pid_t waitPid = waitpid(_pid, &status, 0);
     if (waitPid == -1)
     {
         PLOGE("error : %d", errno);
@@ -17,15 +17,24 @@
 #include "camera_hal_service.h"
 #include "camera_types.h"
 #include "device_controller.h"
+#include "hal_command_channel.h"
+#include <algorithm>
+#include <cstring>
+#include <glib-unix.h>
 #include <pbnjson.hpp>
+#include <pthread.h>
 #include <string>
+#include <sys/socket.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
 
 const char *const SUBSCRIPTION_KEY = "cameraHal";
 
-CameraHalService::CameraHalService(const char *service_name)
-    : LS::Handle(LS::registerService(service_name))
+CameraHalService::CameraHalService(const char *service_name, bool infoWorker)
+    : LS::Handle(LS::registerService(service_name)), infoWorker_(infoWorker)
 {
-    PLOGI("Start : %s", service_name);
+    PLOGI("Start : %s%s", service_name, infoWorker ? " (device info worker)" : "");
 
     LS_CATEGORY_BEGIN(CameraHalService, "/")
     LS_CATEGORY_METHOD(createHal)
@@ -50,15 +59,49 @@ CameraHalService::CameraHalService(const char *service_name)
     LS_CATEGORY_METHOD(enableCameraSolution)
     LS_CATEGORY_METHOD(disableCameraSolution)
     LS_CATEGORY_METHOD(subscribe)
+    LS_CATEGORY_METHOD(openChannel)
     LS_CATEGORY_END;
 
     // attach to mainloop and run it
     attachToLoop(main_loop_ptr_.get());
 
+    if (infoWorker_)
+    {
+        // the queries of the cameras are answered side by side
+        for (int i = 0; i < INFO_WORKER_THREADS; i++)
+        {
+            try
+            {
+                infoThreads_.emplace_back([this]() { runInfoQueries(); });
+            }
+            catch (const std::system_error &e)
+            {
+                PLOGE("Caught a system_error with code %d meaning %s", e.code().value(),
+                      e.what());
+                break;
+            }
+        }
+    }
+
     // run the gmainloop
     g_main_loop_run(main_loop_ptr_.get());
 }
 
+CameraHalService::~CameraHalService()
+{
+    {
+        std::lock_guard<std::mutex> lock(infoMutex_);
+        infoStop_ = true;
+    }
+    infoCond_.notify_all();
+    for (auto &thread : infoThreads_)
+    {
+        if (thread.joinable())
+            thread.join();
+    }
+    closeChannel();
+}
+
 bool CameraHalService::createHal(LSMessage &message)
 {
     std::string device_type;
@@ -221,7 +264,14 @@ bool CameraHalService::startPreview(LSMessage &message)
 
     pbnjson::JValue parsed = pbnjson::JDomParser::fromString(payload);
 
-    DEVICE_RETURN_CODE_T ret = pDeviceControl->startPreview(this->get(), SUBSCRIPTION_KEY);
+    std::string memtype = cstr_shmem;
+    if (parsed.hasKey(CONST_PARAM_NAME_MEMTYPE))
+    {
+        memtype = parsed[CONST_PARAM_NAME_MEMTYPE].asString();
+    }
+
+    DEVICE_RETURN_CODE_T ret =
+        pDeviceControl->startPreview(this->get(), SUBSCRIPTION_KEY, memtype);
     if (ret == DEVICE_OK)
     {
         jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_RETURNVALUE),
@@ -350,16 +400,35 @@ bool CameraHalService::startCapture(LSMessage &message)
     return true;
 }
 
+static jvalue_ref createCaptureStatsJson(const CAPTURE_STATS_T &stats)
+{
+    jvalue_ref json_stats = jobject_create();
+    jobject_put(json_stats, J_CSTR_TO_JVAL(CONST_PARAM_NAME_FRAMES),
+                jnumber_create_i64(stats.frames));
+    jobject_put(json_stats, J_CSTR_TO_JVAL(CONST_PARAM_NAME_DROPPED),
+                jnumber_create_i64(stats.dropped));
+    jobject_put(json_stats, J_CSTR_TO_JVAL(CONST_PARAM_NAME_BYTES),
+                jnumber_create_i64(stats.bytes));
+    jobject_put(json_stats, J_CSTR_TO_JVAL(CONST_PARAM_NAME_MAX_QUEUE_DEPTH),
+                jnumber_create_i64(stats.maxQueueDepth));
+    jobject_put(json_stats, J_CSTR_TO_JVAL(CONST_PARAM_NAME_THROUGHPUT),
+                jnumber_create_i64(stats.throughputKBps));
+    return json_stats;
+}
+
 bool CameraHalService::stopCapture(LSMessage &message)
 {
     jvalue_ref json_outobj = jobject_create();
     auto *payload          = LSMessageGetPayload(&message);
     PLOGI("payload %s", payload);
 
-    DEVICE_RETURN_CODE_T ret = pDeviceControl->stopCapture();
+    CAPTURE_STATS_T stats    = {0};
+    DEVICE_RETURN_CODE_T ret = pDeviceControl->stopCapture(&stats);
 
     if (ret == DEVICE_OK)
     {
+        jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_CAPTURE_STATS),
+                    createCaptureStatsJson(stats));
         jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_RETURNVALUE),
                     jboolean_create(true));
     }
@@ -400,7 +469,8 @@ bool CameraHalService::capture(LSMessage &message)
     }
 
     std::vector<std::string> capturedFiles;
-    DEVICE_RETURN_CODE_T ret = pDeviceControl->capture(ncount, imagepath, capturedFiles);
+    CAPTURE_STATS_T stats    = {0};
+    DEVICE_RETURN_CODE_T ret = pDeviceControl->capture(ncount, imagepath, capturedFiles, &stats);
 
     if (ret == DEVICE_OK)
     {
@@ -411,6 +481,9 @@ bool CameraHalService::capture(LSMessage &message)
         }
         jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_IMAGE_PATH),
                     json_file_names_array);
+
+        jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_CAPTURE_STATS),
+                    createCaptureStatsJson(stats));
         jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_RETURNVALUE),
                     jboolean_create(true));
     }
@@ -502,12 +575,22 @@ bool CameraHalService::setDeviceProperty(LSMessage &message)
         }
     }
 
-    DEVICE_RETURN_CODE_T ret = pDeviceControl->setDeviceProperty(&inparams);
+    CAMERA_PROPERTIES_T failed;
+    DEVICE_RETURN_CODE_T ret = pDeviceControl->setDeviceProperty(&inparams, &failed);
 
     if (ret == DEVICE_OK)
     {
         jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_RETURNVALUE),
                     jboolean_create(true));
+
+        // the properties the device did not take
+        jvalue_ref json_failed = jarray_create(0);
+        for (int i = 0; i < PROPERTY_END; i++)
+        {
+            if (failed.stGetData.data[i][QUERY_VALUE] != CONST_PARAM_DEFAULT_VALUE)
+                jarray_append(json_failed, jstring_create(getParamString(i).c_str()));
+        }
+        jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_FAILED_PARAMS), json_failed);
     }
     else
     {
@@ -714,6 +797,7 @@ bool CameraHalService::getFd(LSMessage &message)
 {
     int fd;
     int clientId = -1;
+    int index    = 0;
     std::string type;
     jvalue_ref json_outobj = jobject_create();
 
@@ -729,6 +813,10 @@ bool CameraHalService::getFd(LSMessage &message)
     {
         clientId = parsed[CONST_PARAM_NAME_ID].asNumber<int>();
     }
+    if (parsed.hasKey(CONST_PARAM_NAME_INDEX))
+    {
+        index = parsed[CONST_PARAM_NAME_INDEX].asNumber<int>();
+    }
 
     DEVICE_RETURN_CODE_T ret = DEVICE_ERROR_UNKNOWN;
     if (type == "buffer")
@@ -739,6 +827,10 @@ bool CameraHalService::getFd(LSMessage &message)
     {
         ret = pDeviceControl->getShmSignalFd(clientId, &fd);
     }
+    else if (type == cstr_dmabuf)
+    {
+        ret = pDeviceControl->getDmaBufferFd(index, &fd);
+    }
 
     if (ret == DEVICE_OK)
     {
@@ -771,29 +863,11 @@ bool CameraHalService::getFd(LSMessage &message)
     return true;
 }
 
-bool CameraHalService::getDeviceInfo(LSMessage &message)
+static std::string getDeviceInfoReply(std::string strdevicenode, std::string device_type)
 {
-    std::string strdevicenode;
-    std::string device_type;
     camera_device_info_t cameraInfo;
     jvalue_ref json_outobj = jobject_create();
 
-    auto *payload = LSMessageGetPayload(&message);
-    PLOGI("payload %s", payload);
-
-    pbnjson::JValue parsed = pbnjson::JDomParser::fromString(payload);
-
-    if (parsed.hasKey(CONST_PARAM_NAME_DEVICE_PATH))
-    {
-        strdevicenode = parsed[CONST_PARAM_NAME_DEVICE_PATH].asString();
-    }
-
-    if (parsed.hasKey(CONST_PARAM_NAME_SUBSYSTEM))
-    {
-        device_type = parsed[CONST_PARAM_NAME_SUBSYSTEM].asString();
-    }
-    PLOGI("device_type(%s)", device_type.c_str());
-
     DEVICE_RETURN_CODE_T ret =
         DeviceControl::getDeviceInfo(std::move(strdevicenode), std::move(device_type), &cameraInfo);
     if (ret == DEVICE_OK)
@@ -830,16 +904,86 @@ bool CameraHalService::getDeviceInfo(LSMessage &message)
                     jnumber_create_i32(static_cast<int32_t>(ret)));
     }
 
-    LS::Message request(&message);
-    request.respond(jvalue_stringify(json_outobj));
-    PLOGI("response message : %s", jvalue_stringify(json_outobj));
+    std::string reply = jvalue_stringify(json_outobj);
+    PLOGI("response message : %s", reply.c_str());
 
     j_release(&json_outobj);
+    return reply;
+}
 
-    g_main_loop_quit(main_loop_ptr_.get());
+bool CameraHalService::getDeviceInfo(LSMessage &message)
+{
+    std::string strdevicenode;
+    std::string device_type;
+
+    auto *payload = LSMessageGetPayload(&message);
+    PLOGI("payload %s", payload);
+
+    pbnjson::JValue parsed = pbnjson::JDomParser::fromString(payload);
+
+    if (parsed.hasKey(CONST_PARAM_NAME_DEVICE_PATH))
+    {
+        strdevicenode = parsed[CONST_PARAM_NAME_DEVICE_PATH].asString();
+    }
+
+    if (parsed.hasKey(CONST_PARAM_NAME_SUBSYSTEM))
+    {
+        device_type = parsed[CONST_PARAM_NAME_SUBSYSTEM].asString();
+    }
+    PLOGI("device_type(%s)", device_type.c_str());
+
+    LS::Message request(&message);
+    if (infoWorker_ && !infoThreads_.empty())
+    {
+        // the worker stays for the next queries, the main loop keeps serving them meanwhile
+        std::unique_ptr<InfoQuery> query(
+            new InfoQuery{request, std::move(strdevicenode), std::move(device_type), {}});
+        {
+            std::lock_guard<std::mutex> lock(infoMutex_);
+            infoQueries_.push_back(std::move(query));
+        }
+        infoCond_.notify_one();
+        return true;
+    }
+
+    request.respond(getDeviceInfoReply(std::move(strdevicenode), std::move(device_type)).c_str());
+
+    if (!infoWorker_)
+        g_main_loop_quit(main_loop_ptr_.get());
     return true;
 }
 
+void CameraHalService::runInfoQueries()
+{
+    pthread_setname_np(pthread_self(), "device_info");
+
+    std::unique_lock<std::mutex> lock(infoMutex_);
+    while (true)
+    {
+        infoCond_.wait(lock, [this]() { return infoStop_ || !infoQueries_.empty(); });
+        if (infoStop_)
+            break;
+
+        std::unique_ptr<InfoQuery> query = std::move(infoQueries_.front());
+        infoQueries_.pop_front();
+        lock.unlock();
+
+        query->reply = getDeviceInfoReply(query->devicenode, query->deviceType);
+        // the luna handle belongs to the main loop, the reply is sent from there
+        g_main_context_invoke(g_main_loop_get_context(main_loop_ptr_.get()), onInfoReply,
+                              query.release());
+
+        lock.lock();
+    }
+}
+
+gboolean CameraHalService::onInfoReply(gpointer data)
+{
+    std::unique_ptr<InfoQuery> query(static_cast<InfoQuery *>(data));
+    query->request.respond(query->reply.c_str());
+    return G_SOURCE_REMOVE;
+}
+
 bool CameraHalService::getSupportedCameraSolutionInfo(LSMessage &message)
 {
     std::vector<std::string> solutionsInfo;
@@ -897,6 +1041,35 @@ bool CameraHalService::getEnabledCameraSolutionInfo(LSMessage &message)
         }
 
         jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_SOLUTIONS), json_solutions_array);
+
+        // schedule and achieved rate of the running solutions
+        std::vector<solution_status_t> statusList;
+        pDeviceControl->getCameraSolutionStatus(statusList);
+        jvalue_ref json_status_array = jarray_create(0);
+        for (const auto &status : statusList)
+        {
+            jvalue_ref json_statusobj = jobject_create();
+            jobject_put(json_statusobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_NAME),
+                        jstring_create(status.name.c_str()));
+            jobject_put(json_statusobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_FPS),
+                        jnumber_create_f64(status.fps));
+            jobject_put(json_statusobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_LATENCY),
+                        jnumber_create_i32(status.latency_ms));
+            jobject_put(json_statusobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_SKIPPED),
+                        jnumber_create_i64(static_cast<int64_t>(status.skipped)));
+
+            jvalue_ref json_scheduleobj = jobject_create();
+            jobject_put(json_scheduleobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_FPS),
+                        jnumber_create_f64(status.schedule.fps));
+            jobject_put(json_scheduleobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_MAX_LATENCY),
+                        jnumber_create_i32(status.schedule.max_latency_ms));
+            jobject_put(json_scheduleobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_PRIORITY),
+                        jnumber_create_i32(status.schedule.priority));
+            jobject_put(json_statusobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_PARAMS), json_scheduleobj);
+
+            jarray_append(json_status_array, json_statusobj);
+        }
+        jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_STATUS), json_status_array);
         jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_RETURNVALUE),
                     jboolean_create(true));
     }
@@ -940,6 +1113,24 @@ bool CameraHalService::enableCameraSolution(LSMessage &message)
             PLOGI("enable solution list(%s)", name.c_str());
         }
 
+        // optional, applied before the solutions start
+        auto obj_schedules = parsed[CONST_PARAM_NAME_SCHEDULES];
+        long schedsz       = obj_schedules.isArray() ? obj_schedules.arraySize() : 0;
+        for (long i = 0; i < schedsz; i++)
+        {
+            auto obj_schedule = obj_schedules[i];
+            solution_schedule_t schedule;
+            if (obj_schedule.hasKey(CONST_PARAM_NAME_FPS))
+                schedule.fps = obj_schedule[CONST_PARAM_NAME_FPS].asNumber<double>();
+            if (obj_schedule.hasKey(CONST_PARAM_NAME_MAX_LATENCY))
+                schedule.max_latency_ms =
+                    obj_schedule[CONST_PARAM_NAME_MAX_LATENCY].asNumber<int>();
+            if (obj_schedule.hasKey(CONST_PARAM_NAME_PRIORITY))
+                schedule.priority = obj_schedule[CONST_PARAM_NAME_PRIORITY].asNumber<int>();
+            pDeviceControl->setCameraSolutionSchedule(
+                obj_schedule[CONST_PARAM_NAME_NAME].asString(), schedule);
+        }
+
         ret = pDeviceControl->enableCameraSolution(solutionList);
     }
     else
@@ -1044,32 +1235,314 @@ bool CameraHalService::subscribe(LSMessage &message)
     return ret;
 }
 
-std::string parseHalServiceName(int argc, char *argv[]) noexcept
+bool CameraHalService::openChannel(LSMessage &message)
+{
+    jvalue_ref json_outobj = jobject_create();
+    auto *payload          = LSMessageGetPayload(&message);
+    PLOGI("payload %s", payload);
+
+    // one channel per process, a new one replaces the previous one
+    closeChannel();
+
+    DEVICE_RETURN_CODE_T ret = DEVICE_OK;
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == 0)
+    {
+        channelFd_     = sv[0];
+        channelPeerFd_ = sv[1];
+        // on the main loop, the commands run in turn with the luna methods
+        channelSource_ =
+            g_unix_fd_add(channelFd_, static_cast<GIOCondition>(G_IO_IN | G_IO_HUP | G_IO_ERR),
+                          onChannelCommand, this);
+    }
+    else
+    {
+        PLOGE("socketpair failed : %s", strerror(errno));
+        ret = DEVICE_ERROR_UNKNOWN;
+    }
+
+    if (ret == DEVICE_OK)
+    {
+        jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_RETURNVALUE),
+                    jboolean_create(true));
+    }
+    else
+    {
+        jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_RETURNVALUE),
+                    jboolean_create(false));
+        jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_ERROR_CODE),
+                    jnumber_create_i32(static_cast<int32_t>(ret)));
+    }
+
+    LS::Message request(&message);
+    if (ret == DEVICE_OK)
+    {
+        LS::Payload response_payload(jvalue_stringify(json_outobj));
+        response_payload.attachFd(channelPeerFd_);
+        request.respond(std::move(response_payload));
+    }
+    else
+    {
+        request.respond(jvalue_stringify(json_outobj));
+    }
+    PLOGI("response message : %s", jvalue_stringify(json_outobj));
+
+    j_release(&json_outobj);
+
+    return true;
+}
+
+void CameraHalService::closeChannel()
+{
+    if (channelSource_ != 0)
+    {
+        g_source_remove(channelSource_);
+        channelSource_ = 0;
+    }
+    if (channelFd_ >= 0)
+    {
+        ::close(channelFd_);
+        channelFd_ = -1;
+    }
+    if (channelPeerFd_ >= 0)
+    {
+        ::close(channelPeerFd_);
+        channelPeerFd_ = -1;
+    }
+}
+
+gboolean CameraHalService::onChannelCommand(gint fd, GIOCondition condition, gpointer data)
+{
+    CameraHalService *self = static_cast<CameraHalService *>(data);
+
+    HalCommandMessage cmd{};
+    if (!(condition & G_IO_IN) || !HalCommandChannel::receiveCommand(fd, &cmd))
+    {
+        PLOGI("channel is closed");
+        // the source goes away with G_SOURCE_REMOVE
+        self->channelSource_ = 0;
+        self->closeChannel();
+        return G_SOURCE_REMOVE;
+    }
+
+    // the camera service has its end by now
+    if (self->channelPeerFd_ >= 0)
+    {
+        ::close(self->channelPeerFd_);
+        self->channelPeerFd_ = -1;
+    }
+
+    HAL_REPLY_T reply{};
+    reply.seq = cmd.seq;
+    int replyFds[HAL_REPLY_MAX_FDS];
+    std::fill(replyFds, replyFds + HAL_REPLY_MAX_FDS, -1);
+    self->handleCommand(cmd, &reply, replyFds);
+
+    size_t nfds = 0;
+    while (nfds < HAL_REPLY_MAX_FDS && replyFds[nfds] >= 0)
+        nfds++;
+    if (!HalCommandChannel::send(fd, &reply, sizeof(reply), replyFds, nfds))
+    {
+        PLOGE("fail to reply command %d : %s", static_cast<int>(cmd.command), strerror(errno));
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+void CameraHalService::openStream(const HalCommandMessage &cmd, HAL_REPLY_T *reply, int *fds)
+{
+    std::string devicenode = cmd.path;
+    std::string memtype    = cmd.name;
+    if (memtype.empty())
+        memtype = cstr_shmem;
+
+    // all or nothing, a failed step undoes the ones before
+    reply->step = HalCommand::OPEN;
+    reply->ret  = pDeviceControl->open(std::move(devicenode), cmd.value, "");
+    if (reply->ret != DEVICE_OK)
+        return;
+
+    if (cmd.format.nWidth != 0)
+    {
+        CAMERA_FORMAT sformat = cmd.format;
+        if (sformat.eFormat < CAMERA_FORMAT_UNDEFINED || sformat.eFormat > CAMERA_FORMAT_JPEG)
+            sformat.eFormat = CAMERA_FORMAT_UNDEFINED;
+        reply->step = HalCommand::SET_FORMAT;
+        reply->ret  = pDeviceControl->setFormat(sformat);
+        if (reply->ret != DEVICE_OK)
+        {
+            pDeviceControl->close();
+            return;
+        }
+    }
+
+    reply->step = HalCommand::START_PREVIEW;
+    reply->ret  = pDeviceControl->startPreview(this->get(), SUBSCRIPTION_KEY, memtype);
+    if (reply->ret != DEVICE_OK)
+    {
+        pDeviceControl->close();
+        return;
+    }
+
+    reply->step = HalCommand::ADD_CLIENT;
+    reply->ret  = pDeviceControl->addClient(cmd.id);
+    if (reply->ret == DEVICE_OK && memtype == cstr_shmem)
+    {
+        // the dmabuf fds are per buffer, the client asks for them with getFd
+        reply->step = HalCommand::GET_FD;
+        reply->ret  = pDeviceControl->getShmBufferFd(&fds[0]);
+        if (reply->ret == DEVICE_OK)
+            reply->ret = pDeviceControl->getShmSignalFd(cmd.id, &fds[1]);
+        if (reply->ret != DEVICE_OK)
+        {
+            fds[0] = -1;
+            fds[1] = -1;
+            pDeviceControl->removeClient(cmd.id);
+        }
+    }
+    if (reply->ret != DEVICE_OK)
+    {
+        pDeviceControl->stopPreview(true);
+        pDeviceControl->close();
+    }
+}
+
+void CameraHalService::handleCommand(const HalCommandMessage &cmd, HAL_REPLY_T *reply, int *fds)
+{
+    PLOGD("command %d, id %d, value %d", static_cast<int>(cmd.command), cmd.id, cmd.value);
+
+    if (!pDeviceControl)
+    {
+        PLOGE("hal is not created");
+        reply->ret = DEVICE_ERROR_UNKNOWN;
+        return;
+    }
+
+    const std::string &name = cmd.name;
+    switch (cmd.command)
+    {
+    case HalCommand::GET_DEVICE_PROPERTY:
+    {
+        CAMERA_PROPERTIES_T oparams;
+        reply->ret        = pDeviceControl->getDeviceProperty(&oparams);
+        reply->properties = oparams.stGetData;
+        break;
+    }
+    case HalCommand::SET_DEVICE_PROPERTY:
+    {
+        // the values only, as setDeviceProperty of luna
+        CAMERA_PROPERTIES_T inparams;
+        for (int i = 0; i < PROPERTY_END; i++)
+        {
+            inparams.stGetData.data[i][QUERY_VALUE] = cmd.properties.data[i][QUERY_VALUE];
+        }
+        CAMERA_PROPERTIES_T failed;
+        reply->ret        = pDeviceControl->setDeviceProperty(&inparams, &failed);
+        reply->properties = failed.stGetData;
+        break;
+    }
+    case HalCommand::SET_FORMAT:
+    {
+        CAMERA_FORMAT sformat = cmd.format;
+        if (sformat.eFormat < CAMERA_FORMAT_UNDEFINED || sformat.eFormat > CAMERA_FORMAT_JPEG)
+        {
+            PLOGI("eFormat is out of range");
+            sformat.eFormat = CAMERA_FORMAT_UNDEFINED;
+        }
+        reply->ret = pDeviceControl->setFormat(sformat);
+        break;
+    }
+    case HalCommand::GET_FORMAT:
+        reply->ret = pDeviceControl->getFormat(&reply->format);
+        break;
+    case HalCommand::START_PREVIEW:
+        reply->ret = pDeviceControl->startPreview(this->get(), SUBSCRIPTION_KEY,
+                                                  name.empty() ? cstr_shmem : name);
+        break;
+    case HalCommand::STOP_PREVIEW:
+        reply->ret = pDeviceControl->stopPreview(cmd.value != 0);
+        break;
+    case HalCommand::START_CAPTURE:
+    {
+        reply->ret = pDeviceControl->startCapture(cmd.format, cmd.path,
+                                                  name.empty() ? cstr_oneshot : name, cmd.value);
+        break;
+    }
+    case HalCommand::STOP_CAPTURE:
+        reply->ret = pDeviceControl->stopCapture(&reply->captureStats);
+        break;
+    case HalCommand::ADD_CLIENT:
+        reply->ret = pDeviceControl->addClient(cmd.id);
+        break;
+    case HalCommand::REMOVE_CLIENT:
+        reply->ret = pDeviceControl->removeClient(cmd.id);
+        break;
+    case HalCommand::GET_FD:
+    {
+        int n      = -1;
+        reply->ret = DEVICE_ERROR_UNKNOWN;
+        if (name == "buffer")
+        {
+            reply->ret = pDeviceControl->getShmBufferFd(&n);
+        }
+        else if (name == "signal")
+        {
+            reply->ret = pDeviceControl->getShmSignalFd(cmd.id, &n);
+        }
+        else if (name == cstr_dmabuf)
+        {
+            reply->ret = pDeviceControl->getDmaBufferFd(cmd.value, &n);
+        }
+        if (reply->ret == DEVICE_OK)
+            fds[0] = n;
+        break;
+    }
+    case HalCommand::OPEN:
+    {
+        reply->ret = pDeviceControl->open(cmd.path, cmd.value, "");
+        break;
+    }
+    case HalCommand::OPEN_STREAM:
+        openStream(cmd, reply, fds);
+        break;
+    default:
+        PLOGE("unknown command %d", static_cast<int>(cmd.command));
+        reply->ret = DEVICE_ERROR_UNKNOWN;
+        break;
+    }
+
+    PLOGD("command %d : ret %d", static_cast<int>(cmd.command), static_cast<int>(reply->ret));
+}
+
+HalOptions parseHalOptions(int argc, char *argv[]) noexcept
 {
     int c;
-    std::string serviceName;
+    HalOptions options;
 
-    while ((c = getopt(argc, argv, "s:")) != -1)
+    while ((c = getopt(argc, argv, "s:i")) != -1)
     {
         switch (c)
         {
         case 's':
-            serviceName = optarg ? optarg : "";
+            options.serviceName = optarg ? optarg : "";
+            break;
+
+        case 'i':
+            options.infoWorker = true;
             break;
 
         case '?':
-            PLOGI("unknown service name");
+            PLOGI("unknown option");
             break;
 
         default:
             break;
         }
     }
-    if (serviceName.empty())
+    if (options.serviceName.empty())
     {
         PLOGI("service name is not specified");
     }
-    return serviceName;
+    return options;
 }
 
 #include <gst/gst.h>
@@ -1079,12 +1552,12 @@ int main(int argc, char *argv[])
     {
         gst_init(NULL, NULL);
 
-        std::string serviceName = parseHalServiceName(argc, argv);
-        if (serviceName.empty())
+        HalOptions options = parseHalOptions(argc, argv);
+        if (options.serviceName.empty())
         {
             return 1;
         }
-        CameraHalService cameraHalServiceInstance(serviceName.c_str());
+        CameraHalService cameraHalServiceInstance(options.serviceName.c_str(), options.infoWorker);
     }
     catch (LS::Error &err)
     {
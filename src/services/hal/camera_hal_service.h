@@ -16,18 +16,59 @@
 #pragma once
 
 #include "luna-service2/lunaservice.hpp"
+#include <condition_variable>
+#include <deque>
 #include <glib.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// threads of the device info worker, a slow camera holds one of them
+#define INFO_WORKER_THREADS 3
 
 class DeviceControl;
+struct HalCommandMessage;
+struct HAL_REPLY_T;
 class CameraHalService : public LS::Handle
 {
     using mainloop          = std::unique_ptr<GMainLoop, void (*)(GMainLoop *)>;
     mainloop main_loop_ptr_ = {g_main_loop_new(nullptr, false), g_main_loop_unref};
 
     std::unique_ptr<DeviceControl> pDeviceControl;
+    // started with -i : answers getDeviceInfo only, for as long as the camera service runs
+    bool infoWorker_{false};
+
+    // queries of the worker, answered by INFO_WORKER_THREADS threads and replied from the main
+    // loop
+    struct InfoQuery
+    {
+        LS::Message request;
+        std::string devicenode;
+        std::string deviceType;
+        std::string reply;
+    };
+    std::vector<std::thread> infoThreads_;
+    std::mutex infoMutex_;
+    std::condition_variable infoCond_;
+    std::deque<std::unique_ptr<InfoQuery>> infoQueries_;
+    bool infoStop_{false};
+    void runInfoQueries();
+    static gboolean onInfoReply(gpointer data);
+
+    // binary command channel to the camera service, see openChannel
+    int channelFd_{-1};
+    int channelPeerFd_{-1}; // end handed out, kept until the first command arrives
+    guint channelSource_{0};
+    void closeChannel();
+    static gboolean onChannelCommand(gint fd, GIOCondition condition, gpointer data);
+    void handleCommand(const HalCommandMessage &cmd, HAL_REPLY_T *reply, int *fds);
+    void openStream(const HalCommandMessage &cmd, HAL_REPLY_T *reply, int *fds);
 
 public:
-    CameraHalService(const char *service_name);
+    CameraHalService(const char *service_name, bool infoWorker = false);
+    ~CameraHalService();
 
     CameraHalService(CameraHalService const &)            = delete;
     CameraHalService(CameraHalService &&)                 = delete;
@@ -56,6 +97,13 @@ public:
     bool enableCameraSolution(LSMessage &message);
     bool disableCameraSolution(LSMessage &message);
     bool subscribe(LSMessage &);
+    bool openChannel(LSMessage &message);
+};
+
+struct HalOptions
+{
+    std::string serviceName;
+    bool infoWorker{false};
 };
 
-std::string parseHalServiceName(int argc, char *argv[]) noexcept;
+HalOptions parseHalOptions(int argc, char *argv[]) noexcept;
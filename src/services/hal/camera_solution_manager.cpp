@@ -19,6 +19,9 @@
 #include "camera_types.h"
 #include "plugin_factory.hpp"
 
+// shared memory client ids of the solution processes, above the service handles (0 ~ 9999)
+#define SOLUTION_CLIENT_ID_BASE 100000
+
 CameraSolutionManager::CameraSolutionManager(void)
 {
 #ifdef FIX_ME // not support sync solution
@@ -34,9 +37,10 @@ CameraSolutionManager::CameraSolutionManager(void)
 #endif
     PluginFactory factory;
     std::vector<std::string> list = factory.getFeatureList("SOLUTION");
+    int clientId = SOLUTION_CLIENT_ID_BASE;
     for (auto &s : list)
     {
-        lstSolution_.push_back(std::make_unique<CameraSolutionProxy>(s));
+        lstSolution_.push_back(std::make_unique<CameraSolutionProxy>(s, clientId++));
     }
 }
 
@@ -49,6 +53,13 @@ void CameraSolutionManager::setEventListener(CameraSolutionEvent *pEvent)
         i->setEventListener(pEvent);
 }
 
+void CameraSolutionManager::setClientHandler(ClientHandler handler)
+{
+    std::lock_guard<std::mutex> lg(mtxApi_);
+    for (auto &i : lstSolution_)
+        i->setClientHandler(handler);
+}
+
 int32_t CameraSolutionManager::getMetaSizeHint(void)
 {
     std::lock_guard<std::mutex> lg(mtxApi_);
@@ -65,10 +76,10 @@ int32_t CameraSolutionManager::getMetaSizeHint(void)
 }
 
 void CameraSolutionManager::initialize(stream_format_t streamFormat, const std::string &shmName,
-                                       LSHandle *sh)
+                                       LSHandle *sh, const std::string &decodedShmName)
 {
     for (auto &i : lstSolution_)
-        i->initialize(streamFormat, shmName, sh);
+        i->initialize(streamFormat, shmName, sh, decodedShmName);
 }
 
 void CameraSolutionManager::release(void)
@@ -225,3 +236,32 @@ DEVICE_RETURN_CODE_T CameraSolutionManager::disableCameraSolution(const Solution
 
     return DEVICE_OK;
 }
+
+DEVICE_RETURN_CODE_T CameraSolutionManager::setSolutionSchedule(const std::string &name,
+                                                                const solution_schedule_t &schedule)
+{
+    std::lock_guard<std::mutex> lg(mtxApi_);
+    PLOGI("%s", name.c_str());
+    for (auto &i : lstSolution_)
+    {
+        if (name == i->getSolutionStr())
+        {
+            i->setSchedule(schedule);
+            return DEVICE_OK;
+        }
+    }
+    return DEVICE_ERROR_WRONG_PARAM;
+}
+
+void CameraSolutionManager::getSolutionStatus(std::vector<solution_status_t> &status)
+{
+    std::lock_guard<std::mutex> lg(mtxApi_);
+    for (auto &i : lstSolution_)
+    {
+        solution_status_t s;
+        if (i->getStatus(s))
+        {
+            status.push_back(std::move(s));
+        }
+    }
+}
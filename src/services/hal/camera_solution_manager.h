@@ -17,6 +17,7 @@
 
 #include "camera_hal_types.h"
 #include "camera_types.h"
+#include <functional>
 #include <list>
 #include <memory>
 #include <mutex>
@@ -33,6 +34,7 @@ class CameraSolutionManager
 public:
     using SolutionNames = std::vector<std::string>;
     using SolutionList  = std::list<std::unique_ptr<CameraSolutionProxy>>;
+    using ClientHandler = std::function<bool(int, bool)>;
 
 public:
     CameraSolutionManager(void);
@@ -41,8 +43,11 @@ public:
 public:
     // To process
     void setEventListener(CameraSolutionEvent *pEvent);
+    void setClientHandler(ClientHandler handler);
     int32_t getMetaSizeHint(void);
-    void initialize(stream_format_t streamFormat, const std::string &shmName, LSHandle *sh);
+    // decodedShmName : ring of frames decoded by the hal, empty if the solutions decode
+    void initialize(stream_format_t streamFormat, const std::string &shmName, LSHandle *sh,
+                    const std::string &decodedShmName = "");
     void release(void);
     void processCapture(buffer_t frame_buffer);
     void processPreview(buffer_t frame_buffer);
@@ -53,6 +58,9 @@ public:
     void getEnabledSolutionInfo(SolutionNames &names);
     DEVICE_RETURN_CODE_T enableCameraSolution(const SolutionNames &names);
     DEVICE_RETURN_CODE_T disableCameraSolution(const SolutionNames &names);
+    DEVICE_RETURN_CODE_T setSolutionSchedule(const std::string &name,
+                                             const solution_schedule_t &schedule);
+    void getSolutionStatus(std::vector<solution_status_t> &status);
 
 private:
     SolutionList lstSolution_;
@@ -55,10 +55,10 @@ static bool cameraSolutionServiceCb(const char *msg, void *data)
     return true;
 }
 
-CameraSolutionProxy::CameraSolutionProxy(const std::string &solution_name)
-    : solution_name_(solution_name), shmName_("")
+CameraSolutionProxy::CameraSolutionProxy(const std::string &solution_name, int clientId)
+    : solution_name_(solution_name), shmName_(""), clientId_(clientId)
 {
-    PLOGI("%s", solution_name_.c_str());
+    PLOGI("%s, clientId %d", solution_name_.c_str(), clientId_);
 }
 
 CameraSolutionProxy::~CameraSolutionProxy()
@@ -97,14 +97,15 @@ int32_t CameraSolutionProxy::getMetaSizeHint(void)
 }
 
 void CameraSolutionProxy::initialize(stream_format_t streamFormat, const std::string &shmName,
-                                     LSHandle *sh)
+                                     LSHandle *sh, const std::string &decodedShmName)
 {
-    PLOGI("shmName : %s", shmName.c_str());
+    PLOGI("shmName : %s, decodedShmName : %s", shmName.c_str(), decodedShmName.c_str());
 
     // keep informations
-    streamFormat_ = streamFormat;
-    shmName_      = shmName;
-    sh_           = sh;
+    streamFormat_   = streamFormat;
+    shmName_        = shmName;
+    decodedShmName_ = decodedShmName;
+    sh_             = sh;
 
     startThread();
 
@@ -128,6 +129,8 @@ void CameraSolutionProxy::setEnableValue(bool enableValue)
 
 void CameraSolutionProxy::processing(bool enableValue)
 {
+    std::lock_guard<std::mutex> lg(mtxProcess_);
+
     if (enableStatus_ == enableValue)
     {
         PLOGI("same as current value %d", enableValue);
@@ -150,8 +153,15 @@ void CameraSolutionProxy::processing(bool enableValue)
     {
         startProcess();
 
+        // Register as a reader client so the solution is woken only on new frames
+        if (clientHandler_ && !clientHandler_(clientId_, true))
+        {
+            PLOGW("failed to register client %d, solution polls latest frame", clientId_);
+        }
+
         create();
         init();
+        sendSchedule();
 
         luna_call_sync("enable", to_string(jin));
 
@@ -166,6 +176,11 @@ void CameraSolutionProxy::processing(bool enableValue)
 
         luna_call_sync("release", "{}");
 
+        if (clientHandler_)
+        {
+            clientHandler_(clientId_, false);
+        }
+
         stopProcess();
     }
 
@@ -182,6 +197,50 @@ void CameraSolutionProxy::release()
     unsubscribe();
 
     shmName_.clear();
+    decodedShmName_.clear();
+}
+
+void CameraSolutionProxy::setSchedule(const solution_schedule_t &schedule)
+{
+    std::lock_guard<std::mutex> lg(mtxProcess_);
+
+    // kept for the next start of the process, zero fields keep the previous request
+    if (schedule.fps > 0.0)
+        schedule_.fps = schedule.fps;
+    if (schedule.max_latency_ms > 0)
+        schedule_.max_latency_ms = schedule.max_latency_ms;
+    if (schedule.priority != 0)
+        schedule_.priority = schedule.priority;
+
+    if (enableStatus_)
+        sendSchedule();
+}
+
+bool CameraSolutionProxy::getStatus(solution_status_t &status)
+{
+    std::lock_guard<std::mutex> lg(mtxProcess_);
+
+    status.name = solution_name_;
+    if (!enableStatus_)
+        return false;
+
+    std::string resp;
+    if (!luna_call_sync("getStatus", "{}", nullptr, &resp))
+        return false;
+
+    json j = json::parse(resp, nullptr, false);
+    if (j.is_discarded())
+        return false;
+
+    json jparams = get_optional<json>(j, CONST_PARAM_NAME_PARAMS).value_or(json::object());
+    status.schedule.fps = get_optional<double>(jparams, CONST_PARAM_NAME_FPS).value_or(0.0);
+    status.schedule.max_latency_ms =
+        get_optional<int>(jparams, CONST_PARAM_NAME_MAX_LATENCY).value_or(0);
+    status.schedule.priority = get_optional<int>(jparams, CONST_PARAM_NAME_PRIORITY).value_or(0);
+    status.fps               = get_optional<double>(j, CONST_PARAM_NAME_FPS).value_or(0.0);
+    status.latency_ms        = get_optional<int>(j, CONST_PARAM_NAME_LATENCY).value_or(0);
+    status.skipped           = get_optional<uint64_t>(j, CONST_PARAM_NAME_SKIPPED).value_or(0);
+    return true;
 }
 
 bool CameraSolutionProxy::startProcess()
@@ -268,10 +327,30 @@ bool CameraSolutionProxy::init()
     jin[CONST_PARAM_NAME_FPS]        = streamFormat_.stream_fps;
     jin[CONST_PARAM_NAME_BUFFERSIZE] = streamFormat_.buffer_size;
     jin[CONST_PARAM_NAME_SHMNAME]    = shmName_;
+    jin[CONST_PARAM_NAME_ID]         = clientId_;
+    if (!decodedShmName_.empty())
+    {
+        jin[CONST_PARAM_NAME_DECODED_SHMNAME] = decodedShmName_;
+    }
 
     return luna_call_sync(__func__, to_string(jin));
 }
 
+bool CameraSolutionProxy::sendSchedule()
+{
+    if (schedule_.fps <= 0.0 && schedule_.max_latency_ms <= 0 && schedule_.priority == 0)
+        return true;
+
+    PLOGI("");
+
+    json jin;
+    jin[CONST_PARAM_NAME_FPS]         = schedule_.fps;
+    jin[CONST_PARAM_NAME_MAX_LATENCY] = schedule_.max_latency_ms;
+    jin[CONST_PARAM_NAME_PRIORITY]    = schedule_.priority;
+
+    return luna_call_sync("setSchedule", to_string(jin));
+}
+
 bool CameraSolutionProxy::subscribe()
 {
     PLOGI("");
@@ -334,7 +413,8 @@ bool CameraSolutionProxy::unsubscribe()
     return ret;
 }
 
-bool CameraSolutionProxy::luna_call_sync(const char *func, const std::string &payload, int *fd)
+bool CameraSolutionProxy::luna_call_sync(const char *func, const std::string &payload, int *fd,
+                                         std::string *pResp)
 {
     if (process_ == nullptr)
     {
@@ -370,6 +450,8 @@ bool CameraSolutionProxy::luna_call_sync(const char *func, const std::string &pa
         return false;
     }
     bool ret = get_optional<bool>(j, CONST_PARAM_NAME_RETURNVALUE).value_or(false);
+    if (pResp)
+        *pResp = std::move(resp);
     return ret;
 }
 
@@ -19,6 +19,7 @@
 #include "camera_solution.h"
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <glib.h>
 #include <memory>
 #include <string>
@@ -29,6 +30,11 @@ class Process;
 struct CameraSolutionEvent;
 class CameraSolutionProxy
 {
+public:
+    // Registers (true) or removes (false) a shared memory reader client for a solution process
+    using ClientHandler = std::function<bool(int, bool)>;
+
+private:
     int solutionProperty_ = LG_SOLUTION_NONE;
     bool preRun_{false};
     bool enableStatus_{false};
@@ -44,9 +50,14 @@ class CameraSolutionProxy
     unsigned long subscribeKey_{0};
 
     std::string shmName_;
+    std::string decodedShmName_;
     LSHandle *sh_{nullptr};
     void *cookie{nullptr};
     std::string uid_;
+    int clientId_{-1};
+    ClientHandler clientHandler_;
+    solution_schedule_t schedule_;
+    std::mutex mtxProcess_;
 
     bool job_ready{false};
     std::condition_variable cv_;
@@ -63,7 +74,9 @@ class CameraSolutionProxy
     bool init();
     bool subscribe();
     bool unsubscribe();
-    bool luna_call_sync(const char *func, const std::string &payload, int *fd = nullptr);
+    bool sendSchedule();
+    bool luna_call_sync(const char *func, const std::string &payload, int *fd = nullptr,
+                        std::string *pResp = nullptr);
 
     void run();
     void processing(bool enableValue);
@@ -78,12 +91,16 @@ class CameraSolutionProxy
     void popJob();
 
 public:
-    CameraSolutionProxy(const std::string &solution_name);
+    CameraSolutionProxy(const std::string &solution_name, int clientId = -1);
     ~CameraSolutionProxy();
 
     void setEventListener(CameraSolutionEvent *pEvent) { pEvent_ = pEvent; }
+    void setClientHandler(ClientHandler handler) { clientHandler_ = std::move(handler); }
+    void setSchedule(const solution_schedule_t &schedule);
+    bool getStatus(solution_status_t &status);
     int32_t getMetaSizeHint(void);
-    void initialize(stream_format_t streamFormat, const std::string &shmName, LSHandle *sh);
+    void initialize(stream_format_t streamFormat, const std::string &shmName, LSHandle *sh,
+                    const std::string &decodedShmName = "");
     void setEnableValue(bool enableValue);
     int getProperty(void) { return solutionProperty_; }
     bool isEnabled(void) { return bAlive_ ? enableStatus_ : preRun_; };
@@ -0,0 +1,262 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/*-----------------------------------------------------------------------------
+ (File Inclusions)
+ ----------------------------------------------------------------------------*/
+#define LOG_TAG "CaptureWriter"
+#include "capture_writer.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <pthread.h>
+#include <unistd.h>
+
+// O_DIRECT needs the buffer, the file offset and the length aligned to the logical block size
+// of the storage. 4 KiB covers the eMMC and the usual file systems.
+static const size_t kDirectIoAlignment = 4096;
+
+static size_t alignUp(size_t size)
+{
+    return (size + kDirectIoAlignment - 1) & ~(kDirectIoAlignment - 1);
+}
+
+CaptureWriter::CaptureWriter(size_t queueDepth, SyncPolicy syncPolicy)
+    : syncPolicy_(syncPolicy), frames_(queueDepth > 0 ? queueDepth : 1)
+{
+    for (size_t i = 0; i < frames_.size(); i++)
+    {
+        freeFrames_.push_back(i);
+    }
+    start_     = std::chrono::steady_clock::now();
+    end_       = start_;
+    tidWriter_ = std::thread{[this]() { this->run(); }};
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    finish();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (tidWriter_.joinable())
+    {
+        tidWriter_.join();
+    }
+
+    for (auto &frame : frames_)
+    {
+        free(frame.data);
+    }
+}
+
+DEVICE_RETURN_CODE_T CaptureWriter::push(const void *p, size_t size, const std::string &path)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    cv_.wait(lock, [this] { return !freeFrames_.empty() || error_ != DEVICE_OK; });
+    if (error_ != DEVICE_OK)
+    {
+        return error_;
+    }
+
+    size_t index = freeFrames_.front();
+    Frame &frame = frames_[index];
+    if (frame.capacity < alignUp(size))
+    {
+        // padded for O_DIRECT, the file is truncated to the frame size after the write
+        void *data = nullptr;
+        if (posix_memalign(&data, kDirectIoAlignment, alignUp(size)) != 0)
+        {
+            PLOGE("Fail to allocate %zu bytes for capture", size);
+            return DEVICE_ERROR_OUT_OF_MEMORY;
+        }
+        free(frame.data);
+        frame.data     = data;
+        frame.capacity = alignUp(size);
+    }
+    freeFrames_.pop_front();
+
+    // the slot goes back to the ring as soon as the copy is done
+    lock.unlock();
+    memcpy(frame.data, p, size);
+    frame.size = size;
+    frame.path = path;
+    lock.lock();
+
+    if (syncDir_.empty())
+    {
+        syncDir_ = std::filesystem::path(path).parent_path().string();
+    }
+    queuedFrames_.push_back(index);
+    if (queuedFrames_.size() > maxQueueDepth_)
+    {
+        maxQueueDepth_ = queuedFrames_.size();
+    }
+    cv_.notify_all();
+    return DEVICE_OK;
+}
+
+DEVICE_RETURN_CODE_T CaptureWriter::finish()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    cv_.wait(lock, [this] { return queuedFrames_.empty() && writing_ == 0; });
+
+    if (syncPolicy_ == SyncPolicy::BATCH && written_ > 0 && !syncDir_.empty())
+    {
+        int fd = open(syncDir_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0 || syncfs(fd) != 0)
+        {
+            PLOGE("Fail to sync %s : %s", syncDir_.c_str(), strerror(errno));
+            if (error_ == DEVICE_OK)
+                error_ = DEVICE_ERROR_FAIL_TO_WRITE_FILE;
+        }
+        if (fd >= 0)
+            close(fd);
+        syncDir_.clear();
+    }
+    end_ = std::chrono::steady_clock::now();
+
+    return error_;
+}
+
+CAPTURE_STATS_T CaptureWriter::getStats(unsigned long long dropped)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    CAPTURE_STATS_T stats = {0};
+    stats.frames          = written_;
+    stats.dropped         = dropped;
+    stats.bytes           = bytes_;
+    stats.maxQueueDepth   = maxQueueDepth_;
+
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(end_ - start_).count();
+    if (us > 0)
+    {
+        stats.throughputKBps = (unsigned int)(bytes_ * 1000000 / 1024 / us);
+    }
+    return stats;
+}
+
+void CaptureWriter::run()
+{
+    pthread_setname_np(pthread_self(), "capture_writer");
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        cv_.wait(lock, [this] { return !queuedFrames_.empty() || !running_; });
+        if (queuedFrames_.empty())
+            break;
+
+        size_t index = queuedFrames_.front();
+        queuedFrames_.pop_front();
+        writing_++;
+        lock.unlock();
+
+        DEVICE_RETURN_CODE_T ret = writeFile(frames_[index]);
+
+        lock.lock();
+        writing_--;
+        if (ret == DEVICE_OK)
+        {
+            written_++;
+            bytes_ += frames_[index].size;
+        }
+        else if (error_ == DEVICE_OK)
+        {
+            error_ = ret;
+        }
+        freeFrames_.push_back(index);
+        cv_.notify_all();
+    }
+}
+
+DEVICE_RETURN_CODE_T CaptureWriter::writeFile(const Frame &frame)
+{
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    int fd    = -1;
+
+    // Direct writes keep the frames out of the page cache. Not every file system supports
+    // them (tmpfs), then the capture falls back to buffered writes.
+    if (useDirectIo_)
+    {
+        fd = open(frame.path.c_str(), flags | O_DIRECT, 0644);
+        if (fd < 0 && errno == EINVAL)
+        {
+            PLOGI("O_DIRECT is not supported for %s", frame.path.c_str());
+            useDirectIo_ = false;
+        }
+    }
+    bool directIo = (fd >= 0);
+    if (!directIo)
+    {
+        fd = open(frame.path.c_str(), flags, 0644);
+    }
+    if (fd < 0)
+    {
+        PLOGE("capturePath : open failed %s", strerror(errno));
+        return DEVICE_ERROR_CANNOT_WRITE;
+    }
+
+    DEVICE_RETURN_CODE_T ret = DEVICE_OK;
+    size_t length            = directIo ? alignUp(frame.size) : frame.size;
+    size_t offset            = 0;
+    while (offset < length)
+    {
+        ssize_t n = write(fd, static_cast<const char *>(frame.data) + offset, length - offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == EINVAL && directIo)
+        {
+            // the file system accepted O_DIRECT on open but not on write
+            PLOGI("O_DIRECT write is not supported for %s", frame.path.c_str());
+            useDirectIo_ = false;
+            close(fd);
+            return writeFile(frame);
+        }
+        if (n <= 0)
+        {
+            PLOGE("Error writing data to file : %s", strerror(errno));
+            ret = DEVICE_ERROR_FAIL_TO_WRITE_FILE;
+            break;
+        }
+        offset += n;
+    }
+
+    if (ret == DEVICE_OK && directIo && ftruncate(fd, frame.size) != 0)
+    {
+        PLOGE("ftruncate error : %s", strerror(errno));
+        ret = DEVICE_ERROR_FAIL_TO_WRITE_FILE;
+    }
+    if (ret == DEVICE_OK && syncPolicy_ == SyncPolicy::FILE && fdatasync(fd) != 0)
+    {
+        PLOGE("fdatasync error : %s", strerror(errno));
+        ret = DEVICE_ERROR_FAIL_TO_WRITE_FILE;
+    }
+
+    if (close(fd) != 0)
+    {
+        PLOGE("close error");
+    }
+    return ret;
+}
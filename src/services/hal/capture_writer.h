@@ -0,0 +1,87 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef HAL_SERVICE_CAPTURE_WRITER_H_
+#define HAL_SERVICE_CAPTURE_WRITER_H_
+
+/*-----------------------------------------------------------------------------
+ (File Inclusions)
+ ----------------------------------------------------------------------------*/
+#include "camera_types.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes captured frames to files on a thread of its own, so that the capture thread only
+// copies each frame out of the shared memory and goes back to the ring.
+class CaptureWriter
+{
+public:
+    enum class SyncPolicy
+    {
+        NONE,  // leave the write back to the kernel
+        FILE,  // fdatasync every file before the next one
+        BATCH, // one syncfs when the capture finishes
+    };
+
+    CaptureWriter(size_t queueDepth, SyncPolicy syncPolicy);
+    ~CaptureWriter();
+
+    // Copies the frame into a free buffer of the queue, waits while the queue is full.
+    DEVICE_RETURN_CODE_T push(const void *p, size_t size, const std::string &path);
+    // Waits until the queued frames are written and synced, returns the first write error.
+    DEVICE_RETURN_CODE_T finish();
+    CAPTURE_STATS_T getStats(unsigned long long dropped);
+
+private:
+    struct Frame
+    {
+        void *data{nullptr};
+        size_t capacity{0};
+        size_t size{0};
+        std::string path;
+    };
+
+    void run();
+    DEVICE_RETURN_CODE_T writeFile(const Frame &frame);
+
+    SyncPolicy syncPolicy_;
+    bool useDirectIo_{true};
+    std::string syncDir_;
+
+    std::vector<Frame> frames_;
+    std::deque<size_t> freeFrames_;
+    std::deque<size_t> queuedFrames_;
+    size_t writing_{0};
+    bool running_{true};
+    DEVICE_RETURN_CODE_T error_{DEVICE_OK};
+
+    unsigned int written_{0};
+    unsigned long long bytes_{0};
+    unsigned int maxQueueDepth_{0};
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point end_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread tidWriter_;
+};
+
+#endif /* HAL_SERVICE_CAPTURE_WRITER_H_ */
@@ -19,10 +19,14 @@
  ----------------------------------------------------------------------------*/
 #define LOG_TAG "DeviceControl"
 #include "device_controller.h"
+#include "camera_frame_meta.h"
+#include "camera_shared_memory.h"
 #include "camera_solution_manager.h"
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <ctime>
+#include <deque>
 #include <errno.h>
 #include <filesystem>
 #include <json_utils.h>
@@ -33,6 +37,10 @@
 #include <system_error>
 
 #define FRAME_COUNT 8
+// frames copied out of the ring and waiting to be written by the capture writer
+#define CAPTURE_QUEUE_DEPTH 4
+// published frames kept out of the driver queue while readers hold them
+#define MAX_PENDING_FRAMES (FRAME_COUNT - 2)
 
 using namespace nlohmann;
 
@@ -64,19 +72,111 @@ struct MemoryListener : public CameraSolutionEvent
                 continue;
             jsonResult_[key] = val;
         }
-        PLOGI("Solution Result: %s", jsonResult_.dump().c_str());
+        strResult_ = jsonResult_.dump();
+        ++generation_;
+        PLOGI("Solution Result: %s", strResult_.c_str());
     }
-    std::string getResult(void)
+    // Copies the result only if it changed since *pGeneration, returns true if copied.
+    bool copyResult(void *dst, size_t size, uint64_t *pGeneration)
     {
         std::lock_guard<std::mutex> lg(mtxResult_);
-        if (!jsonResult_.is_null())
+        if (*pGeneration == generation_)
         {
-            return jsonResult_.dump();
+            return false;
         }
-        return "";
+        if (strResult_.size() + 1 > size)
+        {
+            PLOGE("result size %zu is larger than buffer size %zu", strResult_.size(), size);
+            return false;
+        }
+        memcpy(dst, strResult_.c_str(), strResult_.size() + 1);
+        *pGeneration = generation_;
+        return true;
     }
     std::mutex mtxResult_;
     json jsonResult_;
+    std::string strResult_;
+    uint64_t generation_{0};
+};
+
+// Capture reads the ring as a client of its own : a separate mapping that sleeps on the frame
+// futex, and a cursor that returns every published frame once, in order.
+class CaptureReader
+{
+public:
+    CaptureReader(CameraSharedMemoryEx &writer, int fd)
+    {
+        // negative ids never collide with the client handles
+        static std::atomic<int> nextClientId{-2};
+        clientId_ = nextClientId--;
+
+        int readerFd = dup(fd);
+        if (readerFd < 0 || !reader_.open(readerFd))
+        {
+            PLOGE("Fail to map shared memory for capture, fd %d", fd);
+            if (readerFd >= 0)
+                ::close(readerFd);
+            return;
+        }
+        if (writer.addCursor(clientId_) < 0 ||
+            !reader_.attachCursor(clientId_, CAMERA_SHM_READ_NEXT))
+        {
+            PLOGE("no read cursor for capture");
+            return;
+        }
+        isReady_ = true;
+    }
+
+    ~CaptureReader()
+    {
+        uint64_t dropped = 0, duplicated = 0;
+        if (reader_.getReadStats(&dropped, &duplicated) && dropped > 0)
+        {
+            PLOGW("capture missed %llu frame(s)", (unsigned long long)dropped);
+        }
+        reader_.removeCursor(clientId_);
+        reader_.close();
+    }
+
+    bool isReady(void) const { return isReady_; }
+
+    // Blocks until the frame following the previous one is published and leases its slot.
+    // In dmabuf mode the shared memory has no data : start is null, index selects the buffer.
+    bool next(buffer_t *pFrame, int timeoutMs)
+    {
+        unsigned char *data = nullptr;
+        size_t size         = 0;
+        if (!reader_.read(&data, &size, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+                          timeoutMs, true))
+        {
+            return false;
+        }
+
+        pFrame->start  = data;
+        pFrame->length = size;
+        pFrame->index  = reader_.getReadIndex();
+        return true;
+    }
+
+    unsigned long long getDropped(void)
+    {
+        uint64_t dropped = 0;
+        reader_.getReadStats(&dropped, nullptr);
+        return dropped;
+    }
+
+    // false when the writer reclaimed the slot before release()
+    bool release(void)
+    {
+        bool valid = reader_.isValid();
+        reader_.release();
+        return valid;
+    }
+
+private:
+    CameraSharedMemoryEx reader_;
+    int clientId_{-1};
+    bool isReady_{false};
 };
 
 DeviceControl::DeviceControl()
@@ -90,50 +190,73 @@ DeviceControl::DeviceControl()
     {
         pCameraSolution->setEventListener(pMemoryListener.get());
     }
+    if (pCameraSolution != nullptr)
+    {
+        // Solution processes read the frames as cursor clients : the shared frame futex wakes
+        // them once per published frame. The client reads either ring, so it has a cursor on
+        // the decoded frames as well.
+        pCameraSolution->setClientHandler(
+            [this](int id, bool add) -> bool
+            {
+                PLOGI("solution client %d : %s", id, add ? "add" : "remove");
+                if (!shmem_)
+                    return false;
+                if (!add)
+                {
+                    shmem_->removeCursor(id);
+                    if (frameDecoder_)
+                        frameDecoder_->removeCursor(id);
+                    return true;
+                }
+                if (frameDecoder_ && !frameDecoder_->addCursor(id))
+                    PLOGW("no read cursor on the decoded frames for client %d", id);
+                return shmem_->addCursor(id) >= 0;
+            });
+    }
 }
 
-/* If necessary, use this according to the layout below */
-/* Currently, don't use this */
-/* meta json
+static uint32_t getStride(const stream_format_t &format)
 {
-    "video":
-    {
-        "timestamp": 123,
-        "orientation": 270,
-    },
-    "extra":
-    {
-        "buffer" : {
-            "colorspace" : 123123,
-            "width" : 1280,
-            "height" : 720,
-            "planes" : 1,
-            "stride" : 1280,
-            "size" : 123123,
-            "timestamp" : 123123
-        }
+    switch (format.pixel_format)
+    {
+    case CAMERA_PIXEL_FORMAT_NV12:
+    case CAMERA_PIXEL_FORMAT_NV21:
+    case CAMERA_PIXEL_FORMAT_I420:
+    case CAMERA_PIXEL_FORMAT_YV12:
+        return format.stream_width;
+    case CAMERA_PIXEL_FORMAT_YUYV:
+    case CAMERA_PIXEL_FORMAT_UYVY:
+        return format.stream_width * 2;
+    case CAMERA_PIXEL_FORMAT_BGRA8888:
+    case CAMERA_PIXEL_FORMAT_ARGB8888:
+        return format.stream_width * 4;
+    default:
+        return 0;
     }
 }
-*/
-bool DeviceControl::updateMetaBuffer(const buffer_t &buffer, const json &videoMeta,
-                                     const json &extraMeta)
+
+/* Written for every preview frame as CameraFrameMeta (camera_frame_meta.h). */
+/* Clients that need JSON convert it with cameraFrameMetaToJson(). */
+bool DeviceControl::updateMetaBuffer(const buffer_t &buffer, const buffer_t &frame, uint32_t flags)
 {
     PLOGD("start(%p), length(%ld)", buffer.start, buffer.length);
 
-    json jmeta     = json::object();
-    jmeta["video"] = videoMeta;
-    jmeta["extra"] = extraMeta;
-
-    std::string strMeta = jmeta.dump();
-    PLOGD("meta string : %s", strMeta.c_str());
-
-    if (strMeta.size() > 4096 - 1)
+    if (!buffer.start || buffer.length < sizeof(CameraFrameMeta))
     {
-        PLOGE("meta size is larger than buffer size");
+        PLOGE("meta buffer is smaller than CameraFrameMeta");
         return false;
     }
 
-    memcpy((char *)buffer.start, strMeta.c_str(), strMeta.size() + 1);
+    CameraFrameMeta *meta = static_cast<CameraFrameMeta *>(buffer.start);
+    meta->version         = CAMERA_FRAME_META_VERSION;
+    meta->flags           = flags;
+    meta->format          = streamFormat_.pixel_format;
+    meta->width           = streamFormat_.stream_width;
+    meta->height          = streamFormat_.stream_height;
+    meta->stride          = getStride(streamFormat_);
+    meta->size            = frame.length;
+    meta->timestamp       = frame.timestamp;
+    meta->sequence        = frame.sequence;
     return true;
 }
 
@@ -162,7 +285,7 @@ bool DeviceControl::updateMetaBuffer(const buffer_t &buffer, const json &videoMe
     ]
 }
 */
-bool DeviceControl::updateSolutionBuffer(const buffer_t &buffer)
+bool DeviceControl::updateSolutionBuffer(const buffer_t &buffer, uint64_t *pGeneration)
 {
     // std::lock_guard<std::mutex> lg(mtxResult_);
 
@@ -213,14 +336,12 @@ bool DeviceControl::updateSolutionBuffer(const buffer_t &buffer)
     //     return false;
     // }
 
-    auto meta = pMemoryListener->getResult();
-
-    memcpy((char *)buffer.start, meta.c_str(), meta.size() + 1);
-    return true;
+    // the slot keeps its result until a new one arrives
+    return pMemoryListener->copyResult(buffer.start, buffer.length, pGeneration);
 }
 
 // deprecated
-DEVICE_RETURN_CODE_T DeviceControl::writeImageToFile(const void *p, int size, int cnt) const
+std::string DeviceControl::createLegacyCaptureFileName(int cnt) const
 {
     auto path = str_imagepath_;
 
@@ -263,7 +384,7 @@ DEVICE_RETURN_CODE_T DeviceControl::writeImageToFile(const void *p, int size, in
         if (timePtr == nullptr)
         {
             PLOGE("localtime() given null ptr");
-            return DEVICE_ERROR_UNKNOWN;
+            return "";
         }
         struct timeval tmnow;
         gettimeofday(&tmnow, NULL);
@@ -282,7 +403,7 @@ DEVICE_RETURN_CODE_T DeviceControl::writeImageToFile(const void *p, int size, in
         else
         {
             PLOGE("snprintf encountered an error or the formatted string was truncated.");
-            return DEVICE_ERROR_UNKNOWN;
+            return "";
         }
 
         if (cstr_burst == str_capturemode_)
@@ -300,32 +421,22 @@ DEVICE_RETURN_CODE_T DeviceControl::writeImageToFile(const void *p, int size, in
     }
 
     PLOGD("path : %s\n", path.c_str());
+    return path;
+}
 
-    FILE *fp;
-    if (NULL == (fp = fopen(path.c_str(), "w")))
-    {
-        PLOGE("path : fopen failed\n");
-        return DEVICE_ERROR_CANNOT_WRITE;
-    }
-
-    DEVICE_RETURN_CODE_T ret = DEVICE_OK;
-    size_t sz                = (size > 0) ? (size_t)size : 0;
-    size_t bytes_written     = fwrite(p, 1, sz, fp);
-    if (bytes_written != sz)
-    {
-        PLOGE("Error writing data to file.");
-        ret = DEVICE_ERROR_FAIL_TO_WRITE_FILE;
-    }
-
-    if (fclose(fp) != 0)
-    {
-        PLOGE("fclose error");
-    }
-    return ret;
+CaptureWriter::SyncPolicy DeviceControl::getCaptureSyncPolicy() const
+{
+    // a single picture is on the storage when the reply is sent, a burst is synced once at the
+    // end, continuous capture leaves the write back to the kernel
+    if (str_capturemode_ == cstr_continuous)
+        return CaptureWriter::SyncPolicy::NONE;
+    if (str_capturemode_ == cstr_burst)
+        return CaptureWriter::SyncPolicy::BATCH;
+    return CaptureWriter::SyncPolicy::FILE;
 }
 
 // deprecated
-DEVICE_RETURN_CODE_T DeviceControl::saveShmemory(int ncount) const
+DEVICE_RETURN_CODE_T DeviceControl::saveShmemory(int ncount, CAPTURE_STATS_T *pStats) const
 {
     if (!shmem_)
     {
@@ -333,39 +444,34 @@ DEVICE_RETURN_CODE_T DeviceControl::saveShmemory(int ncount) const
         return DEVICE_ERROR_UNKNOWN;
     }
 
+    CaptureReader reader(*shmem_, shmBufferFd_);
+    if (!reader.isReady())
+    {
+        return DEVICE_ERROR_UNKNOWN;
+    }
+
+    CaptureWriter writer(CAPTURE_QUEUE_DEPTH, getCaptureSyncPolicy());
+
     buffer_t frame_buffer = {0};
-    int read_index        = -1;
-    int write_index       = -1;
     int nCaptured         = 0;
 
     DEVICE_RETURN_CODE_T ret = DEVICE_OK;
 
-    const unsigned int sleep_us       = 10000; // 10ms
-    const unsigned int max_iterations = 1000;
+    const int timeout_ms = 10000; // 10s
 
     while ((nCaptured++ < ncount) || b_iscontinuous_capture_)
     {
-        unsigned int cnt = 0;
-
-        while (cnt < max_iterations) // 10s
+        if (!reader.next(&frame_buffer, timeout_ms))
         {
-            write_index = shmem_->getWriteIndex();
-
-            if (read_index != write_index)
-            {
-                break;
-            }
-            usleep(sleep_us);
-            cnt++;
+            PLOGE("no frame published for %d ms", timeout_ms);
+            return DEVICE_ERROR_TIMEOUT;
         }
-        if (read_index == write_index)
+
+        // dmabuf mode : the frame is in the driver buffer of the slot
+        if (frame_buffer.start == nullptr && shmDataBuffers != nullptr)
         {
-            PLOGE("same write_index=%d", write_index);
+            frame_buffer.start = shmDataBuffers[frame_buffer.index].start;
         }
-        read_index = (write_index - 1 + FRAME_COUNT) % FRAME_COUNT;
-
-        frame_buffer.start  = shmDataBuffers[read_index].start;
-        frame_buffer.length = shmDataBuffers[read_index].length;
 
         PLOGD("buffer start : %p \n", frame_buffer.start);
         PLOGD("buffer length : %lu \n", frame_buffer.length);
@@ -373,6 +479,7 @@ DEVICE_RETURN_CODE_T DeviceControl::saveShmemory(int ncount) const
         if (frame_buffer.start == nullptr)
         {
             PLOGE("no valid memory on frame buffer ptr");
+            reader.release();
             return DEVICE_ERROR_OUT_OF_MEMORY;
         }
 
@@ -383,7 +490,13 @@ DEVICE_RETURN_CODE_T DeviceControl::saveShmemory(int ncount) const
         }
 
         // write captured image to /tmp only if startCapture request is made
-        ret = writeImageToFile(frame_buffer.start, frame_buffer.length, nCaptured);
+        std::string path = createLegacyCaptureFileName(nCaptured);
+        ret              = path.empty() ? DEVICE_ERROR_UNKNOWN
+                                        : writer.push(frame_buffer.start, frame_buffer.length, path);
+        if (!reader.release())
+        {
+            PLOGW("frame %d was overwritten while it was copied", nCaptured);
+        }
         if (ret != DEVICE_OK)
         {
             PLOGE("file write error");
@@ -391,41 +504,19 @@ DEVICE_RETURN_CODE_T DeviceControl::saveShmemory(int ncount) const
         }
     }
 
-    return DEVICE_OK;
-}
-
-DEVICE_RETURN_CODE_T DeviceControl::writeImageToFile(const void *p, unsigned long size, int cnt,
-                                                     std::vector<std::string> &capturedFiles) const
-{
-    auto capturePath = createCaptureFileName(cnt);
+    ret = writer.finish();
 
-    FILE *fp;
-    if (NULL == (fp = fopen(capturePath.c_str(), "w")))
-    {
-        PLOGE("capturePath : fopen failed");
-        return DEVICE_ERROR_CANNOT_WRITE;
-    }
-
-    DEVICE_RETURN_CODE_T ret = DEVICE_OK;
-    size_t sz                = (size > 0) ? (size_t)size : 0;
-    size_t bytes_written     = fwrite(p, 1, sz, fp);
-    if (bytes_written != sz)
-    {
-        PLOGE("Error writing data to file.");
-        ret = DEVICE_ERROR_FAIL_TO_WRITE_FILE;
-    }
-
-    capturedFiles.push_back(capturePath);
-
-    if (fclose(fp) != 0)
-    {
-        PLOGE("fclose error");
-    }
+    CAPTURE_STATS_T stats = writer.getStats(reader.getDropped());
+    PLOGI("frames %u dropped %llu bytes %llu max queue %u throughput %u KiB/s", stats.frames,
+          stats.dropped, stats.bytes, stats.maxQueueDepth, stats.throughputKBps);
+    if (pStats)
+        *pStats = stats;
     return ret;
 }
 
 DEVICE_RETURN_CODE_T DeviceControl::saveShmemory(int ncount,
-                                                 std::vector<std::string> &capturedFiles) const
+                                                 std::vector<std::string> &capturedFiles,
+                                                 CAPTURE_STATS_T *pStats) const
 {
     if (!shmem_)
     {
@@ -433,39 +524,34 @@ DEVICE_RETURN_CODE_T DeviceControl::saveShmemory(int ncount,
         return DEVICE_ERROR_UNKNOWN;
     }
 
+    CaptureReader reader(*shmem_, shmBufferFd_);
+    if (!reader.isReady())
+    {
+        return DEVICE_ERROR_UNKNOWN;
+    }
+
+    CaptureWriter writer(CAPTURE_QUEUE_DEPTH, getCaptureSyncPolicy());
+
     buffer_t frame_buffer = {0};
-    int read_index        = -1;
-    int write_index       = -1;
     int nCaptured         = 0;
 
     DEVICE_RETURN_CODE_T ret = DEVICE_OK;
 
-    const unsigned int sleep_us       = 10000; // 10ms
-    const unsigned int max_iterations = 1000;
+    const int timeout_ms = 10000; // 10s
 
     while ((nCaptured++ < ncount) || b_iscontinuous_capture_)
     {
-        unsigned int cnt = 0;
-
-        while (cnt < max_iterations) // 10s
+        if (!reader.next(&frame_buffer, timeout_ms))
         {
-            write_index = shmem_->getWriteIndex();
-
-            if (read_index != write_index)
-            {
-                break;
-            }
-            usleep(sleep_us);
-            cnt++;
+            PLOGE("no frame published for %d ms", timeout_ms);
+            return DEVICE_ERROR_TIMEOUT;
         }
-        if (read_index == write_index)
+
+        // dmabuf mode : the frame is in the driver buffer of the slot
+        if (frame_buffer.start == nullptr && shmDataBuffers != nullptr)
         {
-            PLOGE("same write_index=%d", write_index);
+            frame_buffer.start = shmDataBuffers[frame_buffer.index].start;
         }
-        read_index = (write_index - 1 + FRAME_COUNT) % FRAME_COUNT;
-
-        frame_buffer.start  = shmDataBuffers[read_index].start;
-        frame_buffer.length = shmDataBuffers[read_index].length;
 
         PLOGD("buffer start : %p \n", frame_buffer.start);
         PLOGD("buffer length : %lu \n", frame_buffer.length);
@@ -473,6 +559,7 @@ DEVICE_RETURN_CODE_T DeviceControl::saveShmemory(int ncount,
         if (frame_buffer.start == nullptr)
         {
             PLOGE("no valid memory on frame buffer ptr");
+            reader.release();
             return DEVICE_ERROR_OUT_OF_MEMORY;
         }
 
@@ -483,15 +570,29 @@ DEVICE_RETURN_CODE_T DeviceControl::saveShmemory(int ncount,
         }
 
         // write captured image to /tmp only if startCapture request is made
-        ret = writeImageToFile(frame_buffer.start, frame_buffer.length, nCaptured, capturedFiles);
+        std::string path = createCaptureFileName(nCaptured);
+        ret              = path.empty() ? DEVICE_ERROR_UNKNOWN
+                                        : writer.push(frame_buffer.start, frame_buffer.length, path);
+        if (!reader.release())
+        {
+            PLOGW("frame %d was overwritten while it was copied", nCaptured);
+        }
         if (ret != DEVICE_OK)
         {
             PLOGE("file write error");
             return ret;
         }
+        capturedFiles.push_back(path);
     }
 
-    return DEVICE_OK;
+    ret = writer.finish();
+
+    CAPTURE_STATS_T stats = writer.getStats(reader.getDropped());
+    PLOGI("frames %u dropped %llu bytes %llu max queue %u throughput %u KiB/s", stats.frames,
+          stats.dropped, stats.bytes, stats.maxQueueDepth, stats.throughputKBps);
+    if (pStats)
+        *pStats = stats;
+    return ret;
 }
 
 camera_pixel_format_t DeviceControl::getPixelFormat(camera_format_t eformat)
@@ -521,7 +622,7 @@ void DeviceControl::captureThread()
 
     b_iscontinuous_capture_ = true;
 
-    saveShmemory();
+    saveShmemory(0, &captureStats_);
 
     PLOGI("ended\n");
     return;
@@ -541,6 +642,8 @@ void DeviceControl::previewThread()
     int debug_interval = 100; // frames
     auto tic           = std::chrono::steady_clock::now();
 
+    std::deque<buffer_t> pendingBuffers;
+
     while (b_isstreamon_)
     {
         // keep writing data to shared memory
@@ -561,6 +664,17 @@ void DeviceControl::previewThread()
             break;
         }
 
+        // controls changed by the device itself (auto exposure, ...) while waiting for the frame
+        camera_properties_t changed;
+        for (int i = 0; i < PROPERTY_END; i++)
+        {
+            changed.stGetData.data[i][QUERY_VALUE] = CONST_PARAM_DEFAULT_VALUE;
+        }
+        if (p_cam_hal->getPropertyEvents(&changed) == CAMERA_ERROR_NONE)
+        {
+            notifyPropertyEvent_(changed);
+        }
+
         //[Camera Solution Manager] process for preview
         if (pCameraSolution != nullptr)
         {
@@ -583,16 +697,52 @@ void DeviceControl::previewThread()
         shmDataBuffers[buffer.index].start  = buffer.start;
         shmDataBuffers[buffer.index].length = buffer.length;
 
+        // The slot index is the driver buffer index.
+        // dmabuf clients use it to select the fd received from getFd.
+        if (shmExtraBuffers_[shm_index].length >= sizeof(unsigned int))
+        {
+            unsigned int bufferIndex = (unsigned int)buffer.index;
+            memcpy(shmExtraBuffers_[shm_index].start, &bufferIndex, sizeof(bufferIndex));
+        }
+
         // Create meta_data
-        updateMetaBuffer(shmMetaBuffers_[shm_index], nullptr, nullptr);
-        updateSolutionBuffer(shmSolutionBuffers_[shm_index]);
+        uint32_t metaFlags = (io_mode_ == IOMODE_DMABUF) ? CAMERA_FRAME_META_FLAG_DMABUF : 0;
+        if (updateSolutionBuffer(shmSolutionBuffers_[shm_index],
+                                 &shmSolutionGenerations_[shm_index]))
+        {
+            metaFlags |= CAMERA_FRAME_META_FLAG_SOLUTION_UPDATED;
+        }
+        updateMetaBuffer(shmMetaBuffers_[shm_index], buffer, metaFlags);
 
         shmem_->writeHeader(buffer.index, buffer.length);
-        shmem_->incrementWriteIndex();
 
         shmem_->notifySignal();
 
-        retval = p_cam_hal->releaseBuffer(&buffer);
+        // The newest frame stays published. Older frames go back to the driver only when no
+        // reader holds them, or by force when the driver would run out of buffers.
+        pendingBuffers.push_back(buffer);
+        for (auto it = pendingBuffers.begin(); it + 1 != pendingBuffers.end();)
+        {
+            if (!shmem_->lockSlotForWrite(it->index))
+            {
+                ++it;
+                continue;
+            }
+
+            retval = p_cam_hal->releaseBuffer(&(*it));
+            if (retval != CAMERA_ERROR_NONE)
+                break;
+            it = pendingBuffers.erase(it);
+        }
+        // only the oldest frames the driver is short of are taken back from their readers
+        while (retval == CAMERA_ERROR_NONE && pendingBuffers.size() > MAX_PENDING_FRAMES)
+        {
+            shmem_->lockSlotForWrite(pendingBuffers.front().index, true);
+            retval = p_cam_hal->releaseBuffer(&pendingBuffers.front());
+            if (retval != CAMERA_ERROR_NONE)
+                break;
+            pendingBuffers.pop_front();
+        }
         if (retval != CAMERA_ERROR_NONE)
         {
             PLOGE("releaseBuffer failed");
@@ -606,6 +756,7 @@ void DeviceControl::previewThread()
             auto us  = std::chrono::duration_cast<std::chrono::microseconds>(toc - tic).count();
             PLOGI("previewThread p_cam_hal(%p) : fps(%3.2f)", p_cam_hal,
                   debug_interval * 1000000.0f / us);
+            shmem_->printCursorStats();
             tic           = toc;
             debug_counter = 0;
         }
@@ -648,9 +799,16 @@ DEVICE_RETURN_CODE_T DeviceControl::close()
     return DEVICE_OK;
 }
 
-DEVICE_RETURN_CODE_T DeviceControl::startPreview(LSHandle *sh, const char *subskey)
+DEVICE_RETURN_CODE_T DeviceControl::startPreview(LSHandle *sh, const char *subskey,
+                                                 const std::string &memtype)
 {
-    PLOGI("started !\n");
+    PLOGI("started ! memtype : %s\n", memtype.c_str());
+
+    if (memtype != cstr_shmem && memtype != cstr_dmabuf)
+    {
+        PLOGE("unsupported memtype %s", memtype.c_str());
+        return DEVICE_ERROR_WRONG_PARAM;
+    }
 
     sh_      = sh;
     subskey_ = subskey ? subskey : "";
@@ -666,6 +824,7 @@ DEVICE_RETURN_CODE_T DeviceControl::startPreview(LSHandle *sh, const char *subsk
 
     PLOGI("Driver set width : %d height : %d fps : %d", streamformat.stream_width,
           streamformat.stream_height, streamformat.stream_fps);
+    streamFormat_ = streamformat;
 
     solutionTextSize_   = 0;
     solutionBinarySize_ = 0;
@@ -675,8 +834,9 @@ DEVICE_RETURN_CODE_T DeviceControl::startPreview(LSHandle *sh, const char *subsk
         solutionTextSize_ = pCameraSolution->getMetaSizeHint();
     }
 
-    size_t shmDataSize     = streamformat.buffer_size + extra_buffer;
-    size_t shmMetaSize     = extra_buffer; // 1024
+    // In dmabuf mode the frames stay in the driver buffers, so no data section is needed.
+    size_t shmDataSize     = (memtype == cstr_dmabuf) ? 0 : streamformat.buffer_size + extra_buffer;
+    size_t shmMetaSize     = sizeof(CameraFrameMeta);
     size_t shmExtraSize    = sizeof(unsigned int);
     size_t shmSolutionSize = solutionTextSize_;
 
@@ -689,9 +849,22 @@ DEVICE_RETURN_CODE_T DeviceControl::startPreview(LSHandle *sh, const char *subsk
         return DEVICE_ERROR_UNKNOWN;
     }
 
+    // Frames are locked in huge pages. Solutions open the shared memory by name, so the
+    // anonymous memfd is used only when no solution can read it.
+    std::vector<std::string> solutions;
+    if (pCameraSolution != nullptr && memtype != cstr_dmabuf)
+    {
+        pCameraSolution->getSupportedSolutionInfo(solutions);
+    }
+    unsigned int shmOptions = solutions.empty() ? CAMERA_SHM_OPT_MEMFD : 0;
+    if (shmDataSize > 0)
+    {
+        shmOptions |= CAMERA_SHM_OPT_HUGEPAGE | CAMERA_SHM_OPT_PREFAULT;
+    }
+
     shmemName    = std::string("/camera.shm.") + std::to_string(getpid());
     shmBufferFd_ = shmem_->create(shmemName, shmDataSize, shmMetaSize, shmExtraSize,
-                                  shmSolutionSize, FRAME_COUNT);
+                                  shmSolutionSize, FRAME_COUNT, shmOptions);
     if (shmBufferFd_ < 0)
     {
         PLOGE("Fail to create CameraSharedMemory : invalid FD");
@@ -699,10 +872,28 @@ DEVICE_RETURN_CODE_T DeviceControl::startPreview(LSHandle *sh, const char *subsk
         return DEVICE_ERROR_UNKNOWN;
     }
 
+    // Jpeg frames are decoded once here for all the solutions rather than in each of them.
+    // Without the decoder, the solutions decode the frames of the preview ring themselves.
+    std::string decodedShmName;
+    if (!solutions.empty() && streamformat.pixel_format == CAMERA_PIXEL_FORMAT_JPEG)
+    {
+        frameDecoder_ = std::make_unique<FrameDecoder>();
+        if (frameDecoder_->start(*shmem_, shmBufferFd_, streamformat, shmemName + ".decoded"))
+        {
+            decodedShmName = frameDecoder_->getShmName();
+        }
+        else
+        {
+            PLOGW("frames are decoded by each solution");
+            frameDecoder_.reset();
+        }
+    }
+
     //[Camera Solution Manager] initialization
-    if (pCameraSolution != nullptr)
+    // Solutions read the frame from the shared memory, which has no data in dmabuf mode.
+    if (pCameraSolution != nullptr && memtype != cstr_dmabuf)
     {
-        pCameraSolution->initialize(streamformat, shmemName, sh);
+        pCameraSolution->initialize(streamformat, shmemName, sh, decodedShmName);
     }
 
     if (b_isstreamon_)
@@ -723,6 +914,7 @@ DEVICE_RETURN_CODE_T DeviceControl::startPreview(LSHandle *sh, const char *subsk
     shmMetaBuffers_.resize(FRAME_COUNT);
     shmExtraBuffers_.resize(FRAME_COUNT);
     shmSolutionBuffers_.resize(FRAME_COUNT);
+    shmSolutionGenerations_.assign(FRAME_COUNT, 0);
 
     std::vector<void *> dataList, metaList, extraList, solutionList;
     shmem_->getBufferList(&dataList, &metaList, &extraList, &solutionList);
@@ -748,12 +940,12 @@ DEVICE_RETURN_CODE_T DeviceControl::startPreview(LSHandle *sh, const char *subsk
         shmSolutionBuffers_[i].length = solutionSize;
     }
 
-    // [TODO][WRR-15621] Need support for mmap internally.
-    // Handle cases where user pointer is not used.
-    // In device_control, branch based on conditions other than memtype.
-    // The shared memory implementation class must support writedata() for memcpy
+    // shmem  : the driver writes the frames into the shared memory (user pointer).
+    // dmabuf : the driver's mmap buffers are exported and handed to the clients through getFd,
+    //          the shared memory carries only the headers and the metadata.
+    io_mode_ = (memtype == cstr_dmabuf) ? IOMODE_DMABUF : IOMODE_USERPTR;
 
-    auto retval = p_cam_hal->setBuffer(FRAME_COUNT, IOMODE_USERPTR, (void **)&shmDataBuffers);
+    auto retval = p_cam_hal->setBuffer(FRAME_COUNT, io_mode_, (void **)&shmDataBuffers);
     if (retval != CAMERA_ERROR_NONE)
     {
         PLOGE("setBuffer failed");
@@ -761,6 +953,22 @@ DEVICE_RETURN_CODE_T DeviceControl::startPreview(LSHandle *sh, const char *subsk
         return DEVICE_ERROR_UNKNOWN;
     }
 
+    if (io_mode_ == IOMODE_DMABUF)
+    {
+        int fds[FRAME_COUNT];
+        int count = 0;
+        retval    = p_cam_hal->getBufferFd(fds, &count);
+        if (retval != CAMERA_ERROR_NONE || count <= 0 || count > FRAME_COUNT)
+        {
+            PLOGE("getBufferFd failed, count %d", count);
+            p_cam_hal->destroyBuffer();
+            closeShmemoryIfNeeded();
+            return DEVICE_ERROR_UNKNOWN;
+        }
+        dmaBufferFds_.assign(fds, fds + count);
+        PLOGI("exported %d dmabuf fds", count);
+    }
+
     retval = p_cam_hal->startCapture();
     if (retval != CAMERA_ERROR_NONE)
     {
@@ -827,6 +1035,8 @@ DEVICE_RETURN_CODE_T DeviceControl::stopPreview(bool forceComplete)
         }
     }
 
+    // the decoder reads the preview ring until it stops
+    frameDecoder_.reset();
     if (shmem_)
     {
         shmem_.reset();
@@ -836,6 +1046,11 @@ DEVICE_RETURN_CODE_T DeviceControl::stopPreview(bool forceComplete)
 
     shmMetaBuffers_.clear();
     shmExtraBuffers_.clear();
+    shmSolutionGenerations_.clear();
+
+    // dmabuf fds are owned and closed by the hal in destroyBuffer
+    dmaBufferFds_.clear();
+    io_mode_ = IOMODE_USERPTR;
 
     return DEVICE_OK;
 }
@@ -899,7 +1114,8 @@ DEVICE_RETURN_CODE_T DeviceControl::startCapture(CAMERA_FORMAT sformat,
     if (str_capturemode_ == cstr_continuous)
     {
         // create thread that will continuously capture images until stopcapture received
-        tidCapture = std::thread{[this]() { this->captureThread(); }};
+        captureStats_ = {};
+        tidCapture    = std::thread{[this]() { this->captureThread(); }};
     }
     else
     {
@@ -912,7 +1128,7 @@ DEVICE_RETURN_CODE_T DeviceControl::startCapture(CAMERA_FORMAT sformat,
 }
 
 // deprecated
-DEVICE_RETURN_CODE_T DeviceControl::stopCapture()
+DEVICE_RETURN_CODE_T DeviceControl::stopCapture(CAPTURE_STATS_T *pStats)
 {
     PLOGI("started !\n");
 
@@ -922,6 +1138,8 @@ DEVICE_RETURN_CODE_T DeviceControl::stopCapture()
         b_iscontinuous_capture_ = false;
         storageMonitor_.stopMonitor();
         tidCapture.join();
+        if (pStats)
+            *pStats = captureStats_;
     }
     else
         return DEVICE_ERROR_DEVICE_IS_ALREADY_STOPPED;
@@ -930,7 +1148,8 @@ DEVICE_RETURN_CODE_T DeviceControl::stopCapture()
 }
 
 DEVICE_RETURN_CODE_T DeviceControl::capture(int ncount, const std::string &imagepath,
-                                            std::vector<std::string> &capturedFiles)
+                                            std::vector<std::string> &capturedFiles,
+                                            CAPTURE_STATS_T *pStats)
 {
     PLOGI("started ncount : %d \n", ncount);
 
@@ -960,7 +1179,7 @@ DEVICE_RETURN_CODE_T DeviceControl::capture(int ncount, const std::string &image
 
     DEVICE_RETURN_CODE_T ret = DEVICE_OK;
 
-    ret = saveShmemory(ncount, capturedFiles);
+    ret = saveShmemory(ncount, capturedFiles, pStats);
 
     storageMonitor_.stopMonitor();
 
@@ -1038,7 +1257,8 @@ DEVICE_RETURN_CODE_T DeviceControl::getDeviceProperty(CAMERA_PROPERTIES_T *opara
     return DEVICE_OK;
 }
 
-DEVICE_RETURN_CODE_T DeviceControl::setDeviceProperty(CAMERA_PROPERTIES_T *inparams)
+DEVICE_RETURN_CODE_T DeviceControl::setDeviceProperty(CAMERA_PROPERTIES_T *inparams,
+                                                      CAMERA_PROPERTIES_T *failed)
 {
     PLOGI("started!\n");
 
@@ -1056,6 +1276,22 @@ DEVICE_RETURN_CODE_T DeviceControl::setDeviceProperty(CAMERA_PROPERTIES_T *inpar
         return DEVICE_ERROR_UNKNOWN;
     }
 
+    if (failed != nullptr)
+    {
+        camera_properties_t errors;
+        for (int i = 0; i < PROPERTY_END; i++)
+        {
+            errors.stGetData.data[i][QUERY_VALUE] = CONST_PARAM_DEFAULT_VALUE;
+        }
+        if (p_cam_hal->getPropertyErrors(&errors) == CAMERA_ERROR_NONE)
+        {
+            for (int i = 0; i < PROPERTY_END; i++)
+            {
+                failed->stGetData.data[i][QUERY_VALUE] = errors.stGetData.data[i][QUERY_VALUE];
+            }
+        }
+    }
+
     return DEVICE_OK;
 }
 
@@ -1125,6 +1361,12 @@ DEVICE_RETURN_CODE_T DeviceControl::addClient(int id)
     }
 
     shmSignalFdMap_[id] = signalFd;
+
+    // optional for the client, which attaches to it with its handle
+    if (shmem_->addCursor(id) < 0)
+    {
+        PLOGW("no read cursor for client %d", id);
+    }
     return DEVICE_OK;
 }
 
@@ -1138,6 +1380,7 @@ DEVICE_RETURN_CODE_T DeviceControl::removeClient(int id)
             std::string name =
                 std::string("signal.") + std::to_string(getpid()) + "." + std::to_string(id);
             shmem_->detachSignal(name);
+            shmem_->removeCursor(id);
         }
         shmSignalFdMap_.erase(id);
     }
@@ -1170,6 +1413,27 @@ DEVICE_RETURN_CODE_T DeviceControl::getShmSignalFd(int id, int *fd)
     return DEVICE_OK;
 }
 
+DEVICE_RETURN_CODE_T DeviceControl::getDmaBufferFd(int index, int *fd)
+{
+    PLOGI("index %d", index);
+    if (io_mode_ != IOMODE_DMABUF || dmaBufferFds_.empty())
+    {
+        PLOGE("dmabuf is not used for this session");
+        *fd = -1;
+        return DEVICE_ERROR_UNKNOWN;
+    }
+
+    if (index < 0 || index >= (int)dmaBufferFds_.size())
+    {
+        PLOGE("index is out of range (%d)", index);
+        *fd = -1;
+        return DEVICE_ERROR_WRONG_PARAM;
+    }
+
+    *fd = dmaBufferFds_[index];
+    return DEVICE_OK;
+}
+
 camera_format_t DeviceControl::getCameraFormat(camera_pixel_format_t eformat)
 {
     // convert camera_pixel_format_t to CAMERA_FORMAT_T
@@ -1228,6 +1492,51 @@ void DeviceControl::notifyDeviceFault_(EventType eventType, DEVICE_RETURN_CODE_T
     LSErrorFree(&lserror);
 }
 
+void DeviceControl::notifyPropertyEvent_(const camera_properties_t &changed)
+{
+    if (subskey_ == "" || LSSubscriptionGetHandleSubscribersCount(sh_, subskey_.c_str()) == 0)
+        return;
+
+    // same params format as the getDeviceProperty reply, changed properties only
+    jvalue_ref json_outobj_params = jobject_create();
+    for (int i = 0; i < PROPERTY_END; i++)
+    {
+        if (changed.stGetData.data[i][QUERY_VALUE] == CONST_PARAM_DEFAULT_VALUE)
+            continue;
+
+        jvalue_ref json_outqueryparams = jobject_create();
+        for (int j = 0; j < QUERY_END; j++)
+        {
+            jobject_put(json_outqueryparams, jstring_create(getQueryString(j).c_str()),
+                        jnumber_create_i32(changed.stGetData.data[i][j]));
+        }
+        jobject_put(json_outobj_params, jstring_create(getParamString(i).c_str()),
+                    json_outqueryparams);
+    }
+
+    auto event_name      = getEventNotificationString(EventType::EVENT_TYPE_PROPERTIES);
+    std::string cameraId = "camera" + std::to_string(camera_id_);
+
+    jvalue_ref json_outobj = jobject_create();
+    jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_RETURNVALUE), jboolean_create(true));
+    jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_EVENT),
+                jstring_create(event_name.c_str()));
+    jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_ID), jstring_create(cameraId.c_str()));
+    jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_PARAMS), json_outobj_params);
+
+    LSError lserror;
+    LSErrorInit(&lserror);
+    const char *reply = jvalue_stringify(json_outobj);
+    PLOGI("[fd : %d] notifying %s : %s", halFd_, event_name.c_str(), reply);
+    if (!LSSubscriptionReply(sh_, subskey_.c_str(), reply, &lserror))
+    {
+        LSErrorPrint(&lserror, stderr);
+        PLOGI("[fd : %d] subscription reply failed\n", halFd_);
+    }
+    LSErrorFree(&lserror);
+    j_release(&json_outobj);
+}
+
 //[Camera Solution Manager] interfaces start
 DEVICE_RETURN_CODE_T
 DeviceControl::getSupportedCameraSolutionInfo(std::vector<std::string> &solutionsInfo)
@@ -1270,6 +1579,27 @@ DEVICE_RETURN_CODE_T DeviceControl::disableCameraSolution(const std::vector<std:
     }
     return DEVICE_OK;
 }
+
+DEVICE_RETURN_CODE_T DeviceControl::setCameraSolutionSchedule(const std::string &name,
+                                                              const solution_schedule_t &schedule)
+{
+    PLOGI("%s", name.c_str());
+
+    if (pCameraSolution != nullptr)
+    {
+        return pCameraSolution->setSolutionSchedule(name, schedule);
+    }
+    return DEVICE_OK;
+}
+
+DEVICE_RETURN_CODE_T DeviceControl::getCameraSolutionStatus(std::vector<solution_status_t> &status)
+{
+    if (pCameraSolution != nullptr)
+    {
+        pCameraSolution->getSolutionStatus(status);
+    }
+    return DEVICE_OK;
+}
 //[Camera Solution Manager] interfaces end
 
 std::string DeviceControl::createCaptureFileName(int cnt) const
@@ -1339,7 +1669,10 @@ void DeviceControl::closeShmemoryIfNeeded()
 
     shmMetaBuffers_.clear();
     shmExtraBuffers_.clear();
+    shmSolutionGenerations_.clear();
+    dmaBufferFds_.clear();
 
+    frameDecoder_.reset();
     if (shmem_)
     {
         shmem_.reset();
@@ -22,7 +22,9 @@
  ----------------------------------------------------------------------------*/
 #include "camera_constants.h"
 #include "camera_shared_memory_ex.h"
+#include "capture_writer.h"
 #include "camera_types.h"
+#include "frame_decoder.h"
 #include "storage_monitor.h"
 #include <condition_variable>
 #include <plugin_factory.hpp>
@@ -44,12 +46,11 @@ class DeviceControl
 {
 private:
     // deprecated
-    DEVICE_RETURN_CODE_T writeImageToFile(const void *, int, int cnt = 0) const;
+    std::string createLegacyCaptureFileName(int cnt = 0) const;
     // deprecated
-    DEVICE_RETURN_CODE_T saveShmemory(int ncount = 0) const;
-    DEVICE_RETURN_CODE_T writeImageToFile(const void *, unsigned long, int,
-                                          std::vector<std::string> &) const;
-    DEVICE_RETURN_CODE_T saveShmemory(int, std::vector<std::string> &) const;
+    DEVICE_RETURN_CODE_T saveShmemory(int ncount = 0, CAPTURE_STATS_T *pStats = nullptr) const;
+    DEVICE_RETURN_CODE_T saveShmemory(int, std::vector<std::string> &, CAPTURE_STATS_T *) const;
+    CaptureWriter::SyncPolicy getCaptureSyncPolicy() const;
     static camera_pixel_format_t getPixelFormat(camera_format_t);
     static camera_format_t getCameraFormat(camera_pixel_format_t);
 
@@ -70,6 +71,7 @@ private:
     std::string strdevicenode_;
     std::string str_imagepath_;
     std::string str_capturemode_;
+    CAPTURE_STATS_T captureStats_{}; // of the continuous capture, until stopCapture
 
     int solutionTextSize_{0};
     int solutionBinarySize_{0};
@@ -78,6 +80,7 @@ private:
     std::string subskey_;
     int camera_id_;
     void notifyDeviceFault_(EventType eventType, DEVICE_RETURN_CODE_T error = DEVICE_OK);
+    void notifyPropertyEvent_(const camera_properties_t &changed);
 
     StorageMonitor storageMonitor_;
 
@@ -91,35 +94,45 @@ private:
     int halFd_{-1};
 
     std::unique_ptr<CameraSharedMemoryEx> shmem_;
+    std::unique_ptr<FrameDecoder> frameDecoder_;
     buffer_t *shmDataBuffers;
     std::vector<buffer_t> shmMetaBuffers_;
     std::vector<buffer_t> shmExtraBuffers_;
     std::vector<buffer_t> shmSolutionBuffers_;
+    std::vector<uint64_t> shmSolutionGenerations_;
+    stream_format_t streamFormat_{};
     int shmBufferFd_{-1};
     std::map<int, int> shmSignalFdMap_;
+    int io_mode_{IOMODE_USERPTR};
+    std::vector<int> dmaBufferFds_;
 
 public:
     DeviceControl();
     DEVICE_RETURN_CODE_T open(std::string, int, std::string);
     DEVICE_RETURN_CODE_T close();
-    DEVICE_RETURN_CODE_T startPreview(LSHandle *, const char *);
+    DEVICE_RETURN_CODE_T startPreview(LSHandle *, const char *,
+                                      const std::string &memtype = cstr_shmem);
     DEVICE_RETURN_CODE_T stopPreview(bool = false);
     // deprecated
     DEVICE_RETURN_CODE_T startCapture(CAMERA_FORMAT, const std::string &, const std::string &, int);
     // deprecated
-    DEVICE_RETURN_CODE_T stopCapture();
-    DEVICE_RETURN_CODE_T capture(int, const std::string &, std::vector<std::string> &);
+    DEVICE_RETURN_CODE_T stopCapture(CAPTURE_STATS_T *pStats = nullptr);
+    DEVICE_RETURN_CODE_T capture(int, const std::string &, std::vector<std::string> &,
+                                 CAPTURE_STATS_T *pStats = nullptr);
     DEVICE_RETURN_CODE_T createHal(std::string);
     DEVICE_RETURN_CODE_T destroyHal();
     static DEVICE_RETURN_CODE_T getDeviceInfo(std::string, std::string, camera_device_info_t *);
     DEVICE_RETURN_CODE_T getDeviceProperty(CAMERA_PROPERTIES_T *);
-    DEVICE_RETURN_CODE_T setDeviceProperty(CAMERA_PROPERTIES_T *);
+    // The values of the properties the device rejected are stored to failed, if given.
+    DEVICE_RETURN_CODE_T setDeviceProperty(CAMERA_PROPERTIES_T *inparams,
+                                           CAMERA_PROPERTIES_T *failed = nullptr);
     DEVICE_RETURN_CODE_T setFormat(CAMERA_FORMAT);
     DEVICE_RETURN_CODE_T getFormat(CAMERA_FORMAT *);
     DEVICE_RETURN_CODE_T addClient(int id);
     DEVICE_RETURN_CODE_T removeClient(int id);
     DEVICE_RETURN_CODE_T getShmBufferFd(int *fd);
     DEVICE_RETURN_CODE_T getShmSignalFd(int id, int *fd);
+    DEVICE_RETURN_CODE_T getDmaBufferFd(int index, int *fd);
 
     bool notifyStorageError(const DEVICE_RETURN_CODE_T);
 
@@ -128,11 +141,14 @@ public:
     DEVICE_RETURN_CODE_T getEnabledCameraSolutionInfo(std::vector<std::string> &);
     DEVICE_RETURN_CODE_T enableCameraSolution(const std::vector<std::string> &);
     DEVICE_RETURN_CODE_T disableCameraSolution(const std::vector<std::string> &);
+    DEVICE_RETURN_CODE_T setCameraSolutionSchedule(const std::string &,
+                                                   const solution_schedule_t &);
+    DEVICE_RETURN_CODE_T getCameraSolutionStatus(std::vector<solution_status_t> &);
     //[Camera Solution Manager] integration end
 
 private:
-    bool updateMetaBuffer(const buffer_t &buffer, const json &videoMeta, const json &extraMeta);
-    bool updateSolutionBuffer(const buffer_t &buffer);
+    bool updateMetaBuffer(const buffer_t &buffer, const buffer_t &frame, uint32_t flags);
+    bool updateSolutionBuffer(const buffer_t &buffer, uint64_t *pGeneration);
 };
 
 #endif /*SERVICE_DEVICE_CONTROLLER_H_*/
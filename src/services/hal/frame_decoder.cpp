@@ -0,0 +1,304 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/*-----------------------------------------------------------------------------
+ (File Inclusions)
+ ----------------------------------------------------------------------------*/
+#define LOG_TAG "FrameDecoder"
+#include "frame_decoder.h"
+#include "camera_frame_meta.h"
+#include "camera_shared_memory.h"
+#include "camera_types.h"
+#include "jpeg_decode_error.h"
+#include <cstring>
+#include <glib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define DECODED_FRAME_COUNT 4
+// larger frames are scaled down by the decoder, by 1/2, 1/4 or 1/8, to fit in this width
+#define DECODED_FRAME_MAX_WIDTH 1280
+#define DECODED_FRAME_CHANNELS 3
+
+// size of a frame side decoded at 1/scaleDenom, rounded up as libjpeg does
+static uint32_t scaledSize(uint32_t size, uint32_t scaleDenom)
+{
+    return (size + scaleDenom - 1) / scaleDenom;
+}
+
+FrameDecoder::FrameDecoder() {}
+
+FrameDecoder::~FrameDecoder() { stop(); }
+
+bool FrameDecoder::start(CameraSharedMemoryEx &source, int fd, const stream_format_t &format,
+                         const std::string &name)
+{
+    if (format.pixel_format != CAMERA_PIXEL_FORMAT_JPEG || format.stream_width == 0 ||
+        format.stream_height == 0)
+    {
+        PLOGE("no jpeg stream to decode");
+        return false;
+    }
+
+    // the smallest reduction that fits the width, the decoder does it almost for free
+    scaleDenom_ = 1;
+    while (scaleDenom_ < 8 &&
+           scaledSize(format.stream_width, scaleDenom_) > DECODED_FRAME_MAX_WIDTH)
+    {
+        scaleDenom_ *= 2;
+    }
+    srcWidth_  = format.stream_width;
+    srcHeight_ = format.stream_height;
+    width_     = scaledSize(srcWidth_, scaleDenom_);
+    height_    = scaledSize(srcHeight_, scaleDenom_);
+    frameSize_ = (size_t)width_ * height_ * DECODED_FRAME_CHANNELS;
+
+    int decodedFd =
+        decoded_.create(name, frameSize_, sizeof(CameraFrameMeta), 0, 0, DECODED_FRAME_COUNT);
+    if (decodedFd < 0)
+    {
+        PLOGE("Fail to create shared memory %s", name.c_str());
+        return false;
+    }
+    decoded_.getBufferList(&dataList_, &metaList_, nullptr, nullptr);
+    if (dataList_.size() != DECODED_FRAME_COUNT || metaList_.size() != DECODED_FRAME_COUNT)
+    {
+        PLOGE("buffer size error!");
+        decoded_.close();
+        return false;
+    }
+
+    // negative ids never collide with the client handles
+    static std::atomic<int> nextClientId{-1000};
+    clientId_ = nextClientId--;
+
+    int readerFd = dup(fd);
+    if (readerFd < 0 || !reader_.open(readerFd))
+    {
+        PLOGE("Fail to map shared memory for decoding, fd %d", fd);
+        if (readerFd >= 0)
+            ::close(readerFd);
+        decoded_.close();
+        return false;
+    }
+    if (source.addCursor(clientId_) < 0)
+    {
+        PLOGE("no read cursor for decoding");
+        reader_.close();
+        decoded_.close();
+        return false;
+    }
+    if (!reader_.attachCursor(clientId_, CAMERA_SHM_READ_LATEST))
+    {
+        PLOGE("can not attach the read cursor for decoding");
+        source.removeCursor(clientId_);
+        reader_.close();
+        decoded_.close();
+        return false;
+    }
+
+    shmName_    = name;
+    frames_     = 0;
+    skipped_    = 0;
+    running_    = true;
+    tidDecoder_ = std::thread{[this]() { this->run(); }};
+    PLOGI("%s : %ux%u (1/%u) BGR", shmName_.c_str(), width_, height_, scaleDenom_);
+    return true;
+}
+
+void FrameDecoder::stop()
+{
+    if (!tidDecoder_.joinable())
+        return;
+
+    running_ = false;
+    tidDecoder_.join();
+
+    PLOGI("%s : decoded %llu, skipped %llu", shmName_.c_str(), frames_, skipped_);
+    reader_.removeCursor(clientId_);
+    reader_.close();
+    decoded_.close();
+    dataList_.clear();
+    metaList_.clear();
+    shmName_.clear();
+}
+
+bool FrameDecoder::addCursor(int clientId) { return decoded_.addCursor(clientId) >= 0; }
+
+void FrameDecoder::removeCursor(int clientId) { decoded_.removeCursor(clientId); }
+
+void FrameDecoder::run()
+{
+    pthread_setname_np(pthread_self(), "frame_decoder");
+
+    while (running_)
+    {
+        unsigned char *data = nullptr;
+        unsigned char *meta = nullptr;
+        size_t size         = 0;
+        size_t metaSize     = 0;
+
+        // sleeps on the frame futex of the preview ring until a new frame is published
+        if (!reader_.read(&data, &size, &meta, &metaSize, nullptr, nullptr, nullptr, nullptr, 500,
+                          false))
+        {
+            continue;
+        }
+
+        // decodes nothing while no solution reads, or before the next one is due
+        if (size == 0 || !decoded_.isFrameDue(g_get_monotonic_time()))
+        {
+            skipped_++;
+            reader_.release();
+            continue;
+        }
+
+        uint32_t width  = 0;
+        uint32_t height = 0;
+        int index       = lockSlot();
+        bool done       = decode(data, size, getScaleDenom(),
+                                 static_cast<unsigned char *>(dataList_[index]), &width, &height);
+        if (done && !reader_.isValid())
+        {
+            PLOGW("frame is overwritten while decoding");
+            done = false;
+        }
+        if (done)
+        {
+            updateMeta(index, meta, metaSize, width, height);
+        }
+        reader_.release();
+
+        // a slot left unpublished stays owned by the writer, the readers keep the latest frame
+        if (done)
+        {
+            decoded_.writeHeader(index, (size_t)width * height * DECODED_FRAME_CHANNELS);
+            decoded_.notifySignal();
+            frames_++;
+        }
+    }
+}
+
+int FrameDecoder::lockSlot()
+{
+    // any slot but the latest frame which no reader holds, starting after the latest frame
+    int first = decoded_.getWriteIndex();
+    if (first < 0)
+        return 0;
+
+    for (int i = 0; i < DECODED_FRAME_COUNT - 1; i++)
+    {
+        int index = (first + i) % DECODED_FRAME_COUNT;
+        if (decoded_.lockSlotForWrite(index))
+            return index;
+    }
+
+    // every reader holds a frame : the one after the latest is taken back
+    decoded_.lockSlotForWrite(first, true);
+    return first;
+}
+
+uint32_t FrameDecoder::getScaleDenom()
+{
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    if (!decoded_.getInputSize(&width, &height))
+        return scaleDenom_;
+
+    // the largest reduction which keeps the frame as large as every reader works on
+    uint32_t scaleDenom = 8;
+    while (scaleDenom > scaleDenom_ && (scaledSize(srcWidth_, scaleDenom) < width ||
+                                        scaledSize(srcHeight_, scaleDenom) < height))
+    {
+        scaleDenom /= 2;
+    }
+    return scaleDenom;
+}
+
+bool FrameDecoder::decode(const unsigned char *data, size_t size, uint32_t scaleDenom,
+                          unsigned char *out, uint32_t *pWidth, uint32_t *pHeight)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct DecodeError jerr;
+
+    cinfo.err           = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = onDecodeError;
+    if (setjmp(jerr.jump))
+    {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, data, size);
+    if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK)
+    {
+        PLOGE("invalid jpeg header");
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    // The scaled idct skips most of the work of the pixels dropped, and the integer idct is
+    // accurate enough for detection.
+    cinfo.scale_num       = 1;
+    cinfo.scale_denom     = scaleDenom;
+    cinfo.dct_method      = JDCT_IFAST;
+    cinfo.out_color_space = JCS_EXT_BGR;
+    jpeg_calc_output_dimensions(&cinfo);
+    if (cinfo.output_width > width_ || cinfo.output_height > height_)
+    {
+        PLOGE("decoded size %ux%u is larger than %ux%u", cinfo.output_width, cinfo.output_height,
+              width_, height_);
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    *pWidth  = cinfo.output_width;
+    *pHeight = cinfo.output_height;
+
+    jpeg_start_decompress(&cinfo);
+    size_t stride = (size_t)cinfo.output_width * DECODED_FRAME_CHANNELS;
+    while (cinfo.output_scanline < cinfo.output_height)
+    {
+        JSAMPROW row = out + cinfo.output_scanline * stride;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+void FrameDecoder::updateMeta(int index, const unsigned char *meta, size_t metaSize,
+                              uint32_t width, uint32_t height)
+{
+    // capture time and sequence of the jpeg frame, layout of the decoded one
+    CameraFrameMeta *frameMeta = static_cast<CameraFrameMeta *>(metaList_[index]);
+    memset(frameMeta, 0, sizeof(CameraFrameMeta));
+    if (meta != nullptr && metaSize >= sizeof(CameraFrameMeta))
+    {
+        const CameraFrameMeta *source = reinterpret_cast<const CameraFrameMeta *>(meta);
+        if (source->version >= 1)
+        {
+            frameMeta->timestamp = source->timestamp;
+            frameMeta->sequence  = source->sequence;
+        }
+    }
+    frameMeta->version = CAMERA_FRAME_META_VERSION;
+    frameMeta->format  = CAMERA_PIXEL_FORMAT_BGR888;
+    frameMeta->width   = width;
+    frameMeta->height  = height;
+    frameMeta->stride  = width * DECODED_FRAME_CHANNELS;
+    frameMeta->size    = (uint64_t)width * height * DECODED_FRAME_CHANNELS;
+}
@@ -0,0 +1,81 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef HAL_SERVICE_FRAME_DECODER_H_
+#define HAL_SERVICE_FRAME_DECODER_H_
+
+/*-----------------------------------------------------------------------------
+ (File Inclusions)
+ ----------------------------------------------------------------------------*/
+#include "camera_hal_types.h"
+#include "camera_shared_memory_ex.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Decodes the jpeg frames of the preview ring once into a second ring of BGR frames, which the
+// solutions read instead of decoding each frame themselves. A frame is decoded only when one
+// of the readers of the second ring is due for it, see CameraSharedMemoryEx::isFrameDue(), and
+// scaled down in the decoder as far as the input size of the readers allows.
+class FrameDecoder
+{
+public:
+    FrameDecoder();
+    ~FrameDecoder();
+
+    // Creates the ring of decoded frames for the jpeg stream of format and reads the preview
+    // ring as a client of its own, through a copy of its fd.
+    bool start(CameraSharedMemoryEx &source, int fd, const stream_format_t &format,
+               const std::string &name);
+    void stop();
+
+    const std::string &getShmName() const { return shmName_; }
+    // read cursors of the solutions on the ring of decoded frames
+    bool addCursor(int clientId);
+    void removeCursor(int clientId);
+
+private:
+    void run();
+    int lockSlot();
+    uint32_t getScaleDenom();
+    bool decode(const unsigned char *data, size_t size, uint32_t scaleDenom, unsigned char *out,
+                uint32_t *pWidth, uint32_t *pHeight);
+    void updateMeta(int index, const unsigned char *meta, size_t metaSize, uint32_t width,
+                    uint32_t height);
+
+    CameraSharedMemoryEx reader_;
+    CameraSharedMemoryEx decoded_;
+    int clientId_{-1};
+    std::string shmName_;
+
+    // stream size, and largest decoded size the slots hold
+    uint32_t srcWidth_{0};
+    uint32_t srcHeight_{0};
+    uint32_t width_{0};
+    uint32_t height_{0};
+    uint32_t scaleDenom_{1};
+    size_t frameSize_{0};
+    std::vector<void *> dataList_;
+    std::vector<void *> metaList_;
+
+    unsigned long long frames_{0};
+    unsigned long long skipped_{0};
+    std::atomic<bool> running_{false};
+    std::thread tidDecoder_;
+};
+
+#endif /* HAL_SERVICE_FRAME_DECODER_H_ */
@@ -33,6 +33,8 @@ CameraSolutionService::CameraSolutionService(const char *service_name)
     LS_CATEGORY_METHOD(enable)
     LS_CATEGORY_METHOD(release)
     LS_CATEGORY_METHOD(subscribe)
+    LS_CATEGORY_METHOD(setSchedule)
+    LS_CATEGORY_METHOD(getStatus)
     LS_CATEGORY_END;
 
     // attach to mainloop and run it
@@ -109,6 +111,8 @@ bool CameraSolutionService::init(LSMessage &message)
     bool ret = true;
     stream_format_t streamFormat_{CAMERA_PIXEL_FORMAT_JPEG, 0, 0, 0, 0};
     std::string shmName;
+    std::string decodedShmName;
+    int clientId           = -1;
     jvalue_ref json_outobj = jobject_create();
     auto *payload          = LSMessageGetPayload(&message);
     PLOGI("payload %s", payload);
@@ -150,8 +154,23 @@ bool CameraSolutionService::init(LSMessage &message)
         PLOGI("shmName %s", shmName.c_str());
     }
 
+    if (parsed.hasKey(CONST_PARAM_NAME_DECODED_SHMNAME))
+    {
+        decodedShmName = parsed[CONST_PARAM_NAME_DECODED_SHMNAME].asString();
+        PLOGI("decodedShmName %s", decodedShmName.c_str());
+    }
+
+    if (parsed.hasKey(CONST_PARAM_NAME_ID))
+    {
+        clientId = parsed[CONST_PARAM_NAME_ID].asNumber<int>();
+    }
+
     if (pSolution_)
+    {
+        pSolution_->setClientId(clientId);
+        pSolution_->setDecodedShmName(decodedShmName);
         pSolution_->initialize(&streamFormat_, shmName, this->get());
+    }
 
     jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_RETURNVALUE), jboolean_create(ret));
 
@@ -256,6 +275,81 @@ bool CameraSolutionService::subscribe(LSMessage &message)
     return ret;
 }
 
+bool CameraSolutionService::setSchedule(LSMessage &message)
+{
+    bool ret               = false;
+    jvalue_ref json_outobj = jobject_create();
+    auto *payload          = LSMessageGetPayload(&message);
+    PLOGI("payload %s", payload);
+
+    pbnjson::JValue parsed = pbnjson::JDomParser::fromString(payload);
+
+    solution_schedule_t schedule;
+    if (parsed.hasKey(CONST_PARAM_NAME_FPS))
+    {
+        schedule.fps = parsed[CONST_PARAM_NAME_FPS].asNumber<double>();
+    }
+
+    if (parsed.hasKey(CONST_PARAM_NAME_MAX_LATENCY))
+    {
+        schedule.max_latency_ms = parsed[CONST_PARAM_NAME_MAX_LATENCY].asNumber<int>();
+    }
+
+    if (parsed.hasKey(CONST_PARAM_NAME_PRIORITY))
+    {
+        schedule.priority = parsed[CONST_PARAM_NAME_PRIORITY].asNumber<int>();
+    }
+
+    if (pSolution_)
+    {
+        pSolution_->setSchedule(&schedule);
+        ret = true;
+    }
+
+    jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_RETURNVALUE), jboolean_create(ret));
+
+    LS::Message request(&message);
+    request.respond(jvalue_stringify(json_outobj));
+
+    j_release(&json_outobj);
+
+    return ret;
+}
+
+bool CameraSolutionService::getStatus(LSMessage &message)
+{
+    solution_status_t status;
+    bool ret               = pSolution_ && pSolution_->getStatus(&status);
+    jvalue_ref json_outobj = jobject_create();
+
+    jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_RETURNVALUE), jboolean_create(ret));
+    if (ret)
+    {
+        jvalue_ref json_scheduleobj = jobject_create();
+        jobject_put(json_scheduleobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_FPS),
+                    jnumber_create_f64(status.schedule.fps));
+        jobject_put(json_scheduleobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_MAX_LATENCY),
+                    jnumber_create_i32(status.schedule.max_latency_ms));
+        jobject_put(json_scheduleobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_PRIORITY),
+                    jnumber_create_i32(status.schedule.priority));
+        jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_PARAMS), json_scheduleobj);
+
+        jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_FPS),
+                    jnumber_create_f64(status.fps));
+        jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_LATENCY),
+                    jnumber_create_i32(status.latency_ms));
+        jobject_put(json_outobj, J_CSTR_TO_JVAL(CONST_PARAM_NAME_SKIPPED),
+                    jnumber_create_i64(static_cast<int64_t>(status.skipped)));
+    }
+
+    LS::Message request(&message);
+    request.respond(jvalue_stringify(json_outobj));
+
+    j_release(&json_outobj);
+
+    return ret;
+}
+
 std::string parseSolutionServiceName(int argc, char *argv[]) noexcept
 {
     int c;
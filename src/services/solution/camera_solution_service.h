@@ -42,6 +42,8 @@ public:
     bool enable(LSMessage &message);
     bool release(LSMessage &message);
     bool subscribe(LSMessage &);
+    bool setSchedule(LSMessage &message);
+    bool getStatus(LSMessage &message);
 };
 
 std::string parseSolutionServiceName(int argc, char *argv[]) noexcept;
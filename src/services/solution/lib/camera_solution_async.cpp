@@ -15,106 +15,161 @@
 
 #define LOG_TAG "CameraSolutionAsync"
 #include "camera_solution_async.h"
+#include "camera_frame_meta.h"
+#include "camera_shared_memory.h"
 #include "camera_shared_memory_ex.h"
 #include "camera_types.h"
-#include <list>
-#include <numeric>
+#include <cerrno>
+#include <new>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <system_error>
+#include <unistd.h>
 
 using namespace std::chrono_literals;
 
-struct PerformanceControl
+// Admits frames at the rate of the schedule and measures the rate and latency achieved.
+// Times are microseconds of the monotonic clock, which the driver timestamps also use.
+struct FrameScheduler
 {
-    int64_t timeMultiple_{0};
-    int64_t timeScale_{10000};
-    double targetFPS_{3.0f};
-    double avrFPS_{0.0f};
-    size_t frameCount_{0};
-    int64_t prevClk_{0};
-    std::list<int64_t> lstDur_;
-
-    void sampleFPS(void)
+    int64_t nextDue_{0};
+    int64_t prevDone_{0};
+    double avrInterval_{0.0};
+    double avrLatency_{0.0};
+    uint64_t skipped_{0};
+
+    bool admit(const solution_schedule_t &schedule, int64_t now, uint64_t captured)
     {
-        if (prevClk_ == 0)
+        if (schedule.max_latency_ms > 0 && captured > 0 && (uint64_t)now > captured &&
+            (uint64_t)now - captured > (uint64_t)schedule.max_latency_ms * 1000)
         {
-            prevClk_ = g_get_monotonic_time();
+            skipped_++;
+            return false;
         }
-        else
+
+        if (schedule.fps > 0.0)
         {
-            int64_t currClk = g_get_monotonic_time();
-            int64_t dur     = currClk - prevClk_;
-            lstDur_.push_back(dur);
-            prevClk_ = currClk;
+            if (now < nextDue_)
+            {
+                skipped_++;
+                return false;
+            }
+            // a frame later than one period starts a new phase instead of a burst
+            int64_t period = (int64_t)(1000000.0 / schedule.fps);
+            nextDue_       = (now - nextDue_ > period) ? now + period : nextDue_ + period;
         }
-        frameCount_ = lstDur_.size();
+        return true;
     }
 
-    void resetFPS(void)
+    void done(int64_t now, uint64_t captured)
     {
-        lstDur_.clear();
-        frameCount_ = 0;
+        if (prevDone_ > 0)
+            avrInterval_ = average(avrInterval_, (double)(now - prevDone_));
+        prevDone_ = now;
+
+        if (captured > 0 && (uint64_t)now > captured)
+            avrLatency_ = average(avrLatency_, (double)((uint64_t)now - captured));
     }
 
-    void calculateFPS(void)
+    // moving average over about 8 samples
+    static double average(double avr, double sample)
     {
-        if (timeMultiple_ > 0)
-        {
-            long usleep_time = timeScale_ * timeMultiple_;
-            g_usleep((usleep_time > 0) ? (unsigned long)usleep_time : 0);
-        }
-
-        int adj_int      = (abs(avrFPS_ - 0.0) < 1e-9) ? 0 : (avrFPS_ > 1 ? 27 / (int)avrFPS_ : 27);
-        size_t adj       = (adj_int > 0) ? adj_int : 0;
-        size_t adj_check = (adj < 30) ? 30 - adj : 0;
+        return (avr > 0.0) ? avr + (sample - avr) / 8 : sample;
+    }
 
-        if (frameCount_ < adj_check)
-            return;
+    double fps(void) const { return (avrInterval_ > 0.0) ? 1000000.0 / avrInterval_ : 0.0; }
+    int latencyMs(void) const { return (int)(avrLatency_ / 1000); }
+};
 
-        int tot_dur_int   = std::accumulate(lstDur_.begin(), lstDur_.end(), 0);
-        size_t totalDur   = (tot_dur_int > 0) ? (size_t)tot_dur_int : 0;
-        size_t ave_dur_ul = totalDur / (frameCount_ - 1);
-        long avrDur       = (ave_dur_ul > LONG_MAX) ? LONG_MAX : (long)ave_dur_ul;
-        avrFPS_           = 1000000.0f / avrDur;
+static uint64_t getCaptureTime(const unsigned char *meta, size_t size)
+{
+    if (meta == nullptr || size < sizeof(CameraFrameMeta))
+        return 0;
 
-        if (avrFPS_ > targetFPS_)
-        {
-            if ((avrFPS_ - targetFPS_) > 0.5)
-                timeMultiple_ += 10;
-            else
-                timeMultiple_ += 1;
-        }
-        else
-        {
-            if (timeMultiple_ > 0)
-                timeMultiple_ -= 1;
-        }
+    const CameraFrameMeta *frameMeta = reinterpret_cast<const CameraFrameMeta *>(meta);
+    return (frameMeta->version >= 1) ? frameMeta->timestamp : 0;
+}
 
-        PLOGI(">>>>>> fps : %f, target_fps : %f <<<<<<", avrFPS_, targetFPS_);
+static void getFrameFormat(const unsigned char *meta, size_t size, stream_format_t *format)
+{
+    if (meta == nullptr || size < sizeof(CameraFrameMeta))
+        return;
 
-        resetFPS();
+    const CameraFrameMeta *frameMeta = reinterpret_cast<const CameraFrameMeta *>(meta);
+    if (frameMeta->version >= 1)
+    {
+        format->pixel_format  = (camera_pixel_format_t)frameMeta->format;
+        format->stream_width  = frameMeta->width;
+        format->stream_height = frameMeta->height;
+        format->buffer_size   = (unsigned int)frameMeta->size;
     }
+}
 
-    void targetFPS(double targetFPS) { targetFPS_ = targetFPS; }
-};
+static void applyPriority(const char *name, int priority)
+{
+    // the nice value of a thread is set through its tid
+    if (setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), priority) < 0)
+    {
+        PLOGW("[%s] fail to set priority %d : %s", name, priority, strerror(errno));
+    }
+}
 
-CameraSolutionAsync::Buffer::Buffer(uint8_t *data, uint32_t size)
+CameraSolutionAsync::Buffer::Buffer(uint8_t *data, uint32_t size, CameraSharedMemoryEx *shmem)
+    : shmem_(shmem)
 {
-    if (data_ == nullptr && data != nullptr && size != 0)
+    if (data != nullptr && size != 0)
     {
+        data_ = data;
         size_ = size;
-        data_ = new uint8_t[size_];
-        memcpy(data_, data, size_);
     }
 }
 
 CameraSolutionAsync::Buffer::~Buffer(void)
 {
-    if (data_ != nullptr)
+    // gives the slot back to the writer
+    if (shmem_ != nullptr)
     {
-        delete[] data_;
+        shmem_->release();
     }
 }
 
+bool CameraSolutionAsync::Buffer::isValid(void) const
+{
+    if (copy_ || shmem_ == nullptr)
+        return true;
+    return shmem_->isValid();
+}
+
+bool CameraSolutionAsync::Buffer::makePrivate(void)
+{
+    if (copy_ || data_ == nullptr)
+        return true;
+
+    std::unique_ptr<uint8_t[]> copy(new (std::nothrow) uint8_t[size_]);
+    if (!copy)
+    {
+        PLOGE("Fail to allocate %u bytes", size_);
+        return false;
+    }
+    memcpy(copy.get(), data_, size_);
+
+    // the slot may have been taken back while copying
+    if (!isValid())
+    {
+        PLOGW("frame is overwritten");
+        return false;
+    }
+
+    copy_ = std::move(copy);
+    data_ = copy_.get();
+    if (shmem_ != nullptr)
+    {
+        shmem_->release();
+        shmem_ = nullptr;
+    }
+    return true;
+}
+
 CameraSolutionAsync::CameraSolutionAsync(void) {}
 
 CameraSolutionAsync::~CameraSolutionAsync(void) { PLOGI(""); }
@@ -143,12 +198,67 @@ void CameraSolutionAsync::processForSnapshot(const void *inBuf) {}
 
 void CameraSolutionAsync::processForPreview(const void *inBuf) {}
 
+void CameraSolutionAsync::setSchedule(const void *schedule)
+{
+    if (schedule == nullptr)
+        return;
+
+    const solution_schedule_t *request = static_cast<const solution_schedule_t *>(schedule);
+
+    std::lock_guard<std::mutex> lock(mtxSchedule_);
+    if (request->fps > 0.0)
+        schedule_.fps = request->fps;
+    if (request->max_latency_ms > 0)
+        schedule_.max_latency_ms = request->max_latency_ms;
+    if (request->priority != 0)
+        schedule_.priority = request->priority;
+
+    PLOGI("[%s] fps %.2f, max latency %d ms, priority %d", getSolutionStr().c_str(),
+          schedule_.fps, schedule_.max_latency_ms, schedule_.priority);
+}
+
+bool CameraSolutionAsync::getStatus(void *status)
+{
+    if (status == nullptr)
+        return false;
+
+    solution_status_t *out = static_cast<solution_status_t *>(status);
+
+    std::lock_guard<std::mutex> lock(mtxSchedule_);
+    *out          = status_;
+    out->name     = getSolutionStr();
+    out->schedule = schedule_;
+    return true;
+}
+
+uint32_t CameraSolutionAsync::getScaleDenom(uint32_t width, uint32_t height) const
+{
+    if (inputWidth_ == 0 || inputHeight_ == 0)
+        return 1;
+
+    // libjpeg rounds the scaled size up
+    uint32_t scaleDenom = 8;
+    while (scaleDenom > 1 && ((width + scaleDenom - 1) / scaleDenom < inputWidth_ ||
+                              (height + scaleDenom - 1) / scaleDenom < inputHeight_))
+    {
+        scaleDenom /= 2;
+    }
+    return scaleDenom;
+}
+
 void CameraSolutionAsync::run(void)
 {
-    PerformanceControl oPC;
-    oPC.targetFPS(1.0f);
+    FrameScheduler oScheduler;
     int shmBufferFd = -1;
-    PLOGI("[%s] shmName(%s)", name_.c_str(), shmName_.c_str());
+
+    // the frames decoded by the hal spare this solution a jpeg decode of its own
+    std::string shmName = shmName_;
+    if (decodedInput_ && !decodedShmName_.empty())
+    {
+        shmName = decodedShmName_;
+    }
+    frameFormat_ = streamFormat_;
+    PLOGI("[%s] shmName(%s)", name_.c_str(), shmName.c_str());
 
     pthread_setname_np(pthread_self(), "solution_async");
 
@@ -159,7 +269,7 @@ void CameraSolutionAsync::run(void)
         return;
     }
 
-    shmBufferFd = camShmem_->open(shmName_);
+    shmBufferFd = camShmem_->open(shmName);
     PLOGI("[%s] camShmem_->open() fd(%d)", name_.c_str(), shmBufferFd);
 
     if (shmBufferFd < 0)
@@ -171,24 +281,33 @@ void CameraSolutionAsync::run(void)
         return;
     }
 
-    // [TODO][WRR-15623] Apply sync operation to the solution
-    // It is necessary to register a solution signal FD in a half process.
-    // After adding this, the skipsignal of open() should be erased.
-
-    // shmSignalFd_ = camShmem_->createSignal();
-    // PLOGI("[%s] camShmem_->createSignal() fd(%d)", name_.c_str(), shmSignalFd_);
-
-    // if (shmSignalFd_ < 0)
-    // {
-    //     PLOGE("[%s] Fail to create Signal in CameraSharedMemory", name_.c_str());
-
-    //     if (camShmem_)
-    //         camShmem_.reset();
-    //     return;
-    // }
+    // The hal registered a read cursor for this solution : follow it so the frames it skips
+    // are counted. Without one, the latest frame is read all the same.
+    if (clientId_ >= 0 && !camShmem_->attachCursor(clientId_, CAMERA_SHM_READ_LATEST))
+    {
+        PLOGW("[%s] no read cursor for client %d", name_.c_str(), clientId_);
+    }
+    else if (clientId_ >= 0 && inputWidth_ > 0 && inputHeight_ > 0)
+    {
+        // the hal decoder scales the frames down to the largest input size of its readers
+        camShmem_->setInputSize(inputWidth_, inputHeight_);
+    }
 
+    uint32_t frameCount = 0;
+    int priority        = 0;
     while (checkAlive())
     {
+        solution_schedule_t schedule;
+        {
+            std::lock_guard<std::mutex> lock(mtxSchedule_);
+            schedule = schedule_;
+        }
+        if (schedule.priority != priority)
+        {
+            priority = schedule.priority;
+            applyPriority(name_.c_str(), priority);
+        }
+
         size_t data_len           = 0;
         size_t extra_len          = 0;
         size_t meta_len           = 0;
@@ -203,41 +322,75 @@ void CameraSolutionAsync::run(void)
             break;
         }
 
+        // sleeps on the frame futex of the shared memory until a new frame is published
         bool status = camShmem_->read(&data_addr, &data_len, &meta_addr, &meta_len, &extra_addr,
-                                      &extra_len, nullptr, nullptr, 1000, true);
+                                      &extra_len, nullptr, nullptr, 1000, false);
 
         PLOGD("[%s] camShmem_->read() data_len(%zu) meta_len(%zu) extra_len(%zu)", name_.c_str(),
               data_len, meta_len, extra_len);
 
         if (status == false)
         {
-            PLOGE("[%s] shared memory read fail", name_.c_str());
-            break;
+            // no frame within the timeout : the preview may be paused
+            PLOGD("[%s] shared memory read timeout", name_.c_str());
+            continue;
         }
 
         if (data_len == 0)
         {
-            g_usleep(1000);
+            camShmem_->release();
             continue;
         }
 
+        // frames out of the schedule go back unread, the next read wakes on a new frame
+        uint32_t decimation = decimation_.load();
+        uint64_t captured   = getCaptureTime(meta_addr, meta_len);
+        if ((frameCount++ % decimation) != 0)
+        {
+            oScheduler.skipped_++;
+            camShmem_->release();
+            continue;
+        }
+        if (!oScheduler.admit(schedule, g_get_monotonic_time(), captured))
+        {
+            camShmem_->release();
+            continue;
+        }
+
+        getFrameFormat(meta_addr, meta_len, &frameFormat_);
+
         buffer_t inBuf;
         inBuf.start  = data_addr;
         inBuf.length = data_len;
         pushJob(inBuf);
 
+        // A writer that skips the frames no reader is due for, the decoder of the hal, does
+        // not work for this solution while it is busy, then waits for its next due time.
+        camShmem_->setFrameDue(INT64_MAX);
         if (checkAlive())
         {
             processing();
-            oPC.sampleFPS();
-            oPC.calculateFPS();
-            popJob();
+            oScheduler.done(g_get_monotonic_time(), captured);
         }
+        popJob();
+        camShmem_->setFrameDue((schedule.fps > 0.0) ? oScheduler.nextDue_ : 0);
+
+        std::lock_guard<std::mutex> lock(mtxSchedule_);
+        status_.fps        = oScheduler.fps();
+        status_.latency_ms = oScheduler.latencyMs();
+        status_.skipped    = oScheduler.skipped_;
     }
     postProcessing();
 
     if (camShmem_)
     {
+        uint64_t dropped = 0, duplicated = 0;
+        if (camShmem_->getReadStats(&dropped, &duplicated))
+        {
+            PLOGI("[%s] frames %u, skipped %llu by the reader, %llu by the schedule", name_.c_str(),
+                  frameCount, (unsigned long long)dropped,
+                  (unsigned long long)oScheduler.skipped_);
+        }
         PLOGI("[%s] camShmem_.close", name_.c_str());
         camShmem_->close();
         camShmem_.reset();
@@ -289,7 +442,9 @@ void CameraSolutionAsync::pushJob(buffer_t inBuf)
 {
     if (queueJob_.empty())
     {
-        queueJob_.push(std::make_unique<Buffer>((uint8_t *)inBuf.start, inBuf.length));
+        // read() has leased the slot of the frame, the lease goes with the job
+        queueJob_.push(
+            std::make_unique<Buffer>((uint8_t *)inBuf.start, inBuf.length, camShmem_.get()));
     }
 }
 
@@ -0,0 +1,569 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <gtest/gtest.h>
+
+#include "camera_shared_memory.h"
+#include "camera_shared_memory_ex.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+const size_t DATA_SIZE   = 64 * 1024;
+const size_t META_SIZE   = 64;
+const int READ_TIMEOUT   = 100;
+const int READER_COUNT   = 3;
+const uint32_t FRAME_MAX = 500;
+
+// Every byte of a frame holds the low byte of the frame number, after the frame number itself.
+static void writeFrame(CameraSharedMemoryEx &writer, uint32_t frame)
+{
+    std::vector<unsigned char> data(DATA_SIZE, (unsigned char)frame);
+    memcpy(data.data(), &frame, sizeof(frame));
+    writer.write(data.data(), data.size(), nullptr, 0, nullptr, 0, nullptr, 0);
+    writer.notifySignal();
+}
+
+static uint32_t frameOf(const unsigned char *data)
+{
+    uint32_t frame;
+    memcpy(&frame, data, sizeof(frame));
+    return frame;
+}
+
+static bool isFrameIntact(const unsigned char *data, size_t size)
+{
+    if (size != DATA_SIZE)
+        return false;
+
+    unsigned char value = (unsigned char)frameOf(data);
+    for (size_t i = sizeof(uint32_t); i < size; i++)
+    {
+        if (data[i] != value)
+            return false;
+    }
+    return true;
+}
+
+// the readers map the ring through their own copy of the fd, as the clients of the service do
+static bool openReader(CameraSharedMemoryEx &reader, int fd)
+{
+    int readerFd = dup(fd);
+    if (readerFd < 0)
+        return false;
+    if (!reader.open(readerFd))
+    {
+        close(readerFd);
+        return false;
+    }
+    return true;
+}
+
+static bool readFrame(CameraSharedMemoryEx &reader, uint32_t *pFrame)
+{
+    unsigned char *data = nullptr;
+    size_t size         = 0;
+    if (!reader.read(&data, &size, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+                     READ_TIMEOUT, true))
+        return false;
+
+    *pFrame = frameOf(data);
+    return true;
+}
+
+class CameraSharedMemoryTest : public ::testing::Test
+{
+protected:
+    void createRing(size_t bufferCount)
+    {
+        fd_ = writer_.create("test_camera_shm", DATA_SIZE, META_SIZE, 0, 0, bufferCount,
+                             CAMERA_SHM_OPT_MEMFD);
+        ASSERT_GE(fd_, 0);
+    }
+
+    void TearDown() override { writer_.close(); }
+
+    CameraSharedMemoryEx writer_;
+    int fd_{-1};
+};
+
+TEST_F(CameraSharedMemoryTest, NoFrameBeforeFirstPublish)
+{
+    createRing(4);
+
+    CameraSharedMemoryEx reader;
+    ASSERT_TRUE(openReader(reader, fd_));
+
+    uint32_t frame = 0;
+    EXPECT_EQ(writer_.getWriteIndex(), -1);
+    EXPECT_FALSE(readFrame(reader, &frame));
+
+    // every slot is owned by the writer until its first frame
+    uint32_t sequence   = 0;
+    uint32_t generation = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_FALSE(reader.acquireSlot(i, &sequence, &generation));
+    }
+    reader.close();
+}
+
+TEST_F(CameraSharedMemoryTest, PublishAdvancesLatestFrame)
+{
+    createRing(4);
+
+    CameraSharedMemoryEx reader;
+    ASSERT_TRUE(openReader(reader, fd_));
+
+    uint32_t frame = 0;
+    for (uint32_t i = 1; i <= 6; i++)
+    {
+        writeFrame(writer_, i);
+        EXPECT_EQ(writer_.getWriteIndex(), (int)(i % 4));
+
+        ASSERT_TRUE(readFrame(reader, &frame));
+        EXPECT_EQ(frame, i);
+        EXPECT_EQ(reader.getReadIndex(), (int)((i - 1) % 4));
+        EXPECT_TRUE(reader.isValid());
+    }
+
+    EXPECT_TRUE(reader.release());
+    EXPECT_FALSE(reader.isValid());
+    reader.close();
+}
+
+TEST_F(CameraSharedMemoryTest, ReadWaitsForNotify)
+{
+    createRing(4);
+
+    CameraSharedMemoryEx reader;
+    ASSERT_TRUE(openReader(reader, fd_));
+
+    std::thread publisher{[this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        writeFrame(writer_, 1);
+    }};
+
+    unsigned char *data = nullptr;
+    size_t size         = 0;
+    EXPECT_TRUE(reader.read(&data, &size, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+                            1000, false));
+    publisher.join();
+    ASSERT_NE(data, nullptr);
+    EXPECT_EQ(frameOf(data), 1u);
+    EXPECT_TRUE(isFrameIntact(data, size));
+
+    // no frame published since, the futex wait times out
+    EXPECT_FALSE(reader.read(&data, &size, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+                             READ_TIMEOUT, false));
+    reader.close();
+}
+
+TEST_F(CameraSharedMemoryTest, ReadWakesOnPublish)
+{
+    createRing(4);
+
+    CameraSharedMemoryEx reader;
+    ASSERT_TRUE(openReader(reader, fd_));
+
+    // the dmabuf writers publish with writeHeader() and have no eventfd to notify
+    std::thread publisher{[this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        writer_.writeHeader(2, DATA_SIZE);
+    }};
+
+    size_t size = 0;
+    EXPECT_TRUE(reader.read(nullptr, &size, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+                            1000, false));
+    publisher.join();
+    EXPECT_EQ(size, DATA_SIZE);
+    EXPECT_EQ(reader.getReadIndex(), 2);
+    reader.close();
+}
+
+TEST_F(CameraSharedMemoryTest, LeaseBlocksWriter)
+{
+    createRing(4);
+    writeFrame(writer_, 1);
+
+    CameraSharedMemoryEx reader;
+    ASSERT_TRUE(openReader(reader, fd_));
+
+    uint32_t sequence   = 0;
+    uint32_t generation = 0;
+    ASSERT_TRUE(reader.acquireSlot(0, &sequence, &generation));
+    EXPECT_TRUE(reader.isSlotValid(0, sequence));
+    EXPECT_FALSE(writer_.lockSlotForWrite(0));
+    EXPECT_TRUE(reader.isSlotValid(0, sequence));
+
+    reader.releaseSlot(0, generation);
+    EXPECT_TRUE(writer_.lockSlotForWrite(0));
+    EXPECT_FALSE(reader.isSlotValid(0, sequence));
+
+    // the slot is owned by the writer until it is published again
+    EXPECT_FALSE(reader.acquireSlot(0, &sequence, &generation));
+    EXPECT_TRUE(writer_.writeHeader(0, DATA_SIZE));
+    EXPECT_TRUE(reader.acquireSlot(0, &sequence, &generation));
+    reader.releaseSlot(0, generation);
+    reader.close();
+}
+
+TEST_F(CameraSharedMemoryTest, ForcedReclaimEvictsReaders)
+{
+    createRing(4);
+    writeFrame(writer_, 1);
+
+    CameraSharedMemoryEx evicted;
+    CameraSharedMemoryEx reader;
+    ASSERT_TRUE(openReader(evicted, fd_));
+    ASSERT_TRUE(openReader(reader, fd_));
+
+    uint32_t oldSequence   = 0;
+    uint32_t oldGeneration = 0;
+    ASSERT_TRUE(evicted.acquireSlot(0, &oldSequence, &oldGeneration));
+
+    EXPECT_TRUE(writer_.lockSlotForWrite(0, true));
+    EXPECT_FALSE(evicted.isSlotValid(0, oldSequence));
+    EXPECT_TRUE(writer_.writeHeader(0, DATA_SIZE));
+
+    uint32_t sequence   = 0;
+    uint32_t generation = 0;
+    ASSERT_TRUE(reader.acquireSlot(0, &sequence, &generation));
+    EXPECT_NE(generation, oldGeneration);
+
+    // the lease taken back does not release the lease of the new generation
+    evicted.releaseSlot(0, oldGeneration);
+    EXPECT_FALSE(writer_.lockSlotForWrite(0));
+
+    reader.releaseSlot(0, generation);
+    EXPECT_TRUE(writer_.lockSlotForWrite(0));
+    evicted.close();
+    reader.close();
+}
+
+TEST_F(CameraSharedMemoryTest, WriteSkipsLeasedSlot)
+{
+    createRing(4);
+    writeFrame(writer_, 1);
+
+    CameraSharedMemoryEx reader;
+    ASSERT_TRUE(openReader(reader, fd_));
+
+    uint32_t frame = 0;
+    ASSERT_TRUE(readFrame(reader, &frame));
+    ASSERT_EQ(reader.getReadIndex(), 0);
+
+    // the writer goes around the ring several times, past the slot of the reader
+    for (uint32_t i = 2; i <= 10; i++)
+    {
+        writeFrame(writer_, i);
+    }
+    EXPECT_TRUE(reader.isValid());
+
+    std::vector<void *> dataList;
+    ASSERT_TRUE(writer_.getBufferList(&dataList, nullptr, nullptr, nullptr));
+    EXPECT_EQ(frameOf(static_cast<unsigned char *>(dataList[0])), 1u);
+
+    unsigned char *data = nullptr;
+    size_t size         = 0;
+
+    ASSERT_TRUE(reader.read(&data, &size, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+                            READ_TIMEOUT, true));
+    EXPECT_EQ(frameOf(data), 10u);
+    EXPECT_TRUE(isFrameIntact(data, size));
+    reader.close();
+}
+
+TEST_F(CameraSharedMemoryTest, OverwriteWhileLeased)
+{
+    createRing(3);
+
+    CameraSharedMemoryEx first;
+    CameraSharedMemoryEx second;
+    ASSERT_TRUE(openReader(first, fd_));
+    ASSERT_TRUE(openReader(second, fd_));
+    ASSERT_GE(writer_.addCursor(1), 0);
+    ASSERT_GE(writer_.addCursor(2), 0);
+    ASSERT_TRUE(first.attachCursor(1, CAMERA_SHM_READ_NEXT));
+    ASSERT_TRUE(second.attachCursor(2, CAMERA_SHM_READ_NEXT));
+
+    for (uint32_t i = 1; i <= 3; i++)
+    {
+        writeFrame(writer_, i);
+    }
+
+    // the readers hold every slot but the latest one
+    uint32_t frame = 0;
+    ASSERT_TRUE(readFrame(first, &frame));
+    EXPECT_EQ(frame, 1u);
+    ASSERT_TRUE(readFrame(second, &frame));
+    ASSERT_TRUE(readFrame(second, &frame));
+    EXPECT_EQ(frame, 2u);
+
+    // the slot right after the latest frame is taken back from its reader
+    writeFrame(writer_, 4);
+    EXPECT_FALSE(first.isValid());
+    EXPECT_TRUE(second.isValid());
+
+    // and the next frame goes to the free slot
+    writeFrame(writer_, 5);
+    EXPECT_TRUE(second.isValid());
+
+    // the evicted reader goes on with the oldest frame left
+    ASSERT_TRUE(readFrame(first, &frame));
+    EXPECT_EQ(frame, 2u);
+    EXPECT_TRUE(first.isValid());
+    first.close();
+    second.close();
+}
+
+TEST_F(CameraSharedMemoryTest, ReadNextReturnsFramesInOrder)
+{
+    createRing(4);
+
+    CameraSharedMemoryEx reader;
+    ASSERT_TRUE(openReader(reader, fd_));
+    ASSERT_GE(writer_.addCursor(1), 0);
+    ASSERT_TRUE(reader.attachCursor(1, CAMERA_SHM_READ_NEXT));
+
+    for (uint32_t i = 1; i <= 3; i++)
+    {
+        writeFrame(writer_, i);
+    }
+
+    uint32_t frame = 0;
+    for (uint32_t i = 1; i <= 3; i++)
+    {
+        ASSERT_TRUE(readFrame(reader, &frame));
+        EXPECT_EQ(frame, i);
+    }
+    // the next frame is not published yet
+    EXPECT_FALSE(readFrame(reader, &frame));
+
+    uint64_t dropped    = 0;
+    uint64_t duplicated = 0;
+    ASSERT_TRUE(reader.getReadStats(&dropped, &duplicated));
+    EXPECT_EQ(dropped, 0u);
+    EXPECT_EQ(duplicated, 0u);
+    reader.close();
+}
+
+TEST_F(CameraSharedMemoryTest, ReadNextCountsLappedFrames)
+{
+    createRing(3);
+
+    CameraSharedMemoryEx reader;
+    ASSERT_TRUE(openReader(reader, fd_));
+    ASSERT_GE(writer_.addCursor(1), 0);
+    ASSERT_TRUE(reader.attachCursor(1, CAMERA_SHM_READ_NEXT));
+
+    for (uint32_t i = 1; i <= 5; i++)
+    {
+        writeFrame(writer_, i);
+    }
+
+    // frames 1 and 2 are overwritten, the oldest one left is read instead
+    uint32_t frame = 0;
+    ASSERT_TRUE(readFrame(reader, &frame));
+    EXPECT_EQ(frame, 3u);
+
+    uint64_t dropped    = 0;
+    uint64_t duplicated = 0;
+    ASSERT_TRUE(reader.getReadStats(&dropped, &duplicated));
+    EXPECT_EQ(dropped, 2u);
+    EXPECT_EQ(duplicated, 0u);
+    reader.close();
+}
+
+TEST_F(CameraSharedMemoryTest, ReadLatestCountsDroppedAndDuplicated)
+{
+    createRing(4);
+    writeFrame(writer_, 1);
+
+    // frames published before the cursor is added are not dropped
+    CameraSharedMemoryEx reader;
+    ASSERT_TRUE(openReader(reader, fd_));
+    ASSERT_GE(writer_.addCursor(1), 0);
+    ASSERT_TRUE(reader.attachCursor(1, CAMERA_SHM_READ_LATEST));
+
+    for (uint32_t i = 2; i <= 4; i++)
+    {
+        writeFrame(writer_, i);
+    }
+
+    uint32_t frame = 0;
+    ASSERT_TRUE(readFrame(reader, &frame));
+    EXPECT_EQ(frame, 4u);
+    ASSERT_TRUE(readFrame(reader, &frame));
+    EXPECT_EQ(frame, 4u);
+
+    uint64_t dropped    = 0;
+    uint64_t duplicated = 0;
+    ASSERT_TRUE(reader.getReadStats(&dropped, &duplicated));
+    EXPECT_EQ(dropped, 2u);
+    EXPECT_EQ(duplicated, 1u);
+    reader.close();
+}
+
+TEST_F(CameraSharedMemoryTest, CursorRegistration)
+{
+    createRing(4);
+
+    CameraSharedMemoryEx reader;
+    ASSERT_TRUE(openReader(reader, fd_));
+    EXPECT_FALSE(reader.attachCursor(1, CAMERA_SHM_READ_LATEST));
+    EXPECT_FALSE(reader.getReadStats(nullptr, nullptr));
+
+    std::vector<int> cursors;
+    for (int id = 0; id < 16; id++)
+    {
+        int cursor = writer_.addCursor(id);
+        EXPECT_GE(cursor, 0);
+        cursors.push_back(cursor);
+    }
+    EXPECT_EQ(writer_.addCursor(16), -1);
+    EXPECT_EQ(writer_.addCursor(3), cursors[3]);
+
+    writer_.removeCursor(3);
+    EXPECT_EQ(writer_.addCursor(16), cursors[3]);
+    EXPECT_FALSE(reader.attachCursor(3, CAMERA_SHM_READ_LATEST));
+    EXPECT_TRUE(reader.attachCursor(16, CAMERA_SHM_READ_LATEST));
+    reader.close();
+}
+
+TEST_F(CameraSharedMemoryTest, FrameDue)
+{
+    createRing(4);
+    EXPECT_FALSE(writer_.isFrameDue(0));
+
+    CameraSharedMemoryEx reader;
+    ASSERT_TRUE(openReader(reader, fd_));
+    EXPECT_FALSE(reader.setFrameDue(0));
+
+    // a registered cursor is due for nothing until its reader attaches
+    ASSERT_GE(writer_.addCursor(1), 0);
+    EXPECT_FALSE(writer_.isFrameDue(INT64_MAX - 1));
+
+    ASSERT_TRUE(reader.attachCursor(1, CAMERA_SHM_READ_LATEST));
+    EXPECT_TRUE(writer_.isFrameDue(0));
+
+    ASSERT_TRUE(reader.setFrameDue(1000));
+    EXPECT_FALSE(writer_.isFrameDue(999));
+    EXPECT_TRUE(writer_.isFrameDue(1000));
+
+    // a reader gone is due for nothing
+    ASSERT_TRUE(reader.setFrameDue(0));
+    reader.close();
+    EXPECT_FALSE(writer_.isFrameDue(INT64_MAX - 1));
+}
+
+TEST_F(CameraSharedMemoryTest, InputSize)
+{
+    createRing(4);
+
+    CameraSharedMemoryEx small;
+    CameraSharedMemoryEx large;
+    ASSERT_TRUE(openReader(small, fd_));
+    ASSERT_TRUE(openReader(large, fd_));
+    ASSERT_GE(writer_.addCursor(1), 0);
+    ASSERT_GE(writer_.addCursor(2), 0);
+
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    EXPECT_FALSE(writer_.getInputSize(&width, &height));
+
+    // a reader which does not tell its size takes the full frame
+    ASSERT_TRUE(small.attachCursor(1, CAMERA_SHM_READ_LATEST));
+    ASSERT_TRUE(writer_.getInputSize(&width, &height));
+    EXPECT_EQ(width, UINT32_MAX);
+    EXPECT_EQ(height, UINT32_MAX);
+
+    ASSERT_TRUE(small.setInputSize(320, 240));
+    ASSERT_TRUE(large.attachCursor(2, CAMERA_SHM_READ_LATEST));
+    ASSERT_TRUE(large.setInputSize(640, 480));
+    ASSERT_TRUE(writer_.getInputSize(&width, &height));
+    EXPECT_EQ(width, 640u);
+    EXPECT_EQ(height, 480u);
+
+    large.close();
+    ASSERT_TRUE(writer_.getInputSize(&width, &height));
+    EXPECT_EQ(width, 320u);
+    EXPECT_EQ(height, 240u);
+
+    ASSERT_TRUE(small.setInputSize(0, 240));
+    ASSERT_TRUE(writer_.getInputSize(&width, &height));
+    EXPECT_EQ(width, UINT32_MAX);
+    EXPECT_EQ(height, 240u);
+
+    small.close();
+    EXPECT_FALSE(writer_.getInputSize(&width, &height));
+}
+
+TEST_F(CameraSharedMemoryTest, WriterAndReaders)
+{
+    createRing(4);
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> readers;
+    std::atomic<int> inconsistent{0};
+    for (int r = 0; r < READER_COUNT; r++)
+    {
+        readers.emplace_back([this, &done, &inconsistent]() {
+            CameraSharedMemoryEx reader;
+            if (!openReader(reader, fd_))
+            {
+                inconsistent++;
+                return;
+            }
+
+            uint32_t last = 0;
+            while (last < FRAME_MAX)
+            {
+                unsigned char *data = nullptr;
+                size_t size         = 0;
+                if (!reader.read(&data, &size, nullptr, nullptr, nullptr, nullptr, nullptr,
+                                 nullptr, READ_TIMEOUT, done))
+                    continue;
+
+                // a torn frame is fine only when the writer has taken the slot back meanwhile
+                uint32_t frame = frameOf(data);
+                bool intact    = isFrameIntact(data, size);
+                if (!reader.isValid())
+                    continue;
+                if (!intact || frame < last)
+                    inconsistent++;
+                last = frame;
+            }
+            reader.close();
+        });
+    }
+
+    for (uint32_t i = 1; i <= FRAME_MAX; i++)
+    {
+        writeFrame(writer_, i);
+    }
+    done = true;
+
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+    EXPECT_EQ(inconsistent, 0);
+}